@@ -0,0 +1,28 @@
+#!/bin/bash
+# Compares the PLI caching methods of Pyro: prints the PLI cache statistics and the elapsed time
+# of every method on every dataset. Usage: ./benchmark_pli_caching.sh [pli_cache_limit in MB]
+declare -a datasets=('CIPublicHighway' 'neighbors10k' 'WDC_age' 'WDC_appearances' 'WDC_astronomical' 'WDC_game' 'WDC_science' 'breast_cancer')
+declare -a separators=(',' ',' ',' ',' ',' ',' ',' ',')
+declare -a header_presence=('true' 'true' 'true' 'true' 'true' 'true' 'true' 'true')
+
+declare -a caching_methods=('coin' 'none' 'all' 'entropy' 'uniqueness' 'mean_entropy' 'q2' 'gini' 'inverted_entropy')
+
+declare seed=10000
+declare -a cache_limit=()
+if [ -n "$1" ]; then
+    cache_limit=(--pli_cache_limit="$1")
+fi
+
+cd build/target
+
+for i in "${!datasets[@]}"
+do
+    if [ ! -f inputData/"${datasets[i]}".csv ]; then
+        continue
+    fi
+    for method in "${caching_methods[@]}"
+    do
+        echo "${datasets[i]} $method"
+        ./Desbordante_run --task=fd --algo='pyro' --data="${datasets[i]}".csv --sep="${separators[i]}" --has_header="${header_presence[i]}" --seed=$seed --pli_caching="$method" "${cache_limit[@]}" 2>&1 | grep -E 'PLI cache|ELAPSED TIME'
+    done
+done
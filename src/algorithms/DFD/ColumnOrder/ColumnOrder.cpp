@@ -23,7 +23,7 @@ std::vector<int> ColumnOrder::GetOrderHighDistinctCount(const Vertical& columns)
 
     int current_order_index = 0;
     for (int column_index : order_) {
-        if (columns.GetColumnIndices()[column_index]) {
+        if (columns.GetColumnSet()[column_index]) {
             order_for_columns[current_order_index++] = column_index;
         }
     }
@@ -37,7 +37,7 @@ std::vector<int> ColumnOrder::GetOrderLowDistinctCount(const Vertical& columns)
     assert(!order_.empty());
     int current_order_index = 0;
     for (int i = this->order_.size() - 1; i >= 0; --i) {
-        if (columns.GetColumnIndices()[order_[i]]) {
+        if (columns.GetColumnSet()[order_[i]]) {
             order_for_columns[current_order_index++] = this->order_[i];
         }
     }
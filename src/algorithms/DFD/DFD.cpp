@@ -7,13 +7,21 @@
 #include "RelationalSchema.h"
 #include "PositionListIndex.h"
 #include "LatticeTraversal/LatticeTraversal.h"
+#include "ProgramOptionStrings.h"
 
 namespace algos {
 
+namespace posr = program_option_strings;
+
 unsigned long long DFD::ExecuteInternal() {
-    partition_storage_ = std::make_unique<PartitionStorage>(relation_.get(),
-                                                            CachingMethod::kAllCaching,
-                                                            CacheEvictionMethod::kMedainUsage);
+    std::size_t memory_limit = 0;
+    if (config_.HasParam(posr::PliCacheLimit)) {
+        memory_limit =
+            static_cast<std::size_t>(GetSpecialParam<unsigned int>(posr::PliCacheLimit)) << 20;
+    }
+    pli_cache_ = std::make_unique<util::PLICache>(
+        relation_.get(), CachingMethod::kAllCaching, CacheEvictionMethod::kMedainUsage, 1,
+        memory_limit);
     RelationalSchema const* const schema = relation_->GetSchema();
 
     auto start_time = std::chrono::system_clock::now();
@@ -49,7 +57,7 @@ unsigned long long DFD::ExecuteInternal() {
             }
 
             auto search_space = LatticeTraversal(rhs.get(), relation_.get(), unique_columns_,
-                                                 partition_storage_.get());
+                                                 pli_cache_.get());
             auto const minimal_deps = search_space.FindLHSs();
 
             for (auto const& minimal_dependency_lhs: minimal_deps) {
@@ -5,13 +5,13 @@
 
 #include "PliBasedFDAlgorithm.h"
 #include "Vertical.h"
-#include "DFD/PartitionStorage/PartitionStorage.h"
+#include "PLICache.h"
 
 namespace algos {
 
 class DFD : public PliBasedFDAlgorithm {
 private:
-    std::unique_ptr<PartitionStorage> partition_storage_;
+    std::unique_ptr<util::PLICache> pli_cache_;
     std::vector<Vertical> unique_columns_;
 
     unsigned int number_of_threads_;
@@ -8,12 +8,12 @@ NodeCategory LatticeObservations::UpdateDependencyCategory(Vertical const& node)
         return new_category;
     }
 
-    auto column_indices = node.GetColumnIndicesRef(); //copy indices
+    ColumnSet column_indices = node.GetColumnSet(); //copy indices
     bool has_unchecked_subset = false;
 
     for (size_t index = column_indices.find_first(); index < column_indices.size();
          index = column_indices.find_next(index)) {
-        column_indices[index] = false; //remove one column
+        column_indices.reset(index); //remove one column
         auto const subset_node_iter = this->find(Vertical(node.GetSchema(), column_indices));
 
         if (subset_node_iter == this->end()) {
@@ -30,7 +30,7 @@ NodeCategory LatticeObservations::UpdateDependencyCategory(Vertical const& node)
             }
         }
 
-        column_indices[index] = true; //restore removed column
+        column_indices.set(index); //restore removed column
     }
     new_category = has_unchecked_subset ? NodeCategory::kCandidateMinimalDependency
                                         : NodeCategory::kMinimalDependency;
@@ -40,8 +40,8 @@ NodeCategory LatticeObservations::UpdateDependencyCategory(Vertical const& node)
 
 NodeCategory LatticeObservations::UpdateNonDependencyCategory(Vertical const& node,
                                                               unsigned int rhs_index) {
-    auto column_indices = node.GetColumnIndicesRef();
-    column_indices[rhs_index] = true;
+    ColumnSet column_indices = node.GetColumnSet();
+    column_indices.set(rhs_index);
     column_indices.flip();
 
     NodeCategory new_category;
@@ -83,16 +83,16 @@ bool LatticeObservations::IsCandidate(Vertical const& node) const {
 
 std::unordered_set<Vertical> LatticeObservations::GetUncheckedSubsets(
     Vertical const& node, ColumnOrder const& column_order) const {
-    auto indices = node.GetColumnIndices();
+    ColumnSet indices = node.GetColumnSet();
     std::unordered_set<Vertical> unchecked_subsets;
 
     for (int column_index : column_order.GetOrderHighDistinctCount(node)) {
-        indices[column_index] = false;
+        indices.reset(column_index);
         Vertical subset_node = Vertical(node.GetSchema(), indices);
         if (this->find(subset_node) == this->end()) {
             unchecked_subsets.insert(std::move(subset_node));
         }
-        indices[column_index] = true;
+        indices.set(column_index);
     }
 
     return unchecked_subsets;
@@ -100,16 +100,17 @@ std::unordered_set<Vertical> LatticeObservations::GetUncheckedSubsets(
 
 std::unordered_set<Vertical> LatticeObservations::GetUncheckedSupersets(
     Vertical const& node, unsigned int rhs_index, ColumnOrder const& column_order) const {
-    auto flipped_indices = node.GetColumnIndices().flip();
+    ColumnSet flipped_indices = node.GetColumnSet();
+    flipped_indices.flip();
     std::unordered_set<Vertical> unchecked_supersets;
 
-    flipped_indices[rhs_index] = false;
+    flipped_indices.reset(rhs_index);
 
     for (int column_index :
          column_order.GetOrderHighDistinctCount(Vertical(node.GetSchema(), flipped_indices))) {
-        auto indices = node.GetColumnIndices();
+        ColumnSet indices = node.GetColumnSet();
 
-        indices[column_index] = true;
+        indices.set(column_index);
         Vertical subset_node = Vertical(node.GetSchema(), indices);
         if (this->find(subset_node) == this->end()) {
             unchecked_supersets.insert(std::move(subset_node));
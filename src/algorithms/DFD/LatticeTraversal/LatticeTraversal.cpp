@@ -7,14 +7,14 @@
 LatticeTraversal::LatticeTraversal(const Column* const rhs,
                                    const ColumnLayoutRelationData* const relation,
                                    const std::vector<Vertical>& unique_verticals,
-                                   PartitionStorage* const partition_storage)
+                                   util::PLICache* const pli_cache)
     : rhs_(rhs),
       dependencies_map_(relation->GetSchema()),
       non_dependencies_map_(relation->GetSchema()),
       column_order_(relation),
       unique_columns_(unique_verticals),
       relation_(relation),
-      partition_storage_(partition_storage),
+      pli_cache_(pli_cache),
       gen_(rd_()) {}
 
 std::unordered_set<Vertical> LatticeTraversal::FindLHSs() {
@@ -71,20 +71,10 @@ std::unordered_set<Vertical> LatticeTraversal::FindLHSs() {
                     }
                 } else if (!InferCategory(node, rhs_->GetIndex())) {
                     //if we were not able to infer category, we calculate the partitions
-                    auto node_pli = partition_storage_->GetOrCreateFor(node);
-                    auto node_pli_pointer =
-                        std::holds_alternative<util::PositionListIndex*>(node_pli)
-                            ? std::get<util::PositionListIndex*>(node_pli)
-                            : std::get<std::unique_ptr<util::PositionListIndex>>(node_pli).get();
-                    auto intersected_pli = partition_storage_->GetOrCreateFor(node.Union(*rhs_));
-                    auto intersected_pli_pointer =
-                        std::holds_alternative<util::PositionListIndex*>(intersected_pli)
-                            ? std::get<util::PositionListIndex*>(intersected_pli)
-                            : std::get<std::unique_ptr<util::PositionListIndex>>(intersected_pli)
-                                  .get();
-
-                    if (node_pli_pointer->GetNepAsLong() ==
-                        intersected_pli_pointer->GetNepAsLong()) {
+                    auto node_pli = pli_cache_->GetOrCreateFor(node);
+                    auto intersected_stats = pli_cache_->GetStatsFor(node.Union(*rhs_));
+
+                    if (node_pli->GetNepAsLong() == intersected_stats.nep) {
                         observations_.UpdateDependencyCategory(node);
                         if (observations_[node] == NodeCategory::kMinimalDependency) {
                             minimal_deps_.insert(node);
@@ -200,31 +190,30 @@ std::stack<Vertical> LatticeTraversal::GenerateNextSeeds(Column const* const cur
     std::unordered_set<Vertical> new_seeds;
 
     for (auto const& non_dep : maximal_non_deps_) {
-        auto complement_indices = non_dep.GetColumnIndicesRef();
-        complement_indices[current_rhs->GetIndex()] = true;
+        ColumnSet complement_indices = non_dep.GetColumnSet();
+        complement_indices.set(current_rhs->GetIndex());
         complement_indices.flip();
 
         if (seeds.empty()) {
-            boost::dynamic_bitset<> single_column_bitset(relation_->GetNumColumns(), 0);
-            single_column_bitset.reset();
+            ColumnSet single_column_bitset(relation_->GetNumColumns());
 
             for (size_t column_index = complement_indices.find_first();
                  column_index < complement_indices.size();
                  column_index = complement_indices.find_next(column_index)) {
-                single_column_bitset[column_index] = true;
+                single_column_bitset.set(column_index);
                 seeds.emplace(relation_->GetSchema(), single_column_bitset);
-                single_column_bitset[column_index] = false;
+                single_column_bitset.reset(column_index);
             }
         } else {
             for (auto const& dependency : seeds) {
-                auto new_combination = dependency.GetColumnIndicesRef();
+                ColumnSet new_combination = dependency.GetColumnSet();
 
                 for (size_t column_index = complement_indices.find_first();
                      column_index < complement_indices.size();
                      column_index = complement_indices.find_next(column_index)) {
-                    new_combination[column_index] = true;
+                    new_combination.set(column_index);
                     new_seeds.emplace(relation_->GetSchema(), new_combination);
-                    new_combination[column_index] = dependency.GetColumnIndicesRef()[column_index];
+                    new_combination.set(column_index, dependency.GetColumnSet()[column_index]);
                 }
             }
 
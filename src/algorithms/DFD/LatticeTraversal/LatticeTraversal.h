@@ -7,7 +7,7 @@
 #include "DFD/LatticeObservations/LatticeObservations.h"
 #include "DFD/PruningMaps/DependenciesMap.h"
 #include "DFD/PruningMaps/NonDependenciesMap.h"
-#include "DFD/PartitionStorage/PartitionStorage.h"
+#include "PLICache.h"
 
 class LatticeTraversal {
 private:
@@ -23,7 +23,7 @@ private:
 
     std::vector<Vertical> const& unique_columns_;
     ColumnLayoutRelationData const* const relation_;
-    PartitionStorage* const partition_storage_;
+    util::PLICache* const pli_cache_;
 
     std::random_device rd_;
     std::mt19937 gen_;
@@ -40,7 +40,7 @@ private:
 public:
     LatticeTraversal(Column const* const rhs, ColumnLayoutRelationData const* const relation,
                      std::vector<Vertical> const& unique_verticals,
-                     PartitionStorage* const partition_storage);
+                     util::PLICache* const pli_cache);
 
     std::unordered_set<Vertical> FindLHSs();
 };
@@ -118,13 +118,13 @@ void FDep::LoadData() {
         this->schema_->AppendColumn(this->column_names_[i]);
     }
 
-    std::vector<std::string> next_line;
+    std::vector<std::string_view> next_line;
     while (input_generator_.GetHasNext()) {
-        next_line = input_generator_.ParseNext();
+        input_generator_.ParseNext(next_line);
         if (next_line.empty()) break;
         this->tuples_.emplace_back(std::vector<size_t>(this->number_attributes_));
         for (size_t i = 0; i < this->number_attributes_; ++i) {
-            this->tuples_.back()[i] = std::hash<std::string>{}(next_line[i]);
+            this->tuples_.back()[i] = std::hash<std::string_view>{}(next_line[i]);
         }
     }
 }
@@ -91,24 +91,21 @@ void FUN::ComputeQuasiClosure(Level const& l_k_minus_1, Level& l_k) const {
 
 unsigned long FUN::Count(Vertical const& l) const {
     std::vector<ColumnData> const& column_data = relation_->GetColumnData();
-    size_t first_column_index = l.GetColumnIndices().find_first();
+    size_t first_column_index = l.GetColumnSet().find_first();
 
     util::PositionListIndex const* pli = column_data.at(first_column_index).GetPositionListIndex();
 
-    if (l.GetColumnIndices().count() == 1) {
+    if (l.GetColumnSet().count() == 1) {
         return pli->GetNumCluster();
     }
 
-    //  workaround to avoid auto-destruction of plis
-    std::unique_ptr<util::PositionListIndex> holder;
-
-    for (size_t i = l.GetColumnIndices().find_next(first_column_index);
-         i != boost::dynamic_bitset<>::npos; i = l.GetColumnIndices().find_next(i)) {
-        pli->Intersect(column_data.at(i).GetPositionListIndex()).swap(holder);
-        pli = holder.get();
+    std::vector<util::PositionListIndex const*> plis{pli};
+    for (size_t i = l.GetColumnSet().find_next(first_column_index);
+         i != boost::dynamic_bitset<>::npos; i = l.GetColumnSet().find_next(i)) {
+        plis.push_back(column_data.at(i).GetPositionListIndex());
     }
 
-    return pli->GetNumCluster();
+    return util::PositionListIndex::GetIntersectionStats(std::move(plis)).num_clusters;
 }
 
 unsigned long FUN::FastCount(Level const& l_k_minus_1, Level const& l_k,
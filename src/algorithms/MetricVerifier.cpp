@@ -25,12 +25,9 @@ MetricVerifier::MetricVerifier(Config const& config)
     if (metric_ != +Metric::euclidean || rhs_indices_.size() != 1) {
         algo_ = MetricAlgo::_from_string(config.algo.c_str());
     }
-    relation_ =
-        ColumnLayoutRelationData::CreateFrom(input_generator_, config.is_null_equal_null);
-    input_generator_.Reset();
-    typed_relation_ =
-        model::ColumnLayoutTypedRelationData::CreateFrom(input_generator_,
-                                                         config.is_null_equal_null);
+    std::tie(relation_, typed_relation_) =
+        model::ColumnLayoutTypedRelationData::CreateWithUntypedFrom(input_generator_,
+                                                                    config.is_null_equal_null);
 }
 
 MetricVerifier::MetricVerifier(Config const& config,
@@ -106,11 +103,17 @@ bool MetricVerifier::VerifyMetricFD() const {
     std::shared_ptr<util::PLI const>
         pli = relation_->GetColumnData(lhs_indices_[0]).GetPliOwnership();
 
-    for (size_t i = 1; i < lhs_indices_.size(); ++i) {
-        pli = pli->Intersect(relation_->GetColumnData(lhs_indices_[i]).GetPositionListIndex());
+    if (lhs_indices_.size() > 1) {
+        std::vector<util::PLI const*> probing_plis;
+        for (size_t i = 1; i < lhs_indices_.size(); ++i) {
+            probing_plis.push_back(
+                relation_->GetColumnData(lhs_indices_[i]).GetPositionListIndex());
+        }
+        pli = pli->ProbeAll(std::move(probing_plis));
     }
 
-    return std::all_of(pli->GetIndex().cbegin(), pli->GetIndex().cend(), GetCompareFunction());
+    util::PLI::ClusterCollection const clusters = pli->GetClusters();
+    return std::all_of(clusters.cbegin(), clusters.cend(), GetCompareFunction());
 }
 
 MetricVerifier::CompareFunction MetricVerifier::GetCompareFunction() const {
@@ -121,14 +124,14 @@ MetricVerifier::CompareFunction MetricVerifier::GetCompareFunction() const {
             if (!col.IsNumeric()) {
                 throw std::runtime_error("\"euclidean\" metric does not match RHS column type.");
             }
-            return [this](util::PLI::Cluster const& cluster) {
+            return [this](util::PLI::ClusterSpan cluster) {
                 return CompareNumericValues(cluster);
             };
         case Metric::levenshtein:
             if (col.GetTypeId() != +model::TypeId::kString) {
                 throw std::runtime_error("\"levenshtein\" metric does not match RHS column type.");
             }
-            return [this, &col](util::PLI::Cluster const& cluster) {
+            return [this, &col](util::PLI::ClusterSpan cluster) {
                 auto const& type = dynamic_cast<model::StringType const&>(col.GetType());
                 return CompareStringValues(
                     cluster, [&type](std::byte const* a, std::byte const* b) {
@@ -139,7 +142,7 @@ MetricVerifier::CompareFunction MetricVerifier::GetCompareFunction() const {
             if (col.GetTypeId() != +model::TypeId::kString) {
                 throw std::runtime_error("\"cosine\" metric does not match RHS column type.");
             }
-            return [this, &col](util::PLI::Cluster const& cluster) {
+            return [this, &col](util::PLI::ClusterSpan cluster) {
                 auto const& type = dynamic_cast<model::StringType const&>(col.GetType());
                 std::unordered_map<std::string, util::QGramVector> q_gram_map;
                 return CompareStringValues(cluster, GetCosineDistFunction(type, q_gram_map));
@@ -147,11 +150,11 @@ MetricVerifier::CompareFunction MetricVerifier::GetCompareFunction() const {
         }
     }
     if (algo_ == +MetricAlgo::calipers) {
-        return [this](util::PLI::Cluster const& cluster) {
+        return [this](util::PLI::ClusterSpan cluster) {
             return CalipersCompareNumericValues(cluster);
         };
     }
-    return [this](util::PLI::Cluster const& cluster) {
+    return [this](util::PLI::ClusterSpan cluster) {
         return CompareNumericMultiDimensionalValues(cluster);
     };
 }
@@ -172,7 +175,7 @@ MetricVerifier::DistanceFunction MetricVerifier::GetCosineDistFunction(
     };
 }
 
-bool MetricVerifier::CompareNumericValues(util::PLI::Cluster const& cluster) const {
+bool MetricVerifier::CompareNumericValues(util::PLI::ClusterSpan cluster) const {
     model::TypedColumnData const& col = typed_relation_->GetColumnData(rhs_indices_[0]);
     auto const& type = dynamic_cast<model::INumericType const&>(col.GetType());
     std::vector<std::byte const*> const& data = col.GetData();
@@ -200,7 +203,7 @@ bool MetricVerifier::CompareNumericValues(util::PLI::Cluster const& cluster) con
 }
 
 bool MetricVerifier::CompareStringValues(
-    util::PLI::Cluster const& cluster, DistanceFunction const& dist_func) const {
+    util::PLI::ClusterSpan cluster, DistanceFunction const& dist_func) const {
     model::TypedColumnData const& col = typed_relation_->GetColumnData(rhs_indices_[0]);
     std::vector<std::byte const*> const& data = col.GetData();
     for (size_t i = 0; i < cluster.size() - 1; ++i) {
@@ -235,7 +238,7 @@ static long double GetDistanceBetweenPoints(std::vector<long double> const& p1,
 
 template <typename T>
 std::vector<T> MetricVerifier::GetVectorOfPoints(
-    util::PLI::Cluster const& cluster,
+    util::PLI::ClusterSpan cluster,
     std::function<void(T&, long double, size_t)> const& assignment_func) const {
     std::vector<T> points;
     for (int i : cluster) {
@@ -266,7 +269,7 @@ std::vector<T> MetricVerifier::GetVectorOfPoints(
     return points;
 }
 
-bool MetricVerifier::CompareNumericMultiDimensionalValues(util::PLI::Cluster const& cluster) const {
+bool MetricVerifier::CompareNumericMultiDimensionalValues(util::PLI::ClusterSpan cluster) const {
     auto points = GetVectorOfPoints<std::vector<long double>>(
         cluster, [](auto& point, long double coord, [[maybe_unused]] size_t j) {
             point.push_back(coord);
@@ -283,7 +286,7 @@ bool MetricVerifier::CompareNumericMultiDimensionalValues(util::PLI::Cluster con
     return true;
 }
 
-bool MetricVerifier::CalipersCompareNumericValues(const util::PLI::Cluster& cluster) const {
+bool MetricVerifier::CalipersCompareNumericValues(util::PLI::ClusterSpan cluster) const {
     auto points = GetVectorOfPoints<util::Point>(
         cluster, [](auto& point, long double coord, size_t j) {
             if (j == 0) point.x = coord;
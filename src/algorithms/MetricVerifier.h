@@ -37,7 +37,7 @@ BETTER_ENUM(MetricAlgo, char,
 class MetricVerifier : public algos::Primitive {
 private:
     using DistanceFunction = std::function<long double(std::byte const*, std::byte const*)>;
-    using CompareFunction = std::function<bool(util::PLI::Cluster const& cluster)>;
+    using CompareFunction = std::function<bool(util::PLI::ClusterSpan cluster)>;
 
     Metric metric_;
     MetricAlgo algo_ = MetricAlgo::_values()[0];
@@ -50,10 +50,10 @@ private:
     bool metric_fd_holds_ = false;
 
     std::shared_ptr<model::ColumnLayoutTypedRelationData> typed_relation_;
-    std::shared_ptr<ColumnLayoutRelationData> relation_; // temporarily parsing twice
+    std::shared_ptr<ColumnLayoutRelationData> relation_;
 
-    bool CompareNumericValues(util::PLI::Cluster const& cluster) const;
-    bool CompareStringValues(util::PLI::Cluster const& cluster,
+    bool CompareNumericValues(util::PLI::ClusterSpan cluster) const;
+    bool CompareStringValues(util::PLI::ClusterSpan cluster,
                              DistanceFunction const& dist_func) const;
     DistanceFunction GetCosineDistFunction(
         model::StringType const& type,
@@ -61,11 +61,11 @@ private:
 
     template <typename T>
     std::vector<T> GetVectorOfPoints(
-        util::PLI::Cluster const& cluster,
+        util::PLI::ClusterSpan cluster,
         std::function<void(T&, long double, size_t)> const& assignment_func) const;
 
-    bool CompareNumericMultiDimensionalValues(util::PLI::Cluster const& cluster) const;
-    bool CalipersCompareNumericValues(util::PLI::Cluster const& cluster) const;
+    bool CompareNumericMultiDimensionalValues(util::PLI::ClusterSpan cluster) const;
+    bool CalipersCompareNumericValues(util::PLI::ClusterSpan cluster) const;
     CompareFunction GetCompareFunction() const;
     bool VerifyMetricFD() const;
     void ValidateParameters() const;
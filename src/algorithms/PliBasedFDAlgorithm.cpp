@@ -1,9 +1,17 @@
 #include "PliBasedFDAlgorithm.h"
 
+#include "ProgramOptionStrings.h"
+
+namespace posr = program_option_strings;
+
 void PliBasedFDAlgorithm::Initialize() {
-    if (relation_ == nullptr) {
-        relation_ =
-            ColumnLayoutRelationData::CreateFrom(input_generator_, config_.is_null_equal_null);
+    if (relation_ == nullptr && config_.HasParam(posr::SnapshotDirectory)) {
+        relation_ = ColumnLayoutRelationData::CreateFrom(
+            input_generator_, config_.is_null_equal_null,
+            GetSpecialParam<std::string>(posr::SnapshotDirectory), config_.parallelism);
+    } else if (relation_ == nullptr) {
+        relation_ = ColumnLayoutRelationData::CreateFrom(
+            input_generator_, config_.is_null_equal_null, -1, -1, config_.parallelism);
     }
 
     if (relation_->GetColumnData().empty()) {
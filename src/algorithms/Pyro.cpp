@@ -1,17 +1,47 @@
 #include "Pyro.h"
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <list>
 #include <mutex>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <unordered_map>
 
 #include <easylogging++.h>
 
 #include "FdG1Strategy.h"
 #include "KeyG1Strategy.h"
+#include "PLICache.h"
+#include "ProgramOptionStrings.h"
 
 namespace algos {
 
-std::mutex searchSpacesMutex;
+namespace posr = program_option_strings;
+
+namespace {
+
+CachingMethod ParseCachingMethod(std::string const& name) {
+    static std::unordered_map<std::string, CachingMethod> const caching_methods = {
+        {"coin", CachingMethod::kCoin},
+        {"none", CachingMethod::kNoCaching},
+        {"all", CachingMethod::kAllCaching},
+        {"entropy", CachingMethod::kEntropy},
+        {"uniqueness", CachingMethod::kTrueUniquenessEntropy},
+        {"mean_entropy", CachingMethod::kMeanEntropyThreshold},
+        {"q2", CachingMethod::kHeuristicQ2},
+        {"gini", CachingMethod::kGini},
+        {"inverted_entropy", CachingMethod::kInvertedEntropy}};
+    auto it = caching_methods.find(name);
+    if (it == caching_methods.end()) {
+        throw std::invalid_argument("Unknown PLI caching method: " + name);
+    }
+    return it->second;
+}
+
+}  // namespace
 
 unsigned long long Pyro::ExecuteInternal() {
     auto start_time = std::chrono::system_clock::now();
@@ -66,39 +96,146 @@ unsigned long long Pyro::ExecuteInternal() {
     unsigned long long total_trickle = 0;
     double progress_step = 100.0 / search_spaces_.size();
 
-    const auto work_on_search_space = [this, &progress_step](
-        std::list<std::unique_ptr<SearchSpace>>& search_spaces,
-        ProfilingContext* profiling_context, int id) {
-        unsigned long long millis = 0;
-        while (true) {
-            auto thread_start_time = std::chrono::system_clock::now();
-            std::unique_ptr<SearchSpace> polled_space;
-            {
-                std::scoped_lock<std::mutex> lock(searchSpacesMutex);
-                if (search_spaces.empty()) {
-                    break;
-                }
-                polled_space = std::move(search_spaces.front());
-                search_spaces.pop_front();
+    /* Threads take whole search spaces first. Once none is left, idle threads join the search
+     * spaces that still have launch pads, top-level ones as well as the nested ones of trickling
+     * down, so a few hard search spaces do not leave the other threads idle at the end of the
+     * run */
+    enum class SearchSpaceState { kNew, kInitializing, kDiscovering, kFinished };
+    struct ScheduledSearchSpace {
+        SearchSpace* search_space;
+        /* Null for the nested search spaces, they are owned by the threads that create them */
+        std::unique_ptr<SearchSpace> owned_search_space;
+        SearchSpaceState state = SearchSpaceState::kNew;
+        int num_threads = 0;
+    };
+    /* A list, so that the nested search spaces can come and go while others are scheduled */
+    std::list<ScheduledSearchSpace> scheduled_spaces;
+    for (auto& search_space : search_spaces_) {
+        SearchSpace* search_space_ptr = search_space.get();
+        scheduled_spaces.push_back({search_space_ptr, std::move(search_space)});
+    }
+    search_spaces_.clear();
+    std::size_t const num_spaces = scheduled_spaces.size();
+    std::size_t num_finished_spaces = 0;
+    int const max_threads_per_search_space = configuration_.max_threads_per_search_space;
+    std::mutex scheduler_mutex;
+    std::condition_variable scheduler_condition;
+
+    const auto launch_pads_listener = [&scheduler_mutex, &scheduler_condition]() {
+        /* Synchronizes with the threads checking for launch pads before they wait */
+        { std::scoped_lock lock(scheduler_mutex); }
+        scheduler_condition.notify_all();
+    };
+    const auto share_nested_space = [&scheduled_spaces, &scheduler_mutex,
+                                     &scheduler_condition](SearchSpace* nested_space) {
+        {
+            std::scoped_lock lock(scheduler_mutex);
+            scheduled_spaces.push_back({nested_space, nullptr, SearchSpaceState::kDiscovering});
+        }
+        scheduler_condition.notify_all();
+    };
+    /* Waits until the threads that joined the nested search space leave it */
+    const auto withdraw_nested_space = [&scheduled_spaces, &scheduler_mutex,
+                                        &scheduler_condition](SearchSpace* nested_space) {
+        std::unique_lock lock(scheduler_mutex);
+        auto it = std::find_if(scheduled_spaces.begin(), scheduled_spaces.end(),
+                               [nested_space](ScheduledSearchSpace const& scheduled_space) {
+                                   return scheduled_space.owned_search_space == nullptr &&
+                                          scheduled_space.search_space == nested_space;
+                               });
+        it->state = SearchSpaceState::kFinished;
+        scheduler_condition.wait(lock, [&it]() { return it->num_threads == 0; });
+        scheduled_spaces.erase(it);
+    };
+    for (auto& scheduled_space : scheduled_spaces) {
+        scheduled_space.search_space->SetContext(profiling_context.get());
+        scheduled_space.search_space->SetLaunchPadsListener(launch_pads_listener);
+        scheduled_space.search_space->SetNestedSearchSpaceListeners(share_nested_space,
+                                                                    withdraw_nested_space);
+    }
+
+    /* Must be called with scheduler_mutex held */
+    const auto poll_search_space = [&scheduled_spaces,
+                                    max_threads_per_search_space]() -> ScheduledSearchSpace* {
+        for (auto& scheduled_space : scheduled_spaces) {
+            if (scheduled_space.state == SearchSpaceState::kNew) {
+                return &scheduled_space;
             }
-            LOG(TRACE) << "Thread" << id << " got SearchSpace";
-            polled_space->SetContext(profiling_context);
-            polled_space->EnsureInitialized();
-            polled_space->Discover();
-            AddProgress(progress_step);
-
-            millis += std::chrono::duration_cast<std::chrono::milliseconds>(
-                          std::chrono::system_clock::now() - thread_start_time)
-                          .count();
         }
-        //cout << "Thread" << id << " stopped working, ELAPSED TIME: " << millis << "ms.\n";
+        ScheduledSearchSpace* polled_space = nullptr;
+        for (auto& scheduled_space : scheduled_spaces) {
+            if (scheduled_space.state != SearchSpaceState::kDiscovering ||
+                (max_threads_per_search_space > 0 &&
+                 scheduled_space.num_threads >= max_threads_per_search_space) ||
+                (polled_space != nullptr &&
+                 scheduled_space.num_threads >= polled_space->num_threads) ||
+                !scheduled_space.search_space->HasLaunchPads()) {
+                continue;
+            }
+            polled_space = &scheduled_space;
+        }
+        return polled_space;
+    };
+
+    /* A thread waiting for work lends its core to the samples of the working threads and takes
+     * it back before it polls again */
+    const auto work_on_search_spaces = [this, &progress_step, &num_spaces, &num_finished_spaces,
+                                        &scheduler_mutex, &scheduler_condition,
+                                        &poll_search_space, &profiling_context](int id) {
+        std::unique_lock lock(scheduler_mutex);
+        bool is_idle = false;
+        while (num_finished_spaces != num_spaces) {
+            if (is_idle) {
+                lock.unlock();
+                profiling_context->ReclaimIdleThread();
+                lock.lock();
+                is_idle = false;
+                continue;
+            }
+            ScheduledSearchSpace* polled_space = poll_search_space();
+            if (polled_space == nullptr) {
+                profiling_context->LendIdleThread();
+                is_idle = true;
+                scheduler_condition.wait(lock);
+                continue;
+            }
+            polled_space->num_threads++;
+            SearchSpace* search_space = polled_space->search_space;
+            if (polled_space->state == SearchSpaceState::kNew) {
+                LOG(TRACE) << "Thread" << id << " got SearchSpace";
+                polled_space->state = SearchSpaceState::kInitializing;
+                lock.unlock();
+                search_space->EnsureInitialized();
+                lock.lock();
+                polled_space->state = SearchSpaceState::kDiscovering;
+                scheduler_condition.notify_all();
+            } else {
+                LOG(TRACE) << "Thread" << id << " joined SearchSpace";
+            }
+            lock.unlock();
+            search_space->Discover();
+            lock.lock();
+
+            if (--polled_space->num_threads == 0 && polled_space->owned_search_space != nullptr &&
+                search_space->IsExhausted()) {
+                polled_space->state = SearchSpaceState::kFinished;
+                polled_space->owned_search_space.reset();
+                // a nested search space may be allocated at the same address later
+                polled_space->search_space = nullptr;
+                num_finished_spaces++;
+                AddProgress(progress_step);
+            }
+            scheduler_condition.notify_all();
+        }
+        if (is_idle) {
+            lock.unlock();
+            profiling_context->ReclaimIdleThread();
+        }
     };
 
     std::vector<std::thread> threads;
     for (int i = 0; i < configuration_.parallelism; i++) {
-        //std::thread();
-        threads.emplace_back(work_on_search_space, std::ref(search_spaces_),
-                             profiling_context.get(), i);
+        threads.emplace_back(work_on_search_spaces, i);
     }
 
     for (int i = 0; i < configuration_.parallelism; i++) {
@@ -118,6 +255,13 @@ unsigned long long Pyro::ExecuteInternal() {
     LOG(INFO) << "Total trickle time: " << total_trickle << "ms";
     LOG(INFO) << "Total intersection time: "
               << util::PositionListIndex::micros_ / 1000 << "ms";
+    LOG(INFO) << "Total intersections: " << util::PositionListIndex::intersection_count_
+              << " (" << util::PositionListIndex::GetIntersectionsPerSecond() << " per second)";
+    util::PLICache const* pli_cache = profiling_context->GetPliCache();
+    LOG(INFO) << "PLI cache: " << pli_cache->GetHits() << " hits, " << pli_cache->GetMisses()
+              << " misses (hit rate " << pli_cache->GetHitRate() << "), "
+              << pli_cache->GetEvictions() << " evictions, "
+              << pli_cache->GetMemoryUsage() / 1024 << " KiB in use";
     LOG(INFO) << "HASH: " << PliBasedFDAlgorithm::Fletcher16();
     return elapsed_milliseconds.count();
 }
@@ -135,6 +279,16 @@ void Pyro::init() {
     configuration_.max_ucc_error = GetSpecialParam<double>(kMaxError);
     configuration_.max_lhs = config_.max_lhs;
     configuration_.parallelism = config_.parallelism;
+    if (config_.HasParam(posr::PliCacheLimit)) {
+        configuration_.pli_cache_memory_limit =
+            static_cast<std::size_t>(GetSpecialParam<unsigned int>(posr::PliCacheLimit)) << 20;
+    }
+    if (config_.HasParam(posr::PliCaching)) {
+        caching_method_ = ParseCachingMethod(GetSpecialParam<std::string>(posr::PliCaching));
+    }
+    if (config_.HasParam(posr::PliCachingValue)) {
+        caching_method_value_ = GetSpecialParam<double>(posr::PliCachingValue);
+    }
 }
 
 Pyro::Pyro(Config const& config) : PliBasedFDAlgorithm(config, {kDefaultPhaseName}) {
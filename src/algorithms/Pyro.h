@@ -18,8 +18,8 @@ private:
     std::list<std::unique_ptr<SearchSpace>> search_spaces_;
 
     CachingMethod caching_method_ = CachingMethod::kCoin;
-    CacheEvictionMethod eviction_method_ = CacheEvictionMethod::kDefault;
-    double caching_method_value_;
+    CacheEvictionMethod eviction_method_ = CacheEvictionMethod::kHottoRemain;
+    double caching_method_value_ = 1;
 
     Configuration configuration_;
 
@@ -4,6 +4,7 @@
 #include <iomanip>
 #include <list>
 #include <memory>
+#include <unordered_map>
 
 #include <easylogging++.h>
 
@@ -29,9 +30,19 @@ double Tane::CalculateFdError(util::PositionListIndex const* lhs_pli,
            static_cast<double>(relation_data->GetNumTuplePairs());
 }
 
+double Tane::CalculateFdError(unsigned long long lhs_nep, unsigned long long joint_nep,
+                              ColumnLayoutRelationData const* relation_data) {
+    return (double)(lhs_nep - joint_nep) / static_cast<double>(relation_data->GetNumTuplePairs());
+}
+
 double Tane::CalculateUccError(util::PositionListIndex const* pli,
                                ColumnLayoutRelationData const* relation_data) {
-    return pli->GetNepAsLong() / static_cast<double>(relation_data->GetNumTuplePairs());
+    return CalculateUccError(pli->GetNepAsLong(), relation_data);
+}
+
+double Tane::CalculateUccError(unsigned long long nep,
+                               ColumnLayoutRelationData const* relation_data) {
+    return nep / static_cast<double>(relation_data->GetNumTuplePairs());
 }
 
 void Tane::RegisterFd(Vertical const& lhs, Column const* rhs,
@@ -114,7 +125,7 @@ unsigned long long Tane::ExecuteInternal() {
 
         // вот тут костыль, чтобы вытянуть индекс колонки из вершины, в которой только один индекс
         ColumnData const& column_data =
-            relation_->GetColumnData(column.GetColumnIndices().find_first());
+            relation_->GetColumnData(column.GetColumnSet().find_first());
         double ucc_error = CalculateUccError(column_data.GetPositionListIndex(), relation_.get());
         if (ucc_error <= max_ucc_error_) {
             RegisterUcc(column, ucc_error, schema);
@@ -123,7 +134,7 @@ unsigned long long Tane::ExecuteInternal() {
                 for (unsigned long rhs_index = vertex->GetRhsCandidates().find_first();
                      rhs_index < vertex->GetRhsCandidates().size();
                      rhs_index = vertex->GetRhsCandidates().find_next(rhs_index)) {
-                    if (rhs_index != column.GetColumnIndices().find_first()) {
+                    if (rhs_index != column.GetColumnSet().find_first()) {
                         RegisterFd(column, schema->GetColumn(rhs_index), 0, schema);
                     }
                 }
@@ -151,6 +162,10 @@ unsigned long long Tane::ExecuteInternal() {
         if (level->GetVertices().empty()) {
             break;
         }
+        /* PLIs of the last level are never intersected further, so only their NEPs are needed
+         * and they can be obtained without materializing the clusters */
+        bool const is_last_level = arity == max_lhs_;
+        std::unordered_map<util::LatticeVertex const*, unsigned long long> xa_neps;
 
         for (auto& [key_map, xa_vertex] : level->GetVertices()) {
             if (xa_vertex->GetIsInvalid()) {
@@ -159,11 +174,20 @@ unsigned long long Tane::ExecuteInternal() {
 
             Vertical xa = xa_vertex->GetVertical();
             //Calculate XA PLI
-            if (xa_vertex->GetPositionListIndex() == nullptr) {
+            unsigned long long xa_nep;
+            if (xa_vertex->GetPositionListIndex() != nullptr) {
+                xa_nep = xa_vertex->GetPositionListIndex()->GetNepAsLong();
+            } else {
                 auto parent_pli_1 = xa_vertex->GetParents()[0]->GetPositionListIndex();
                 auto parent_pli_2 = xa_vertex->GetParents()[1]->GetPositionListIndex();
-                xa_vertex->AcquirePositionListIndex(parent_pli_1->Intersect(parent_pli_2));
+                if (is_last_level) {
+                    xa_nep = parent_pli_1->GetIntersectionNep(parent_pli_2);
+                } else {
+                    xa_vertex->AcquirePositionListIndex(parent_pli_1->Intersect(parent_pli_2));
+                    xa_nep = xa_vertex->GetPositionListIndex()->GetNepAsLong();
+                }
             }
+            xa_neps.emplace(xa_vertex.get(), xa_nep);
 
             dynamic_bitset<> xa_indices = xa.GetColumnIndices();
             dynamic_bitset<> a_candidates = xa_vertex->GetRhsCandidates();
@@ -184,9 +208,7 @@ unsigned long long Tane::ExecuteInternal() {
 
                 // Check X -> A
                 double error = CalculateFdError(
-                    x_vertex->GetPositionListIndex(),
-                    xa_vertex->GetPositionListIndex(),
-                    relation_.get());
+                    x_vertex->GetPositionListIndex()->GetNepAsLong(), xa_nep, relation_.get());
                 if (error <= max_fd_error_) {
                     Column const* rhs = schema->GetColumns()[a_index].get();
 
@@ -207,8 +229,7 @@ unsigned long long Tane::ExecuteInternal() {
             Vertical columns = vertex->GetVertical();  // Originally it's a ColumnCombination
 
             if (vertex->GetIsKeyCandidate()) {
-                double ucc_error =
-                    CalculateUccError(vertex->GetPositionListIndex(), relation_.get());
+                double ucc_error = CalculateUccError(xa_neps.at(vertex.get()), relation_.get());
                 if (ucc_error <= max_ucc_error_) {       //If a key candidate is an approx UCC
                     //TODO: do smth with UCC
 
@@ -229,7 +250,7 @@ unsigned long long Tane::ExecuteInternal() {
                                         level->GetLatticeVertex(sibling.GetColumnIndices());
                                     if (sibling_vertex == nullptr ||
                                         !sibling_vertex->GetConstRhsCandidates()
-                                             [rhs.GetColumnIndices().find_first()]) {
+                                             [rhs.GetColumnSet().find_first()]) {
                                         is_rhs_candidate = false;
                                         break;
                                     }
@@ -269,6 +290,7 @@ unsigned long long Tane::ExecuteInternal() {
     LOG(INFO) << "Intersection time: " << util::PositionListIndex::micros_ / 1000
               << "ms";
     LOG(INFO) << "Total intersections: " << util::PositionListIndex::intersection_count_
+              << " (" << util::PositionListIndex::GetIntersectionsPerSecond() << " per second)"
               << std::endl;
     LOG(INFO) << "Total FD count: " << count_of_fd_;
     LOG(INFO) << "Total UCC count: " << count_of_ucc_;
@@ -41,8 +41,12 @@ public:
     static double CalculateFdError(util::PositionListIndex const* lhs_pli,
                                    util::PositionListIndex const* joint_pli,
                                    ColumnLayoutRelationData const* relation_data);
+    static double CalculateFdError(unsigned long long lhs_nep, unsigned long long joint_nep,
+                                   ColumnLayoutRelationData const* relation_data);
     static double CalculateUccError(util::PositionListIndex const* pli,
                                     ColumnLayoutRelationData const* relation_data);
+    static double CalculateUccError(unsigned long long nep,
+                                    ColumnLayoutRelationData const* relation_data);
 
     //static double round(double error) { return ((int)(error * 32768) + 1)/ 32768.0; }
 
@@ -55,18 +55,18 @@ std::vector<util::PLI::Cluster> TypoMiner::FindClustersWithTypos(FD const& typos
         return {cluster};
     }
 
-    for (Column const* col : lhs_columns) {
-        ColumnData const& col_data = relation_->GetColumnData(col->GetIndex());
-        std::shared_ptr<util::PLI const> pli = col_data.GetPliOwnership();
-
-        if (intersection_pli == nullptr) {
-            intersection_pli = pli;
-        } else {
-            intersection_pli = intersection_pli->Intersect(pli.get());
+    intersection_pli =
+        relation_->GetColumnData(lhs_columns.front()->GetIndex()).GetPliOwnership();
+    if (lhs_columns.size() > 1) {
+        std::vector<util::PLI const*> probing_plis;
+        for (auto it = std::next(lhs_columns.begin()); it != lhs_columns.end(); ++it) {
+            probing_plis.push_back(
+                relation_->GetColumnData((*it)->GetIndex()).GetPositionListIndex());
         }
+        intersection_pli = intersection_pli->ProbeAll(std::move(probing_plis));
     }
 
-    for (util::PLI::Cluster const& cluster : intersection_pli->GetIndex()) {
+    for (util::PLI::ClusterSpan cluster : intersection_pli->GetClusters()) {
         int cluster_rhs_value = -1;
 
         /* Check if fd has wrong rhs values in this cluster */
@@ -89,7 +89,7 @@ std::vector<util::PLI::Cluster> TypoMiner::FindClustersWithTypos(FD const& typos
              * So I decided to leave it as it is until we know for sure that this place causes
              * performance problems.
              */
-            clusters.push_back(cluster);
+            clusters.push_back(cluster.ToCluster());
 
             if (sort_clusters) {
                 sort_cluster(clusters.back());
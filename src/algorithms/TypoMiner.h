@@ -150,11 +150,11 @@ std::unique_ptr<TypoMiner> TypoMiner::CreateFrom(Config const& config) {
     Config precise_config = config;
     precise_config.special_params[posr::Error] = 0.0;
     CSVParser input_generator(config.data, config.separator, config.has_header);
-    std::shared_ptr<ColumnLayoutRelationData> relation =
-        ColumnLayoutRelationData::CreateFrom(input_generator, config.is_null_equal_null);
-    input_generator.Reset();
-    auto typed_relation = model::ColumnLayoutTypedRelationData::CreateFrom(
-        input_generator, config.is_null_equal_null);
+    std::shared_ptr<ColumnLayoutRelationData> relation;
+    std::unique_ptr<model::ColumnLayoutTypedRelationData> typed_relation;
+    std::tie(relation, typed_relation) =
+        model::ColumnLayoutTypedRelationData::CreateWithUntypedFrom(input_generator,
+                                                                    config.is_null_equal_null);
 
     double radius;
     double ratio;
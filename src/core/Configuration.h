@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 struct Configuration {
@@ -16,7 +17,7 @@ struct Configuration {
 
     //Traversal settings
     int parallelism = 0;
-    int max_threads_per_search_space = -1;
+    int max_threads_per_search_space = -1;  // not positive means no limit
     bool is_defer_failed_launch_pads = true;
     std::string launch_pad_order = "error";
 
@@ -31,7 +32,7 @@ struct Configuration {
 
     //Cache settings
     double caching_probability = 0.5;
-    unsigned int nary_intersection_size = 4;
+    std::size_t pli_cache_memory_limit = 0;  // in bytes, 0 means no limit
 
     //Miscellaneous settings
     bool is_check_estimates = false;
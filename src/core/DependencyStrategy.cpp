@@ -9,7 +9,7 @@ bool DependencyStrategy::ShouldResample(Vertical const& vertical, double boost_f
     if (current_sample->IsExact()) return false;
 
     // Get an estimate of the number of equality pairs in the vertical
-    util::PositionListIndex* pli = context_->GetPliCache()->Get(vertical);
+    std::shared_ptr<util::PositionListIndex> pli = context_->GetPliCache()->Get(vertical);
     double nep = pli != nullptr ? pli->GetNepAsLong()
                                 : current_sample->EstimateAgreements(vertical) *
                                       context_->GetColumnLayoutRelationData()->GetNumTuplePairs();
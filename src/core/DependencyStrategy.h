@@ -1,4 +1,7 @@
 #pragma once
+
+#include <atomic>
+
 #include "ProfilingContext.h"
 #include "DependencyCandidate.h"
 #include "DependencyConsumer.h"
@@ -16,7 +19,7 @@ public:
     double min_non_dependency_error_;
     double max_dependency_error_;
     ProfilingContext* context_;
-    mutable unsigned int calc_count_ = 0;
+    mutable std::atomic<unsigned int> calc_count_ = 0;
     /*
      * Create the initial candidate for the given SearchSpace
      * */
@@ -1,5 +1,3 @@
-#include <unordered_map>
-
 #include <easylogging++.h>
 
 #include "FdG1Strategy.h"
@@ -8,45 +6,6 @@
 
 unsigned long long FdG1Strategy::nanos_ = 0;
 
-double FdG1Strategy::CalculateG1(util::PositionListIndex* lhs_pli) const {
-    unsigned long long num_violations = 0;
-    std::unordered_map<int, int> value_counts;
-    std::vector<int> const& probing_table =
-        context_->GetColumnLayoutRelationData()->GetColumnData(rhs_->GetIndex()).GetProbingTable();
-
-    LOG(DEBUG) << boost::format{"Probing table size for %1%: %2%"} % rhs_->ToString()
-        % std::to_string(probing_table.size());
-
-    // Perform probing
-    int probing_table_value_id;
-    for (auto const& cluster : lhs_pli->GetIndex()) {
-        value_counts.clear();
-        for (int position : cluster) {
-            probing_table_value_id = probing_table[position];
-            //    auto now = std::chrono::system_clock::now();
-            if (probing_table_value_id != util::PositionListIndex::singleton_value_id_) {
-                value_counts[probing_table_value_id] += 1;
-                /*auto location = value_counts.find(probing_table_value_id);
-                if (location == value_counts.end()) {
-                    value_counts.emplace_hint(location, probing_table_value_id, 1);
-                } else {
-                    location->second += 1;
-                }*/
-            }
-            //    nanos_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - now).count();
-        }
-
-        unsigned long long num_violations_in_cluster = cluster.size() * (cluster.size() - 1) / 2;
-        for (auto const& [key, refined_cluster_size] : value_counts) {
-            num_violations_in_cluster -= static_cast<unsigned long long>(refined_cluster_size) *
-                                         (refined_cluster_size - 1) / 2;
-        }
-        num_violations += num_violations_in_cluster;
-    }
-
-    return CalculateG1(num_violations);
-}
-
 double FdG1Strategy::CalculateG1(double num_violating_tuple_pairs) const {
     unsigned long long num_tuple_pairs =
         context_->GetColumnLayoutRelationData()->GetNumTuplePairs();
@@ -80,15 +39,17 @@ double FdG1Strategy::CalculateError(Vertical const& lhs) const {
         }
         error = CalculateG1(rhs_pli->GetNip());
     } else {
-        auto lhs_pli = context_->GetPliCache()->GetOrCreateFor(lhs, context_);
-        auto lhs_pli_pointer =
-            std::holds_alternative<util::PositionListIndex*>(lhs_pli)
-                ? std::get<util::PositionListIndex*>(lhs_pli)
-                : std::get<std::unique_ptr<util::PositionListIndex>>(lhs_pli).get();
         auto joint_pli = context_->GetPliCache()->Get(lhs.Union(static_cast<Vertical>(*rhs_)));
-        error = joint_pli == nullptr
-                    ? CalculateG1(lhs_pli_pointer)
-                    : CalculateG1(lhs_pli_pointer->GetNepAsLong() - joint_pli->GetNepAsLong());
+        if (joint_pli == nullptr) {
+            util::PositionListIndex const* rhs_pli = context_->GetColumnLayoutRelationData()
+                                                         ->GetColumnData(rhs_->GetIndex())
+                                                         .GetPositionListIndex();
+            error = CalculateG1(
+                context_->GetPliCache()->GetG1ViolationsFor(lhs, rhs_pli, context_));
+        } else {
+            auto lhs_pli = context_->GetPliCache()->GetOrCreateFor(lhs, context_);
+            error = CalculateG1(lhs_pli->GetNepAsLong() - joint_pli->GetNepAsLong());
+        }
     }
     calc_count_++;
     return error;
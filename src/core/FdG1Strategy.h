@@ -7,7 +7,6 @@ class FdG1Strategy : public DependencyStrategy {
 private:
     Column const* rhs_;
 
-    double CalculateG1(util::PositionListIndex* lhs_pli) const;
     double CalculateG1(double num_violating_tuple_pairs) const;
     util::ConfidenceInterval CalculateG1(util::ConfidenceInterval const& num_violations) const;
 public:
@@ -30,10 +30,7 @@ void KeyG1Strategy::EnsureInitialized(SearchSpace* search_space) const {
 
 double KeyG1Strategy::CalculateError(Vertical const& key_candidate) const {
     auto pli = context_->GetPliCache()->GetOrCreateFor(key_candidate, context_);
-    auto pli_pointer = std::holds_alternative<util::PositionListIndex*>(pli)
-                           ? std::get<util::PositionListIndex*>(pli)
-                           : std::get<std::unique_ptr<util::PositionListIndex>>(pli).get();
-    double error = CalculateKeyError(pli_pointer);
+    double error = CalculateKeyError(pli.get());
     calc_count_++;
     return error;
 }
@@ -47,10 +44,7 @@ util::ConfidenceInterval KeyG1Strategy::CalculateKeyError(util::ConfidenceInterv
 DependencyCandidate KeyG1Strategy::CreateDependencyCandidate(Vertical const& vertical) const {
     if (vertical.GetArity() == 1) {
         auto pli = context_->GetPliCache()->GetOrCreateFor(vertical, context_);
-        auto pli_pointer = std::holds_alternative<util::PositionListIndex*>(pli)
-                               ? std::get<util::PositionListIndex*>(pli)
-                               : std::get<std::unique_ptr<util::PositionListIndex>>(pli).get();
-        double key_error = CalculateKeyError(pli_pointer->GetNepAsLong());
+        double key_error = CalculateKeyError(pli->GetNepAsLong());
         return DependencyCandidate(vertical, util::ConfidenceInterval(key_error), true);
     }
 
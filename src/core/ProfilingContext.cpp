@@ -1,10 +1,10 @@
 #include "ProfilingContext.h"
 
+#include <algorithm>
 #include <utility>
 
 #include <easylogging++.h>
 
-#include "ListAgreeSetSample.h"
 #include "PLICache.h"
 #include "VerticalMap.h"
 
@@ -31,7 +31,7 @@ ProfilingContext::ProfilingContext(Configuration configuration,
     if (configuration_.sample_size > 0) {
         auto schema = relation_data_->GetSchema();
         agree_set_samples_ =
-            std::make_unique<util::BlockingVerticalMap<util::AgreeSetSample>>(schema);
+            std::make_unique<util::ConcurrentVerticalMap<util::AgreeSetSample>>(schema);
         // TODO: сделать, чтобы при одном потоке agree_set_samples_ = std::make_unique<VerticalMap<AgreeSetSample>>(schema);
         for (auto& column : schema->GetColumns()) {
             CreateColumnFocusedSample(
@@ -47,7 +47,8 @@ ProfilingContext::ProfilingContext(Configuration configuration,
         relation_data_, caching_method, eviction_method, caching_method_value,
         GetMinEntropy(relation_data_), GetMeanEntropy(relation_data_),
         GetMedianEntropy(relation_data_), SetMaximumEntropy(relation_data_, caching_method),
-        GetMedianGini(relation_data_), GetMedianInvertedEntropy(relation_data_));
+        GetMedianGini(relation_data_), GetMedianInvertedEntropy(relation_data_),
+        configuration_.pli_cache_memory_limit);
     pli_cache_->SetMaximumEntropy(max_entropy);
     // TODO: partialFDScoring - for FD registration
 }
@@ -140,31 +141,59 @@ double ProfilingContext::SetMaximumEntropy(ColumnLayoutRelationData const* relat
 util::AgreeSetSample const* ProfilingContext::CreateFocusedSample(Vertical const& focus,
                                                                   double boost_factor) {
     auto pli = pli_cache_->GetOrCreateFor(focus, this);
-    auto pli_pointer = std::holds_alternative<util::PositionListIndex*>(pli)
-                           ? std::get<util::PositionListIndex*>(pli)
-                           : std::get<std::unique_ptr<util::PositionListIndex>>(pli).get();
-    std::unique_ptr<util::ListAgreeSetSample> sample = util::ListAgreeSetSample::CreateFocusedFor(
-        relation_data_,
-        focus,
-        pli_pointer,
-        configuration_.sample_size * boost_factor,
-        custom_random_
-    );
+    // Called from the search threads of Pyro, which occupy the parallelism, so the sample is only
+    // taken on the cores of the search threads waiting for work
+    unsigned int const num_borrowed_threads = BorrowIdleThreads(std::max(configuration_.parallelism, 1) - 1);
+    std::unique_ptr<util::AgreeSetSample> sample;
+    try {
+        sample = util::AgreeSetSample::CreateFocusedSample(
+            relation_data_, focus, pli.get(), configuration_.sample_size * boost_factor,
+            configuration_.seed, 1 + num_borrowed_threads);
+    } catch (...) {
+        ReturnIdleThreads(num_borrowed_threads);
+        throw;
+    }
+    ReturnIdleThreads(num_borrowed_threads);
     LOG(TRACE) << boost::format{"Creating sample focused on: %1%"} % focus.ToString();
     auto sample_ptr = sample.get();
     agree_set_samples_->Put(focus, std::move(sample));
     return sample_ptr;
 }
 
+void ProfilingContext::LendIdleThread() {
+    std::scoped_lock lock(idle_threads_mutex_);
+    num_idle_threads_++;
+}
+
+void ProfilingContext::ReclaimIdleThread() {
+    std::unique_lock lock(idle_threads_mutex_);
+    idle_threads_returned_.wait(lock, [this]() { return num_lent_threads_ < num_idle_threads_; });
+    num_idle_threads_--;
+}
+
+unsigned int ProfilingContext::BorrowIdleThreads(unsigned int max_threads) {
+    std::scoped_lock lock(idle_threads_mutex_);
+    unsigned int const num_threads = std::min(max_threads, num_idle_threads_ - num_lent_threads_);
+    num_lent_threads_ += num_threads;
+    return num_threads;
+}
+
+void ProfilingContext::ReturnIdleThreads(unsigned int num_threads) {
+    if (num_threads == 0) return;
+    {
+        std::scoped_lock lock(idle_threads_mutex_);
+        num_lent_threads_ -= num_threads;
+    }
+    idle_threads_returned_.notify_all();
+}
+
 util::AgreeSetSample const* ProfilingContext::CreateColumnFocusedSample(
     const Vertical& focus, util::PositionListIndex const* restriction_pli, double boost_factor) {
-    std::unique_ptr<util::ListAgreeSetSample> sample = util::ListAgreeSetSample::CreateFocusedFor(
-        relation_data_,
-        focus,
-        restriction_pli,
-        configuration_.sample_size * boost_factor,
-        custom_random_
-    );
+    // Only the constructor creates the column samples, before any search thread is started
+    std::unique_ptr<util::AgreeSetSample> sample =
+        util::AgreeSetSample::CreateFocusedSample(relation_data_, focus, restriction_pli,
+                                                  configuration_.sample_size * boost_factor,
+                                                  configuration_.seed, configuration_.parallelism);
     LOG(TRACE) << boost::format{"Creating sample focused on: %1%"} % focus.ToString();
     auto sample_ptr = sample.get();
     agree_set_samples_->Put(focus, std::move(sample));
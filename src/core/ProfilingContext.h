@@ -1,5 +1,7 @@
 #pragma once
 
+#include <condition_variable>
+#include <mutex>
 #include <random>
 #include <string>
 
@@ -31,7 +33,16 @@ private:
     ColumnLayoutRelationData* relation_data_;
     std::mt19937 random_;
     CustomRandom custom_random_;
+    /* Search threads waiting for work lend their cores to the samples of the working ones.
+     * num_lent_threads_ of the num_idle_threads_ cores are in use by samples */
+    std::mutex idle_threads_mutex_;
+    std::condition_variable idle_threads_returned_;
+    unsigned int num_idle_threads_ = 0;
+    unsigned int num_lent_threads_ = 0;
 
+    /* Takes up to max_threads of the idle cores, they must be given back by ReturnIdleThreads */
+    unsigned int BorrowIdleThreads(unsigned int max_threads);
+    void ReturnIdleThreads(unsigned int num_threads);
     util::AgreeSetSample const* CreateColumnFocusedSample(
         Vertical const& focus, util::PositionListIndex const* restriction_pli, double boost_factor);
 
@@ -47,6 +58,11 @@ public:
                      CachingMethod const& caching_method,
                      CacheEvictionMethod const& eviction_method, double caching_method_value);
 
+    /* A search thread about to wait for work offers its core to the samples */
+    void LendIdleThread();
+    /* Takes the core back before the thread resumes work, waiting while samples use every lent
+     * core, so that search and sampling threads never outnumber the parallelism together */
+    void ReclaimIdleThread();
     // Non-const as RandomGenerator state gets changed
     util::AgreeSetSample const* CreateFocusedSample(Vertical const& focus, double boost_factor);
     std::shared_ptr<util::AgreeSetSample const> GetAgreeSetSample(Vertical const& focus) const;
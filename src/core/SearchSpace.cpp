@@ -6,19 +6,21 @@
 
 // TODO: extra careful with const& -> shared_ptr conversions via make_shared-smart pointer may delete the object - pass empty deleter [](*) {}
 
-void SearchSpace::Discover() {
+void SearchSpace::Discover(util::VerticalMap<VerticalInfo>* local_visitees) {
     LOG(TRACE) << "Discovering in: " << static_cast<std::string>(*strategy_);
+    std::unique_ptr<util::VerticalMap<VerticalInfo>> own_local_visitees;
     while (true) {  // на второй итерации дропается
         auto now = std::chrono::system_clock::now();
-        std::optional<DependencyCandidate> launch_pad = PollLaunchPad();
+        std::optional<DependencyCandidate> launch_pad = PollLaunchPad(local_visitees);
         if (!launch_pad.has_value()) break;
 
-        if (local_visitees_ == nullptr) {
-            local_visitees_ =
+        if (local_visitees == nullptr) {
+            own_local_visitees =
                 std::make_unique<util::VerticalMap<VerticalInfo>>(context_->GetSchema());
+            local_visitees = own_local_visitees.get();
         }
 
-        bool is_dependency_found = Ascend(*launch_pad);
+        bool is_dependency_found = Ascend(*launch_pad, local_visitees);
         polling_launch_pads_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
                                     std::chrono::system_clock::now() - now)
                                     .count();
@@ -26,7 +28,9 @@ void SearchSpace::Discover() {
     }
 }
 
-std::optional<DependencyCandidate> SearchSpace::PollLaunchPad() {
+std::optional<DependencyCandidate> SearchSpace::PollLaunchPad(
+    util::VerticalMap<VerticalInfo>* local_visitees) {
+    std::unique_lock lock(launch_pads_mutex_);
     while (true) {
         if (launch_pads_.empty()) {
             if (deferred_launch_pads_.empty()) return std::optional<DependencyCandidate>();
@@ -41,8 +45,8 @@ std::optional<DependencyCandidate> SearchSpace::PollLaunchPad() {
         launch_pad_index_->Remove(launch_pad.vertical_);
 
         if (IsImpliedByMinDep(launch_pad.vertical_, global_visitees_.get()) ||
-            (local_visitees_ != nullptr &&
-             IsImpliedByMinDep(launch_pad.vertical_, local_visitees_.get()))) {
+            (local_visitees != nullptr &&
+             IsImpliedByMinDep(launch_pad.vertical_, local_visitees))) {
             launch_pad_index_->Remove(launch_pad.vertical_);
             LOG(TRACE) << "* Removing subset-pruned launch pad {" << launch_pad.vertical_.ToString()
                        << '}';
@@ -50,8 +54,8 @@ std::optional<DependencyCandidate> SearchSpace::PollLaunchPad() {
         }
 
         auto superset_entries = global_visitees_->GetSupersetEntries(launch_pad.vertical_);
-        if (local_visitees_ != nullptr) {
-            auto local_superset_entries = local_visitees_->GetSupersetEntries(launch_pad.vertical_);
+        if (local_visitees != nullptr) {
+            auto local_superset_entries = local_visitees->GetSupersetEntries(launch_pad.vertical_);
             auto end_iterator =
                 std::remove_if(local_superset_entries.begin(), local_superset_entries.end(),
                                [](auto& entry) { return !entry.second->IsPruningSubsets(); });
@@ -59,7 +63,19 @@ std::optional<DependencyCandidate> SearchSpace::PollLaunchPad() {
             std::for_each(local_superset_entries.begin(), end_iterator,
                           [&superset_entries](auto& entry) { superset_entries.push_back(entry); });
         }
-        if (superset_entries.empty()) return launch_pad;
+        // The launch pad counts as polled while it is escaped, so that the search space is not
+        // taken for exhausted before the escaped launch pads are added
+        num_polled_launch_pads_++;
+        if (superset_entries.empty()) {
+            bool const has_launch_pads =
+                !launch_pads_.empty() || !deferred_launch_pads_.empty();
+            lock.unlock();
+            if (has_launch_pads) {
+                NotifyLaunchPadsListener();
+            }
+            return launch_pad;
+        }
+        lock.unlock();
         LOG(TRACE) << boost::format{"* Escaping launch_pad %1% from: %2%"}
             % launch_pad.vertical_.ToString() % "[UNIMPLEMENTED]";
         std::vector<Vertical> superset_verticals;
@@ -68,38 +84,63 @@ std::optional<DependencyCandidate> SearchSpace::PollLaunchPad() {
             superset_verticals.push_back(entry.first);
         }
 
-        EscapeLaunchPad(launch_pad.vertical_, std::move(superset_verticals));
+        std::vector<DependencyCandidate> escaped_launch_pads =
+            EscapeLaunchPad(launch_pad.vertical_, std::move(superset_verticals), local_visitees);
+        lock.lock();
+        num_polled_launch_pads_--;
+        for (auto& escaped_launch_pad : escaped_launch_pads) {
+            // another thread may have added the same or a more general launch pad meanwhile
+            if (launch_pad_index_->GetAnySubsetEntry(escaped_launch_pad.vertical_).second !=
+                nullptr) {
+                continue;
+            }
+            launch_pad_index_->Put(escaped_launch_pad.vertical_,
+                                   std::make_unique<DependencyCandidate>(escaped_launch_pad));
+            launch_pads_.insert(std::move(escaped_launch_pad));
+        }
     }
 }
 
 // this move looks legit IMO
-void SearchSpace::EscapeLaunchPad(Vertical const& launch_pad,
-                                  std::vector<Vertical> pruning_supersets) {
+// Called without launch_pads_mutex_ held, takes it only to look up the launch pad index
+std::vector<DependencyCandidate> SearchSpace::EscapeLaunchPad(
+    Vertical const& launch_pad, std::vector<Vertical> pruning_supersets,
+    util::VerticalMap<VerticalInfo>* local_visitees) {
     std::transform(pruning_supersets.begin(), pruning_supersets.end(), pruning_supersets.begin(),
                    [this](auto& superset) {
                        return superset.Invert().Without(strategy_->GetIrrelevantColumns());
                    });
 
-    std::function<bool(Vertical const&)> pruning_function =
-        [this, &launch_pad](auto const& hitting_set_candidate) -> bool {
-        if (scope_ != nullptr &&
-            scope_->GetAnySupersetEntry(hitting_set_candidate).second == nullptr) {
-            return true;
+    std::function<boost::dynamic_bitset<>(std::vector<Vertical> const&)> pruning_function =
+        [this, &launch_pad, local_visitees](std::vector<Vertical> const& hitting_set_candidates) {
+        boost::dynamic_bitset<> is_pruned(hitting_set_candidates.size());
+        if (scope_ != nullptr) {
+            auto scope_entries = scope_->GetAnySupersetEntries(hitting_set_candidates);
+            for (size_t i = 0; i < scope_entries.size(); ++i) {
+                is_pruned[i] = scope_entries[i].second == nullptr;
+            }
         }
 
-        auto launch_pad_candidate = launch_pad.Union(hitting_set_candidate);
-
-        if ((local_visitees_ == nullptr &&
-             IsImpliedByMinDep(launch_pad_candidate, local_visitees_.get())) ||
-            IsImpliedByMinDep(launch_pad_candidate, global_visitees_.get())) {
-            return true;
+        std::vector<Vertical> launch_pad_candidates;
+        launch_pad_candidates.reserve(hitting_set_candidates.size());
+        for (auto const& hitting_set_candidate : hitting_set_candidates) {
+            launch_pad_candidates.push_back(launch_pad.Union(hitting_set_candidate));
         }
 
-        if (launch_pad_index_->GetAnySubsetEntry(launch_pad_candidate).second != nullptr) {
-            return true;
+        if (local_visitees != nullptr) {
+            is_pruned |= AreImpliedByMinDeps(launch_pad_candidates, local_visitees);
         }
+        is_pruned |= AreImpliedByMinDeps(launch_pad_candidates, global_visitees_.get());
 
-        return false;
+        std::unique_lock lock(launch_pads_mutex_);
+        auto launch_pad_entries = launch_pad_index_->GetAnySubsetEntries(launch_pad_candidates);
+        lock.unlock();
+        for (size_t i = 0; i < launch_pad_entries.size(); ++i) {
+            if (launch_pad_entries[i].second != nullptr) {
+                is_pruned.set(i);
+            }
+        }
+        return is_pruned;
     };
     {
         std::string pruning_supersets_str = "[";
@@ -122,6 +163,7 @@ void SearchSpace::EscapeLaunchPad(Vertical const& launch_pad,
         hitting_set_str += "]";
         LOG(TRACE) << boost::format{"* Evaluated hitting set: %1%"} % hitting_set_str;
     }
+    std::vector<DependencyCandidate> escaped_launch_pads;
     for (auto& escaping : hitting_set) {
 
         auto escaped_launch_pad_vertical = launch_pad.Union(escaping);
@@ -134,29 +176,53 @@ void SearchSpace::EscapeLaunchPad(Vertical const& launch_pad,
         LOG(DEBUG) << boost::format{"  Proposed launch pad arity: %1% should be <= max_lhs: %2%"}
             % escaped_launch_pad.vertical_.GetArity() % context_->GetConfiguration().max_lhs;
         if (escaped_launch_pad.vertical_.GetArity() <= context_->GetConfiguration().max_lhs) {
-            launch_pads_.insert(escaped_launch_pad);
-            launch_pad_index_->Put(escaped_launch_pad.vertical_,
-                                   std::make_unique<DependencyCandidate>(escaped_launch_pad));
+            escaped_launch_pads.push_back(std::move(escaped_launch_pad));
         }
     }
+    return escaped_launch_pads;
 }
 
 void SearchSpace::AddLaunchPad(const DependencyCandidate& launch_pad) {
+    std::scoped_lock lock(launch_pads_mutex_);
     launch_pads_.insert(launch_pad);
     launch_pad_index_->Put(launch_pad.vertical_, std::make_unique<DependencyCandidate>(launch_pad));
 }
 
 void SearchSpace::ReturnLaunchPad(DependencyCandidate const& launch_pad, bool is_defer) {
-    if (is_defer && context_->GetConfiguration().is_defer_failed_launch_pads) {
-        deferred_launch_pads_.push_back(launch_pad);
-        LOG(TRACE) << boost::format{"Deferred seed %1%"} % launch_pad.vertical_.ToString();
-    } else {
-        launch_pads_.insert(launch_pad);
+    {
+        std::scoped_lock lock(launch_pads_mutex_);
+        num_polled_launch_pads_--;
+        if (is_defer && context_->GetConfiguration().is_defer_failed_launch_pads) {
+            deferred_launch_pads_.push_back(launch_pad);
+            LOG(TRACE) << boost::format{"Deferred seed %1%"} % launch_pad.vertical_.ToString();
+        } else {
+            launch_pads_.insert(launch_pad);
+        }
+        launch_pad_index_->Put(launch_pad.vertical_,
+                               std::make_unique<DependencyCandidate>(launch_pad));
     }
-    launch_pad_index_->Put(launch_pad.vertical_, std::make_unique<DependencyCandidate>(launch_pad));
+    NotifyLaunchPadsListener();
 }
 
-bool SearchSpace::Ascend(DependencyCandidate const& launch_pad) {
+void SearchSpace::NotifyLaunchPadsListener() const {
+    if (launch_pads_listener_) {
+        launch_pads_listener_();
+    }
+}
+
+bool SearchSpace::HasLaunchPads() const {
+    std::scoped_lock lock(launch_pads_mutex_);
+    return !launch_pads_.empty() || !deferred_launch_pads_.empty();
+}
+
+bool SearchSpace::IsExhausted() const {
+    std::scoped_lock lock(launch_pads_mutex_);
+    return launch_pads_.empty() && deferred_launch_pads_.empty() &&
+           num_polled_launch_pads_ == 0;
+}
+
+bool SearchSpace::Ascend(DependencyCandidate const& launch_pad,
+                         util::VerticalMap<VerticalInfo>* local_visitees) {
     auto now = std::chrono::system_clock::now();
 
     LOG(DEBUG) << boost::format{"===== Ascending from %1% ======"} %
@@ -182,7 +248,7 @@ bool SearchSpace::Ascend(DependencyCandidate const& launch_pad) {
             error = traversal_candidate.error_.Get();
 
             bool can_be_dependency = *error <= strategy_->max_dependency_error_;
-            local_visitees_->Put(traversal_candidate.vertical_,
+            local_visitees->Put(traversal_candidate.vertical_,
                                  std::make_unique<VerticalInfo>(can_be_dependency, false, *error));
             if (can_be_dependency) break;
         } else {
@@ -197,7 +263,7 @@ bool SearchSpace::Ascend(DependencyCandidate const& launch_pad) {
                         : strategy_->CalculateError(traversal_candidate.vertical_);
                 // double errorDiff = *error - traversal_candidate.error_.GetMean();
 
-                local_visitees_->Put(traversal_candidate.vertical_,
+                local_visitees->Put(traversal_candidate.vertical_,
                                      std::make_unique<VerticalInfo>(
                                          error <= strategy_->max_dependency_error_, false, *error));
 
@@ -220,7 +286,7 @@ bool SearchSpace::Ascend(DependencyCandidate const& launch_pad) {
         boost::optional<DependencyCandidate> next_candidate;
         int num_seen_elements = is_ascend_randomly_ ? 1 : -1;
         for (auto& extension_column : context_->GetSchema()->GetColumns()) {
-            if (traversal_candidate.vertical_.GetColumnIndices()[extension_column->GetIndex()] ||
+            if (traversal_candidate.vertical_.GetColumnSet()[extension_column->GetIndex()] ||
                 strategy_->IsIrrelevantColumn(*extension_column)) {
                 continue;
             }
@@ -270,7 +336,7 @@ bool SearchSpace::Ascend(DependencyCandidate const& launch_pad) {
     if (*error <= strategy_->max_dependency_error_) {
         LOG(TRACE) << boost::format{"  Key peak in climbing phase e(%1%)=%2% -> Need to minimize."}
             % traversal_candidate.vertical_.ToString() % *error;
-        TrickleDown(traversal_candidate.vertical_, *error);
+        TrickleDown(traversal_candidate.vertical_, *error, local_visitees);
 
         if (recursion_depth_ == 0) {
             assert(scope_ == nullptr);
@@ -289,7 +355,7 @@ bool SearchSpace::Ascend(DependencyCandidate const& launch_pad) {
             LOG(DEBUG) << boost::format{"[---] %1% is maximum non-dependency (err=%2%)."}
                 % traversal_candidate.vertical_.ToString() % *error;
         } else {
-            local_visitees_->Put(traversal_candidate.vertical_,
+            local_visitees->Put(traversal_candidate.vertical_,
                                  std::make_unique<VerticalInfo>(VerticalInfo::ForNonDependency()));
             LOG(DEBUG) << boost::format{"      %1% is local-maximum non-dependency (err=%2%)."}
                 % traversal_candidate.vertical_.ToString() % *error;
@@ -303,7 +369,8 @@ void SearchSpace::CheckEstimate([[maybe_unused]] DependencyStrategy* strategy,
     LOG(DEBUG) << "Stepped into method 'checkEstimate' - not implemented yet being a debug method\n";
 }
 
-void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error) {
+void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error,
+                              util::VerticalMap<VerticalInfo>* local_visitees) {
     LOG(DEBUG) << boost::format{"====== Trickling down from %1% ======"} % main_peak.ToString();
 
     std::unordered_set<Vertical> maximal_non_deps;
@@ -329,7 +396,7 @@ void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error)
             peaks.pop_back();
 
             auto peak_hitting_set = context_->GetSchema()->CalculateHittingSet(
-                std::move(subset_deps), boost::optional<std::function<bool(Vertical const&)>>());
+                std::move(subset_deps), boost::none);
             std::unordered_set<Vertical> escaped_peak_verticals;
 
             for (auto& vertical : peak_hitting_set) {
@@ -347,7 +414,7 @@ void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error)
                         alleged_non_deps.insert(escaped_peak_vertical);
                         continue;
                     }
-                    if (IsKnownNonDependency(escaped_peak_vertical, local_visitees_.get())
+                    if (IsKnownNonDependency(escaped_peak_vertical, local_visitees)
                         || IsKnownNonDependency(escaped_peak_vertical, global_visitees_.get())) {
                         continue;
                     }
@@ -359,7 +426,7 @@ void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error)
         }
         auto alleged_min_dep = TrickleDownFrom(
             std::move(peak), strategy_.get(), alleged_min_deps.get(), alleged_non_deps,
-            global_visitees_.get(), sample_boost_);
+            local_visitees, global_visitees_.get(), sample_boost_);
         if (!alleged_min_dep.has_value()) {
             std::pop_heap(peaks.begin(), peaks.end(), peaks_comparator);
             peaks.pop_back();
@@ -371,12 +438,11 @@ void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error)
 
     int num_uncertain_min_deps = 0;
     for (auto& [alleged_min_dep, info] : alleged_min_deps->EntrySet()) {
-        if (info->is_extremal_ && !global_visitees_->ContainsKey(alleged_min_dep)) {
+        // TODO: Костыль -- info в нескольких местах должен храниться. ХЗ, кому он принадлежит, пока копирую
+        if (info->is_extremal_ && !global_visitees_->ContainsKey(alleged_min_dep) &&
+            RegisterMinimalDependency(alleged_min_dep, *info)) {
             LOG(DEBUG) << boost::format{"[%1%] Minimum dependency: %2% (error=%3%)"}
                 % recursion_depth_ % alleged_min_dep.ToString() % info->error_;
-            // TODO: Костыль -- info в нескольких местах должен храниться. ХЗ, кому он принадлежит, пока копирую
-            global_visitees_->Put(alleged_min_dep, std::make_unique<VerticalInfo>(*info));
-            strategy_->RegisterDependency(alleged_min_dep, info->error_, *context_);
         }
         if (!info->is_extremal_) {
             num_uncertain_min_deps++;
@@ -391,7 +457,7 @@ void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error)
     // ещё и морока с transform и unordered_set - мб вообще в лист переделать.
     auto alleged_max_non_deps_hs = context_->GetSchema()->CalculateHittingSet(
         std::vector<Vertical>(alleged_min_deps_set.begin(), alleged_min_deps_set.end()),
-        boost::optional<std::function<bool(Vertical const&)>>());
+        boost::none);
     std::unordered_set<Vertical> alleged_max_non_deps;
 
     for (auto& min_leave_out_vertical : alleged_max_non_deps_hs) {
@@ -418,7 +484,7 @@ void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error)
         if (alleged_max_non_dep.GetArity() == 0) continue;
 
         if (maximal_non_deps.find(alleged_max_non_dep) != maximal_non_deps.end() ||
-            IsKnownNonDependency(alleged_max_non_dep, local_visitees_.get()) ||
+            IsKnownNonDependency(alleged_max_non_dep, local_visitees) ||
             IsKnownNonDependency(alleged_max_non_dep, global_visitees_.get())) {
             continue;
         }
@@ -433,7 +499,7 @@ void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error)
                    alleged_max_non_dep.ToString() % is_non_dep % error;
         if (is_non_dep) {
             maximal_non_deps.insert(alleged_max_non_dep);
-            local_visitees_->Put(alleged_max_non_dep,
+            local_visitees->Put(alleged_max_non_dep,
                                  std::make_unique<VerticalInfo>(VerticalInfo::ForNonDependency()));
         } else {
             peaks.emplace_back(alleged_max_non_dep, util::ConfidenceInterval(error), true);
@@ -445,12 +511,12 @@ void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error)
     if (peaks.empty()) {
         for (auto& [alleged_min_dep, info] : alleged_min_deps->EntrySet()) {
             if (!info->is_extremal_ && !global_visitees_->ContainsKey(alleged_min_dep)) {
-                LOG(DEBUG) << boost::format{"[%1%] Minimum dependency: %2% (error=%3%)"}
-                    % recursion_depth_ % alleged_min_dep.ToString() % info->error_;
                 // TODO: тут надо сделать non-const - костыльный mutable; опять Info в двух местах хранится
                 info->is_extremal_ = true;
-                global_visitees_->Put(alleged_min_dep, std::make_unique<VerticalInfo>(*info));
-                strategy_->RegisterDependency(alleged_min_dep, info->error_, *context_);
+                if (RegisterMinimalDependency(alleged_min_dep, *info)) {
+                    LOG(DEBUG) << boost::format{"[%1%] Minimum dependency: %2% (error=%3%)"}
+                        % recursion_depth_ % alleged_min_dep.ToString() % info->error_;
+                }
             }
         }
         trickling_down_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
@@ -470,10 +536,13 @@ void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error)
         auto scope_verticals = new_scope->KeySet();
         // TODO: что делать с strategy, globalVisitees?
         auto nested_search_space = std::make_unique<SearchSpace>(
-            -1, strategy_->CreateClone(), std::move(new_scope), std::move(global_visitees_),
+            -1, strategy_->CreateClone(), std::move(new_scope), global_visitees_,
             context_->GetSchema(), launch_pads_.key_comp(), recursion_depth_ + 1,
             sample_boost_ * context_->GetConfiguration().sample_booster);
         nested_search_space->SetContext(context_);
+        nested_search_space->SetLaunchPadsListener(launch_pads_listener_);
+        nested_search_space->SetNestedSearchSpaceListeners(share_nested_space_,
+                                                           withdraw_nested_space_);
 
         std::unordered_set<Column> scope_columns;
         for (auto& vertical : scope_verticals) {
@@ -495,23 +564,28 @@ void SearchSpace::TrickleDown(Vertical const& main_peak, double main_peak_error)
         trickling_down_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
                                std::chrono::system_clock::now() - now)
                                .count();
-        nested_search_space->MoveInLocalVisitees(std::move(local_visitees_));
-        nested_search_space->Discover();
+        // Idle threads may join the nested search space. The alleged minimal dependencies are
+        // registered only after all of them have left it
+        if (share_nested_space_) {
+            share_nested_space_(nested_search_space.get());
+        }
+        nested_search_space->Discover(local_visitees);
+        if (withdraw_nested_space_) {
+            withdraw_nested_space_(nested_search_space.get());
+        }
         trickling_down_part_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
                                     std::chrono::system_clock::now() - prev)
                                     .count();
-        global_visitees_ = nested_search_space->MoveOutGlobalVisitees();
-        local_visitees_ = nested_search_space->MoveOutLocalVisitees();
 
         for (auto& [alleged_min_dep, info] : alleged_min_deps->EntrySet()) {
             if (!IsImpliedByMinDep(alleged_min_dep, global_visitees_.get())) {
-                LOG(DEBUG) << boost::format{
-                    "[%1%] Minimum dependency: %2% (error=%3%) (was right after all)"}
-                    % recursion_depth_ % alleged_min_dep.ToString() % info->error_;
                 // TODO: тут надо сделать non-const - костыльный mutable; опять Info в двух местах хранится
                 info->is_extremal_ = true;
-                global_visitees_->Put(alleged_min_dep, std::make_unique<VerticalInfo>(*info));
-                strategy_->RegisterDependency(alleged_min_dep, info->error_, *context_);
+                if (RegisterMinimalDependency(alleged_min_dep, *info)) {
+                    LOG(DEBUG) << boost::format{
+                        "[%1%] Minimum dependency: %2% (error=%3%) (was right after all)"}
+                        % recursion_depth_ % alleged_min_dep.ToString() % info->error_;
+                }
             }
         }
     }
@@ -521,6 +595,7 @@ std::optional<Vertical> SearchSpace::TrickleDownFrom(
     DependencyCandidate min_dep_candidate, DependencyStrategy* strategy,
     util::VerticalMap<VerticalInfo>* alleged_min_deps,
     std::unordered_set<Vertical>& alleged_non_deps,
+    util::VerticalMap<VerticalInfo>* local_visitees,
     util::VerticalMap<VerticalInfo>* global_visitees, double boost_factor) {
     auto now = std::chrono::system_clock::now();
     if (min_dep_candidate.error_.GetMin() > strategy->max_dependency_error_) {
@@ -536,7 +611,7 @@ std::optional<Vertical> SearchSpace::TrickleDownFrom(
                 return DependencyCandidate::MinErrorComparator(candidate1, candidate2);
             });
         for (auto& parent_vertical : min_dep_candidate.vertical_.GetParents()) {
-            if (IsKnownNonDependency(parent_vertical, local_visitees_.get()) ||
+            if (IsKnownNonDependency(parent_vertical, local_visitees) ||
                 IsKnownNonDependency(parent_vertical, global_visitees))
                 continue;
             if (alleged_non_deps.count(parent_vertical) != 0) {
@@ -555,7 +630,7 @@ std::optional<Vertical> SearchSpace::TrickleDownFrom(
             if (parent_candidate.error_.GetMin() > strategy->min_non_dependency_error_) {
                 do {
                     if (parent_candidate.IsExact()) {
-                        local_visitees_->Put(
+                        local_visitees->Put(
                             parent_candidate.vertical_,
                             std::make_unique<VerticalInfo>(VerticalInfo::ForNonDependency()));
                     } else {
@@ -579,6 +654,7 @@ std::optional<Vertical> SearchSpace::TrickleDownFrom(
                 strategy,
                 alleged_min_deps,
                 alleged_non_deps,
+                local_visitees,
                 global_visitees,
                 boost_factor
             );
@@ -620,7 +696,7 @@ std::optional<Vertical> SearchSpace::TrickleDownFrom(
     } else {
         LOG(TRACE) << boost::format{"* Guessed incorrect %1%-ary minimum dependency candidate."}
             % min_dep_candidate.vertical_.GetArity();
-        local_visitees_->Put(min_dep_candidate.vertical_,
+        local_visitees->Put(min_dep_candidate.vertical_,
                              std::make_unique<VerticalInfo>(VerticalInfo::ForNonDependency()));
 
         if (strategy->ShouldResample(min_dep_candidate.vertical_, boost_factor)) {
@@ -633,6 +709,15 @@ std::optional<Vertical> SearchSpace::TrickleDownFrom(
     }
 }
 
+bool SearchSpace::RegisterMinimalDependency(Vertical const& min_dependency,
+                                            VerticalInfo const& info) {
+    if (global_visitees_->Put(min_dependency, std::make_unique<VerticalInfo>(info)) != nullptr) {
+        return false;
+    }
+    strategy_->RegisterDependency(min_dependency, info.error_, *context_);
+    return true;
+}
+
 void SearchSpace::RequireMinimalDependency(DependencyStrategy* strategy,
                                            Vertical const& min_dependency) {
     double error = strategy->CalculateError(min_dependency);
@@ -675,6 +760,19 @@ bool SearchSpace::IsImpliedByMinDep(Vertical const& vertical,
                .second != nullptr;
 }
 
+boost::dynamic_bitset<> SearchSpace::AreImpliedByMinDeps(
+    std::vector<Vertical> const& verticals, util::VerticalMap<VerticalInfo>* vertical_infos) {
+    auto entries = vertical_infos->GetAnySubsetEntries(
+        verticals, []([[maybe_unused]] auto vertical, auto info) {
+            return info->is_dependency_ && info->is_extremal_;
+        });
+    boost::dynamic_bitset<> are_implied(verticals.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        are_implied[i] = entries[i].second != nullptr;
+    }
+    return are_implied;
+}
+
 bool SearchSpace::IsKnownNonDependency(Vertical const& vertical,
                                        util::VerticalMap<VerticalInfo>* vertical_infos) {
     return vertical_infos
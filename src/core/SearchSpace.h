@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <list>
+#include <mutex>
 #include <set>
 #include <memory>
 #include <utility>
@@ -19,46 +22,56 @@ private:
         std::function<bool(DependencyCandidate const&, DependencyCandidate const&)>;
     ProfilingContext* context_;
     std::unique_ptr<DependencyStrategy> strategy_;
-    std::unique_ptr<util::VerticalMap<VerticalInfo>> local_visitees_ = nullptr;
-    std::unique_ptr<util::VerticalMap<VerticalInfo>> global_visitees_;
+    /* Shared by all the threads discovering in this search space and its nested ones */
+    std::shared_ptr<util::VerticalMap<VerticalInfo>> global_visitees_;
+    /* Guards the launch pads, their index and the polled launch pads count. Launch pads are the
+     * unit of work several threads share: each of them ascends from the launch pad it polled and
+     * trickles down from the peak it reached, keeping what it learns locally in its own local
+     * visitees */
+    mutable std::mutex launch_pads_mutex_;
     std::set<DependencyCandidate, DependencyCandidateComp> launch_pads_;
     std::unique_ptr<util::VerticalMap<DependencyCandidate>> launch_pad_index_;
     std::list<DependencyCandidate> deferred_launch_pads_;
+    int num_polled_launch_pads_ = 0;
+    /* Called without the lock held when launch pads become available to other threads */
+    std::function<void()> launch_pads_listener_;
+    /* Offer a nested search space to the threads waiting for work, and withdraw it once its
+     * creator has discovered it, waiting for the threads that joined it to leave. Without them a
+     * nested search space is discovered by the thread that creates it only */
+    std::function<void(SearchSpace*)> share_nested_space_;
+    std::function<void(SearchSpace*)> withdraw_nested_space_;
     std::unique_ptr<util::VerticalMap<Vertical>> scope_;
     double sample_boost_;
     int recursion_depth_;
     bool is_ascend_randomly_ = false;
 
-    int num_nested_ = 0;
+    std::atomic<int> num_nested_ = 0;
 
-    // void Discover(std::unique_ptr<VerticalMap<VerticalInfo>> localVisitees);
-    std::optional<DependencyCandidate> PollLaunchPad();
-    void EscapeLaunchPad(Vertical const& hitting_set_candidate,
-                         std::vector<Vertical> pruning_supersets);
+    std::optional<DependencyCandidate> PollLaunchPad(
+        util::VerticalMap<VerticalInfo>* local_visitees);
+    /* Returns the launch pads replacing the pruned launch_pad, the caller adds them */
+    std::vector<DependencyCandidate> EscapeLaunchPad(
+        Vertical const& launch_pad, std::vector<Vertical> pruning_supersets,
+        util::VerticalMap<VerticalInfo>* local_visitees);
     void ReturnLaunchPad(DependencyCandidate const& launch_pad, bool is_defer);
+    void NotifyLaunchPadsListener() const;
 
-    bool Ascend(DependencyCandidate const& launch_pad);
+    bool Ascend(DependencyCandidate const& launch_pad,
+                util::VerticalMap<VerticalInfo>* local_visitees);
     void CheckEstimate(DependencyStrategy* strategy,
                        DependencyCandidate const& traversal_candidate);
-    void TrickleDown(Vertical const& main_peak, double main_peak_error);
+    void TrickleDown(Vertical const& main_peak, double main_peak_error,
+                     util::VerticalMap<VerticalInfo>* local_visitees);
     std::optional<Vertical> TrickleDownFrom(DependencyCandidate min_dep_candidate,
                                             DependencyStrategy* strategy,
                                             util::VerticalMap<VerticalInfo>* alleged_min_deps,
                                             std::unordered_set<Vertical>& alleged_non_deps,
+                                            util::VerticalMap<VerticalInfo>* local_visitees,
                                             util::VerticalMap<VerticalInfo>* global_visitees,
                                             double boost_factor);
-
-    // CAREFUL: resets globalVisitees_, therefore SearchSpace could become invalidated
-    std::unique_ptr<util::VerticalMap<VerticalInfo>> MoveOutGlobalVisitees() {
-        return std::move(global_visitees_);
-    }
-    // CAREFUL: resets localVisitees_, therefore SearchSpace could become invalidated
-    std::unique_ptr<util::VerticalMap<VerticalInfo>> MoveOutLocalVisitees() {
-        return std::move(local_visitees_);
-    }
-    void MoveInLocalVisitees(std::unique_ptr<util::VerticalMap<VerticalInfo>> local_visitees) {
-        local_visitees_ = std::move(local_visitees);
-    }
+    /* Puts a minimal dependency into the global visitees and registers it, unless another
+     * thread has already done so. Returns whether the dependency was registered */
+    bool RegisterMinimalDependency(Vertical const& min_dependency, VerticalInfo const& info);
 
     static void RequireMinimalDependency(DependencyStrategy* strategy,
                                          Vertical const& min_dependency);
@@ -66,26 +79,29 @@ private:
                                                util::VerticalMap<VerticalInfo>* vertical_infos);
     static bool IsImpliedByMinDep(Vertical const& vertical,
                                   util::VerticalMap<VerticalInfo>* vertical_infos);
+    /* Batched IsImpliedByMinDep(), the i-th bit tells whether verticals[i] is implied */
+    static boost::dynamic_bitset<> AreImpliedByMinDeps(
+        std::vector<Vertical> const& verticals, util::VerticalMap<VerticalInfo>* vertical_infos);
     static bool IsKnownNonDependency(Vertical const& vertical,
                                      util::VerticalMap<VerticalInfo>* vertical_infos);
     static std::string FormatArityHistogram() = delete;
     static std::string FormatArityHistogram(util::VerticalMap<int*>) = delete;
 
 public:
-    unsigned long long nanos_smart_constructing_ = 0;
-    unsigned long long polling_launch_pads_ = 0;
-    unsigned long long ascending_ = 0;
-    unsigned long long trickling_down_ = 0;
-    unsigned long long trickling_down_part_ = 0;
-    unsigned long long trickling_down_from_ = 0;
-    unsigned long long returning_launch_pad_ = 0;
+    std::atomic<unsigned long long> nanos_smart_constructing_ = 0;
+    std::atomic<unsigned long long> polling_launch_pads_ = 0;
+    std::atomic<unsigned long long> ascending_ = 0;
+    std::atomic<unsigned long long> trickling_down_ = 0;
+    std::atomic<unsigned long long> trickling_down_part_ = 0;
+    std::atomic<unsigned long long> trickling_down_from_ = 0;
+    std::atomic<unsigned long long> returning_launch_pad_ = 0;
 
     bool is_initialized_ = false;
     int id_;
 
     SearchSpace(int id, std::unique_ptr<DependencyStrategy> strategy,
                 std::unique_ptr<util::VerticalMap<Vertical>> scope,
-                std::unique_ptr<util::VerticalMap<VerticalInfo>> global_visitees,
+                std::shared_ptr<util::VerticalMap<VerticalInfo>> global_visitees,
                 RelationalSchema const* schema,
                 DependencyCandidateComp const& dependency_candidate_comparator,
                 int recursion_depth, double sample_boost)
@@ -99,12 +115,27 @@ public:
                 RelationalSchema const* schema,
                 DependencyCandidateComp const& dependency_candidate_comparator)
         : SearchSpace(id, std::move(strategy), nullptr,
-                      std::make_unique<util::VerticalMap<VerticalInfo>>(schema),
+                      std::make_shared<util::ConcurrentVerticalMap<VerticalInfo>>(schema),
                       schema, dependency_candidate_comparator, 0, 1) {}
 
     void EnsureInitialized();
-    void Discover();
+    /* Ascends from launch pads until none is left to poll. Several threads may discover in a
+     * search space at once, each of them with its own local visitees. The creator of a nested
+     * search space discovers it with the local visitees of its parent */
+    void Discover(util::VerticalMap<VerticalInfo>* local_visitees = nullptr);
     void AddLaunchPad(DependencyCandidate const& launch_pad);
+    /* Whether a launch pad can be polled right now */
+    bool HasLaunchPads() const;
+    /* Whether there are no launch pads left and no thread is ascending from one */
+    bool IsExhausted() const;
+    void SetLaunchPadsListener(std::function<void()> listener) {
+        launch_pads_listener_ = std::move(listener);
+    }
+    void SetNestedSearchSpaceListeners(std::function<void(SearchSpace*)> share,
+                                       std::function<void(SearchSpace*)> withdraw) {
+        share_nested_space_ = std::move(share);
+        withdraw_nested_space_ = std::move(withdraw);
+    }
     void SetContext(ProfilingContext* context) {
         context_ = context;
         strategy_->context_ = context;
@@ -27,6 +27,16 @@ public:
         return (seed ^ 25214903917LL) & 281474976710655LL;
     }
 
+    // Seed of the stream number `stream` split off `seed`: a function of the pair only, so
+    // streams can be consumed in any order and by any thread (SplitMix64 finalizer)
+    static long long SplitSeed(long long seed, unsigned long long stream) {
+        unsigned long long z = static_cast<unsigned long long>(seed) +
+                               (stream + 1) * 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return static_cast<long long>(z ^ (z >> 31));
+    }
+
     long long Next(int bits) {
         seed_ = (seed_ * multiplier_ + addend_) & mask_;
         return (int)(static_cast<unsigned long long>(seed_) >> (48 - bits));
@@ -90,6 +90,7 @@ int main(int argc, char const* argv[]) {
     int seed = 0;
     double error = 0.0;
     unsigned int max_lhs = -1;
+    std::string pli_intersection = "dense";
     ushort threads = 0;
     bool is_null_equal_null = true;
 
@@ -141,6 +142,9 @@ int main(int argc, char const* argv[]) {
         (posr::Threads, po::value<ushort>(&threads)->default_value(threads),
          "number of threads to use. If 0, then as many threads are used as "
          "the hardware can handle concurrently.")
+        (posr::SnapshotDirectory, po::value<std::string>(),
+         "directory to keep binary snapshots of the encoded datasets in. Repeated runs on the "
+         "same dataset load its snapshot instead of parsing the CSV file")
         ;
 
     po::options_description typos_fd_options("Typo mining/FD options");
@@ -150,6 +154,17 @@ int main(int argc, char const* argv[]) {
         (posr::MaximumLhs, po::value<unsigned int>(&max_lhs)->default_value(max_lhs),
          "max considered LHS size")
         (posr::Seed, po::value<int>(&seed)->default_value(seed), "RNG seed")
+        (posr::PliIntersection,
+         po::value<std::string>(&pli_intersection)->default_value(pli_intersection),
+         "PLI intersection implementation [dense|hashing]")
+        (posr::PliCacheLimit, po::value<unsigned int>(),
+         "maximum size of the PLI cache of Pyro and DFD in megabytes. Unlimited if not specified")
+        (posr::PliCaching, po::value<std::string>(),
+         "PLIs cached by Pyro [coin|none|all|entropy|uniqueness|mean_entropy|q2|gini|"
+         "inverted_entropy]. Threshold methods cache the PLIs whose measure is at most "
+         "the value of pli_caching_value times the threshold")
+        (posr::PliCachingValue, po::value<double>(),
+         "scale of the threshold of the PLI caching method, 1 by default")
         ;
 
     po::options_description ar_options("AR options");
@@ -242,6 +257,16 @@ int main(int argc, char const* argv[]) {
         return 1;
     }
 
+    if (pli_intersection == "dense") {
+        util::PLI::intersection_method_ = util::PLI::IntersectionMethod::kDenseScratch;
+    } else if (pli_intersection == "hashing") {
+        util::PLI::intersection_method_ = util::PLI::IntersectionMethod::kHashing;
+    } else {
+        std::cout << "ERROR: no matching PLI intersection implementation."
+                     " Available implementations are:\n[dense|hashing]\n";
+        return 1;
+    }
+
     if (task == "fd" || task == "typos") {
         std::cout << "Input: algorithm \"" << algo
                   << "\" with seed " << std::to_string(seed)
@@ -4,12 +4,24 @@
 //
 #include "ColumnLayoutRelationData.h"
 
-#include <map>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
 #include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 
 #include <easylogging++.h>
 
+#include "ParallelFor.h"
+
 std::vector<int> ColumnLayoutRelationData::GetTuple(int tuple_index) const {
     int num_columns = schema_->GetNumColumns();
     std::vector<int> tuple = std::vector<int>(num_columns);
@@ -19,61 +31,140 @@ std::vector<int> ColumnLayoutRelationData::GetTuple(int tuple_index) const {
     return tuple;
 }
 
-std::unique_ptr<ColumnLayoutRelationData> ColumnLayoutRelationData::CreateFrom(
-    CSVParser& file_input, bool is_null_eq_null, int max_cols, long max_rows) {
-    auto schema = std::make_unique<RelationalSchema>(file_input.GetRelationName(), is_null_eq_null);
-    std::unordered_map<std::string, int> value_dictionary;
-    int next_value_id = 1;
-    const int null_value_id = -1;
-    int num_columns = file_input.GetNumberOfColumns();
-    if (max_cols > 0) num_columns = std::min(num_columns, max_cols);
-    std::vector<std::vector<int>> column_vectors = std::vector<std::vector<int>>(num_columns);
+namespace {
+
+/* Dictionary-encoded columns of a part of the rows. Every column has its own dictionary, so
+ * the value ids of a column are dense and start at 1. Dictionary keys are views into the mapped
+ * file, the few fields unescaped by the parser are copied to unescaped_fields to outlive the row */
+struct EncodedRows {
+    std::vector<std::vector<int>> column_vectors;
+    std::vector<std::unordered_map<std::string_view, int>> value_dictionaries;
+    std::deque<std::string> unescaped_fields;
+
+    explicit EncodedRows(int num_columns)
+        : column_vectors(num_columns), value_dictionaries(num_columns) {}
+};
+
+/* Encodes the rows left in file_input. Rows are buffered column-wise in blocks that are encoded
+ * column-parallel using up to threads_num threads */
+void EncodeRows(CSVParser& file_input, int num_columns, long max_rows, unsigned threads_num,
+                EncodedRows& encoded) {
     int row_num = 0;
-    std::vector<std::string> row;
+    std::vector<std::string_view> row;
+    std::vector<std::vector<std::string_view>> column_blocks(num_columns);
+    std::vector<int> column_indices(num_columns);
+    std::iota(column_indices.begin(), column_indices.end(), 0);
+    auto const encode_column_block = [&encoded, &column_blocks](int i) {
+        std::unordered_map<std::string_view, int>& value_dictionary =
+            encoded.value_dictionaries[i];
+        std::vector<int>& column_vector = encoded.column_vectors[i];
+        for (std::string_view field : column_blocks[i]) {
+            if (field.empty()) {
+                column_vector.push_back(ColumnLayoutRelationData::kNullValueId);
+            } else {
+                int next_value_id = value_dictionary.size() + 1;
+                column_vector.push_back(
+                    value_dictionary.try_emplace(field, next_value_id).first->second);
+            }
+        }
+        column_blocks[i].clear();
+    };
+    auto const encode_block = [&column_indices, threads_num, &encode_column_block]() {
+        util::parallel_foreach(column_indices.begin(), column_indices.end(), threads_num,
+                               encode_column_block);
+    };
 
     while (file_input.GetHasNext()) {
-        row = file_input.ParseNext();
+        file_input.ParseNext(row);
 
         if (row.empty() && num_columns == 1) {
-            row.emplace_back("");
+            row.emplace_back();
         } else if ((int)row.size() != num_columns) {
             LOG(WARNING) << "Skipping incomplete rows";
             continue;
         }
 
         if (max_rows <= 0 || row_num < max_rows) {
-            int index = 0;
-            for (std::string& field : row) {
-                if (field.empty()) {
-                    column_vectors[index].push_back(null_value_id);
-                } else {
-                    auto location = value_dictionary.find(field);
-                    int value_id;
-                    if (location == value_dictionary.end()) {
-                        value_dictionary[field] = next_value_id;
-                        value_id = next_value_id;
-                        next_value_id++;
-                    } else {
-                        value_id = location->second;
-                    }
-                    column_vectors[index].push_back(value_id);
+            for (int index = 0; index < num_columns; ++index) {
+                std::string_view field = row[index];
+                if (!file_input.IsMapped(field)) {
+                    field = encoded.unescaped_fields.emplace_back(field);
                 }
-                index++;
-                if (index >= num_columns) break;
+                column_blocks[index].push_back(field);
             }
         } else {
             //TODO: Подумать что тут сделать
             assert(0);
         }
         row_num++;
+        if (row_num % ColumnLayoutRelationData::kEncodingBlockRows == 0) {
+            encode_block();
+        }
     }
+    encode_block();
+}
 
-    std::vector<ColumnData> column_data;
+/* Concatenates the i-th columns of the chunks, translating the chunk value ids to the ids of
+ * one dictionary */
+std::vector<int> MergeColumn(std::vector<EncodedRows> const& chunks, int i) {
+    std::size_t num_rows = 0;
+    for (EncodedRows const& chunk : chunks) {
+        num_rows += chunk.column_vectors[i].size();
+    }
+    std::vector<int> column_vector;
+    column_vector.reserve(num_rows);
+
+    std::unordered_map<std::string_view, int> value_dictionary;
+    std::vector<std::string_view> chunk_values;
+    std::vector<int> chunk_to_merged_id;
+    for (EncodedRows const& chunk : chunks) {
+        std::unordered_map<std::string_view, int> const& chunk_dictionary =
+            chunk.value_dictionaries[i];
+        chunk_values.resize(chunk_dictionary.size() + 1);
+        for (auto const& [value, value_id] : chunk_dictionary) {
+            chunk_values[value_id] = value;
+        }
+        /* Walk chunk ids in order to keep ids ordered by first appearance */
+        chunk_to_merged_id.resize(chunk_dictionary.size() + 1);
+        for (std::size_t value_id = 1; value_id < chunk_values.size(); ++value_id) {
+            int next_value_id = value_dictionary.size() + 1;
+            chunk_to_merged_id[value_id] =
+                value_dictionary.try_emplace(chunk_values[value_id], next_value_id)
+                    .first->second;
+        }
+        for (int value_id : chunk.column_vectors[i]) {
+            column_vector.push_back(value_id == ColumnLayoutRelationData::kNullValueId
+                                        ? value_id
+                                        : chunk_to_merged_id[value_id]);
+        }
+    }
+    return column_vector;
+}
+
+/* Builds the PLIs of the encoded columns using up to threads_num threads */
+std::unique_ptr<ColumnLayoutRelationData> BuildRelation(
+    std::string const& relation_name, std::vector<std::string> const& column_names,
+    std::vector<std::vector<int>>& column_vectors, bool is_null_eq_null, unsigned threads_num) {
+    auto schema = std::make_unique<RelationalSchema>(relation_name, is_null_eq_null);
+    int num_columns = column_vectors.size();
     for (int i = 0; i < num_columns; ++i) {
-        auto column = Column(schema.get(), file_input.GetColumnName(i), i);
+        auto column = Column(schema.get(), column_names[i], i);
         schema->AppendColumn(std::move(column));
-        auto pli = util::PositionListIndex::CreateFor(column_vectors[i], schema->IsNullEqualNull());
-        column_data.emplace_back(schema->GetColumn(i), std::move(pli));
+    }
+
+    std::vector<std::unique_ptr<util::PositionListIndex>> plis(num_columns);
+    std::vector<int> column_indices(num_columns);
+    std::iota(column_indices.begin(), column_indices.end(), 0);
+    util::parallel_foreach(column_indices.begin(), column_indices.end(), threads_num,
+                           [&plis, &column_vectors, &schema](int i) {
+                               plis[i] = util::PositionListIndex::CreateFor(
+                                   column_vectors[i], schema->IsNullEqualNull());
+                           });
+
+    std::vector<ColumnData> column_data;
+    column_data.reserve(num_columns);
+    for (int i = 0; i < num_columns; ++i) {
+        column_data.emplace_back(schema->GetColumn(i), std::move(plis[i]));
     }
 
     schema->Init();
@@ -81,3 +172,228 @@ std::unique_ptr<ColumnLayoutRelationData> ColumnLayoutRelationData::CreateFrom(
     return std::make_unique<ColumnLayoutRelationData>(std::move(schema), std::move(column_data));
 }
 
+/* Encodes the rows left in file_input, see ColumnLayoutRelationData::CreateFrom() */
+std::vector<std::vector<int>> EncodeFile(CSVParser& file_input, int num_columns, long max_rows,
+                                         unsigned threads_num) {
+    std::vector<std::vector<int>> column_vectors;
+    std::vector<int> column_indices(num_columns);
+    std::iota(column_indices.begin(), column_indices.end(), 0);
+
+    if (threads_num > 1 && max_rows <= 0) {
+        /* Every chunk of the file is tokenized and encoded by its own thread, then the chunk
+         * dictionaries get merged column-parallel. Chunks are kept in file order, so is the
+         * order of the rows */
+        std::vector<CSVParser> chunk_parsers = file_input.SplitIntoChunks(threads_num);
+        std::vector<EncodedRows> chunks(chunk_parsers.size(), EncodedRows(num_columns));
+        std::vector<std::size_t> chunk_indices(chunks.size());
+        std::iota(chunk_indices.begin(), chunk_indices.end(), 0);
+        util::parallel_foreach(chunk_indices.begin(), chunk_indices.end(), threads_num,
+                               [&chunk_parsers, &chunks, num_columns](std::size_t i) {
+                                   EncodeRows(chunk_parsers[i], num_columns, -1, 1, chunks[i]);
+                               });
+
+        column_vectors.resize(num_columns);
+        util::parallel_foreach(column_indices.begin(), column_indices.end(), threads_num,
+                               [&column_vectors, &chunks](int i) {
+                                   column_vectors[i] = MergeColumn(chunks, i);
+                               });
+    } else {
+        EncodedRows encoded(num_columns);
+        EncodeRows(file_input, num_columns, max_rows, threads_num, encoded);
+        column_vectors = std::move(encoded.column_vectors);
+    }
+
+    return column_vectors;
+}
+
+/* Snapshots are stored in native byte order as the magic number, the key, the number of columns,
+ * the number of rows, the column names and then the value ids of every column. Strings are
+ * stored as their length followed by their characters */
+constexpr std::uint64_t kSnapshotMagic = 0x31504e5344524c43;  // "CLRDSNP1"
+
+/* Snapshot is valid only for the same version of the file parsed with the same settings */
+std::string MakeSnapshotKey(CSVParser const& file_input, bool is_null_eq_null) {
+    std::filesystem::path const path = std::filesystem::weakly_canonical(file_input.GetPath());
+    std::ostringstream key;
+    key << path.string() << '\n'
+        << std::filesystem::file_size(path) << '\n'
+        << std::filesystem::last_write_time(path).time_since_epoch().count() << '\n'
+        << file_input.GetSeparator() << file_input.GetHasHeader() << is_null_eq_null;
+    return key.str();
+}
+
+/* One snapshot file per input file and settings, it gets overwritten when the file changes */
+std::filesystem::path GetSnapshotPath(std::filesystem::path const& snapshot_dir,
+                                      CSVParser const& file_input, bool is_null_eq_null) {
+    std::ostringstream name;
+    name << file_input.GetRelationName() << '-'
+         << std::hash<std::string>()(
+                std::filesystem::weakly_canonical(file_input.GetPath()).string())
+         << '-' << (int)file_input.GetSeparator() << file_input.GetHasHeader()
+         << is_null_eq_null << ".snapshot";
+    return snapshot_dir / name.str();
+}
+
+struct RelationSnapshot {
+    std::vector<std::string> column_names;
+    std::vector<std::vector<int>> column_vectors;
+};
+
+/* Returns false if there is no snapshot with the given key at path */
+bool ReadSnapshot(std::filesystem::path const& path, std::string const& key,
+                  RelationSnapshot& snapshot) {
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error)) {
+        return false;
+    }
+    std::uintmax_t remaining = std::filesystem::file_size(path, error);
+    if (error || remaining == 0) {
+        return false;
+    }
+    std::ifstream file(path, std::ios::binary);
+    // Value ids are read straight into the column vectors, there is nothing to copy afterwards
+    auto const read = [&file, &remaining](void* destination, std::size_t size) {
+        if (remaining < size || !file.read(static_cast<char*>(destination), size)) return false;
+        remaining -= size;
+        return true;
+    };
+    auto const read_string = [&read, &remaining](std::string& string) {
+        std::uint64_t size;
+        if (!read(&size, sizeof(size)) || remaining < size) return false;
+        string.resize(size);
+        return read(string.data(), size);
+    };
+
+    std::uint64_t magic;
+    std::string stored_key;
+    std::uint64_t num_columns;
+    std::uint64_t num_rows;
+    if (!file || !read(&magic, sizeof(magic)) || magic != kSnapshotMagic ||
+        !read_string(stored_key) || stored_key != key ||
+        !read(&num_columns, sizeof(num_columns)) || !read(&num_rows, sizeof(num_rows))) {
+        return false;
+    }
+    snapshot.column_names.resize(num_columns);
+    for (std::string& column_name : snapshot.column_names) {
+        if (!read_string(column_name)) return false;
+    }
+    if (remaining != num_columns * num_rows * sizeof(int)) return false;
+    snapshot.column_vectors.resize(num_columns);
+    for (std::vector<int>& column_vector : snapshot.column_vectors) {
+        column_vector.resize(num_rows);
+        if (!read(column_vector.data(), num_rows * sizeof(int))) return false;
+    }
+    return true;
+}
+
+/* Writes to a temporary file first, so that an interrupted write never leaves a snapshot that
+ * looks valid. The temporary file is unique to the writer, so concurrent writers of the same
+ * snapshot do not clobber each other, and the last rename wins */
+void WriteSnapshot(std::filesystem::path const& path, std::string const& key,
+                   RelationSnapshot const& snapshot) {
+    std::filesystem::create_directories(path.parent_path());
+    std::random_device random_device;
+    std::ostringstream suffix;
+    suffix << '.' << std::hex << std::hash<std::thread::id>()(std::this_thread::get_id()) << '-'
+           << random_device() << random_device() << ".tmp";
+    std::filesystem::path temporary_path = path;
+    temporary_path += suffix.str();
+    try {
+        {
+            std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+            auto const write = [&file](void const* source, std::size_t size) {
+                file.write(static_cast<char const*>(source), size);
+            };
+            auto const write_string = [&write](std::string const& string) {
+                std::uint64_t size = string.size();
+                write(&size, sizeof(size));
+                write(string.data(), size);
+            };
+
+            std::uint64_t const num_columns = snapshot.column_vectors.size();
+            std::uint64_t const num_rows =
+                snapshot.column_vectors.empty() ? 0 : snapshot.column_vectors[0].size();
+            write(&kSnapshotMagic, sizeof(kSnapshotMagic));
+            write_string(key);
+            write(&num_columns, sizeof(num_columns));
+            write(&num_rows, sizeof(num_rows));
+            for (std::string const& column_name : snapshot.column_names) {
+                write_string(column_name);
+            }
+            for (std::vector<int> const& column_vector : snapshot.column_vectors) {
+                write(column_vector.data(), column_vector.size() * sizeof(int));
+            }
+            file.close();
+            if (!file) {
+                throw std::runtime_error("Error: couldn't write snapshot " +
+                                         temporary_path.string());
+            }
+        }
+        std::filesystem::rename(temporary_path, path);
+    } catch (...) {
+        std::error_code error;
+        std::filesystem::remove(temporary_path, error);
+        throw;
+    }
+}
+
+}  // namespace
+
+std::unique_ptr<ColumnLayoutRelationData> ColumnLayoutRelationData::CreateFrom(
+    CSVParser& file_input, bool is_null_eq_null, int max_cols, long max_rows,
+    unsigned threads_num) {
+    int num_columns = file_input.GetNumberOfColumns();
+    if (max_cols > 0) num_columns = std::min(num_columns, max_cols);
+    std::vector<std::vector<int>> column_vectors =
+        EncodeFile(file_input, num_columns, max_rows, threads_num);
+    return BuildRelation(file_input.GetRelationName(), file_input.GetColumnNames(num_columns),
+                         column_vectors, is_null_eq_null, threads_num);
+}
+
+std::unique_ptr<ColumnLayoutRelationData> ColumnLayoutRelationData::CreateFrom(
+    CSVParser& file_input, bool is_null_eq_null, std::filesystem::path const& snapshot_dir,
+    unsigned threads_num) {
+    std::filesystem::path const snapshot_path =
+        GetSnapshotPath(snapshot_dir, file_input, is_null_eq_null);
+    std::string const key = MakeSnapshotKey(file_input, is_null_eq_null);
+    RelationSnapshot snapshot;
+    if (ReadSnapshot(snapshot_path, key, snapshot)) {
+        LOG(INFO) << "Loaded the encoded relation from " << snapshot_path;
+    } else {
+        int num_columns = file_input.GetNumberOfColumns();
+        snapshot.column_vectors = EncodeFile(file_input, num_columns, -1, threads_num);
+        snapshot.column_names = file_input.GetColumnNames(num_columns);
+        WriteSnapshot(snapshot_path, key, snapshot);
+    }
+    return BuildRelation(file_input.GetRelationName(), snapshot.column_names,
+                         snapshot.column_vectors, is_null_eq_null, threads_num);
+}
+
+std::unique_ptr<ColumnLayoutRelationData> ColumnLayoutRelationData::CreateFrom(
+    std::string const& relation_name, std::vector<std::string> const& column_names,
+    std::vector<std::vector<std::string>> const& columns, bool is_null_eq_null,
+    unsigned threads_num) {
+    std::vector<std::vector<int>> column_vectors(columns.size());
+    std::vector<int> column_indices(columns.size());
+    std::iota(column_indices.begin(), column_indices.end(), 0);
+    util::parallel_foreach(
+        column_indices.begin(), column_indices.end(), threads_num,
+        [&columns, &column_vectors](int i) {
+            std::unordered_map<std::string_view, int> value_dictionary;
+            std::vector<int>& column_vector = column_vectors[i];
+            column_vector.reserve(columns[i].size());
+            for (std::string const& field : columns[i]) {
+                if (field.empty()) {
+                    column_vector.push_back(kNullValueId);
+                } else {
+                    int next_value_id = value_dictionary.size() + 1;
+                    column_vector.push_back(
+                        value_dictionary.try_emplace(field, next_value_id).first->second);
+                }
+            }
+        });
+
+    return BuildRelation(relation_name, column_names, column_vectors, is_null_eq_null,
+                         threads_num);
+}
+
@@ -6,6 +6,8 @@
 #pragma once
 
 #include <cmath>
+#include <filesystem>
+#include <string>
 #include <vector>
 
 #include "ColumnData.h"
@@ -16,6 +18,8 @@
 class ColumnLayoutRelationData final : public RelationData {
 public:
     static constexpr int kNullValueId = -1;
+    /* Number of rows parsed before the buffered fields get dictionary-encoded */
+    static constexpr int kEncodingBlockRows = 1 << 14;
 
     using RelationData::AbstractRelationData;
 
@@ -27,9 +31,22 @@ public:
     }
     [[nodiscard]] std::vector<int> GetTuple(int tuple_index) const;
 
+    /* Encodes the columns and builds their PLIs using up to threads_num threads */
     static std::unique_ptr<ColumnLayoutRelationData> CreateFrom(CSVParser& file_input,
                                                                 bool is_null_eq_null,
                                                                 int max_cols = -1,
-                                                                long max_rows = -1);
+                                                                long max_rows = -1,
+                                                                unsigned threads_num = 1);
+    /* Loads the encoded columns from the binary snapshot of the file kept in snapshot_dir. The
+     * snapshot is (re)written from the file if it is missing or was made from another version of
+     * the file or with other settings */
+    static std::unique_ptr<ColumnLayoutRelationData> CreateFrom(
+        CSVParser& file_input, bool is_null_eq_null, std::filesystem::path const& snapshot_dir,
+        unsigned threads_num = 1);
+    /* Encodes columns parsed beforehand, empty fields are nulls */
+    static std::unique_ptr<ColumnLayoutRelationData> CreateFrom(
+        std::string const& relation_name, std::vector<std::string> const& column_names,
+        std::vector<std::vector<std::string>> const& columns, bool is_null_eq_null,
+        unsigned threads_num = 1);
 };
 
@@ -1,29 +1,30 @@
 #include "ColumnLayoutTypedRelationData.h"
 
+#include <string>
+#include <string_view>
+
 #include <easylogging++.h>
 
+#include "ColumnLayoutRelationData.h"
+
 namespace model {
 
-std::unique_ptr<ColumnLayoutTypedRelationData> ColumnLayoutTypedRelationData::CreateFrom(
-    CSVParser& file_input, bool is_null_eq_null, int max_cols, long max_rows) {
-    auto schema = std::make_unique<RelationalSchema>(file_input.GetRelationName(), is_null_eq_null);
-    int num_columns = file_input.GetNumberOfColumns();
-
-    if (max_cols > 0) {
-        num_columns = std::min(num_columns, max_cols);
-    }
+namespace {
 
+/* Reads the rows left in file_input column-wise */
+std::vector<std::vector<std::string>> ParseColumns(CSVParser& file_input, int num_columns,
+                                                   long max_rows) {
     std::vector<std::vector<std::string>> columns(num_columns);
     int row_num = 0;
-    std::vector<std::string> row;
+    std::vector<std::string_view> row;
 
     /* Parsing is very similar to ColumnLayoutRelationData::CreateFrom().
      * Maybe we need column-based parsing in addition to row-based in CSVParser */
     while (file_input.GetHasNext()) {
-        row = file_input.ParseNext();
+        file_input.ParseNext(row);
 
         if (row.empty() && num_columns == 1) {
-            row.emplace_back("");
+            row.emplace_back();
         } else if ((int)row.size() != num_columns) {
             LOG(WARNING) << "Skipping incomplete rows";
             continue;
@@ -31,8 +32,8 @@ std::unique_ptr<ColumnLayoutTypedRelationData> ColumnLayoutTypedRelationData::Cr
 
         if (max_rows <= 0 || row_num < max_rows) {
             int index = 0;
-            for (std::string& field : row) {
-                columns[index].push_back(std::move(field));
+            for (std::string_view field : row) {
+                columns[index].emplace_back(field);
                 index++;
                 if (index >= num_columns) {
                     break;
@@ -45,10 +46,18 @@ std::unique_ptr<ColumnLayoutTypedRelationData> ColumnLayoutTypedRelationData::Cr
         }
         row_num++;
     }
+    return columns;
+}
+
+std::unique_ptr<ColumnLayoutTypedRelationData> BuildTypedRelation(
+    std::string const& relation_name, std::vector<std::string> const& column_names,
+    std::vector<std::vector<std::string>> columns, bool is_null_eq_null) {
+    auto schema = std::make_unique<RelationalSchema>(relation_name, is_null_eq_null);
+    int num_columns = columns.size();
 
     std::vector<TypedColumnData> column_data;
     for (int i = 0; i < num_columns; ++i) {
-        Column column(schema.get(), file_input.GetColumnName(i), i);
+        Column column(schema.get(), column_names[i], i);
         schema->AppendColumn(std::move(column));
         TypedColumnData typed_column_data = model::TypedColumnDataFactory::CreateFrom(
             schema->GetColumn(i), std::move(columns[i]), is_null_eq_null);
@@ -61,4 +70,40 @@ std::unique_ptr<ColumnLayoutTypedRelationData> ColumnLayoutTypedRelationData::Cr
                                                            std::move(column_data));
 }
 
+}  // namespace
+
+std::unique_ptr<ColumnLayoutTypedRelationData> ColumnLayoutTypedRelationData::CreateFrom(
+    CSVParser& file_input, bool is_null_eq_null, int max_cols, long max_rows) {
+    int num_columns = file_input.GetNumberOfColumns();
+
+    if (max_cols > 0) {
+        num_columns = std::min(num_columns, max_cols);
+    }
+
+    return BuildTypedRelation(file_input.GetRelationName(),
+                              file_input.GetColumnNames(num_columns),
+                              ParseColumns(file_input, num_columns, max_rows), is_null_eq_null);
+}
+
+std::pair<std::unique_ptr<ColumnLayoutRelationData>,
+          std::unique_ptr<ColumnLayoutTypedRelationData>>
+ColumnLayoutTypedRelationData::CreateWithUntypedFrom(CSVParser& file_input, bool is_null_eq_null,
+                                                     int max_cols, long max_rows) {
+    int num_columns = file_input.GetNumberOfColumns();
+
+    if (max_cols > 0) {
+        num_columns = std::min(num_columns, max_cols);
+    }
+
+    std::vector<std::string> column_names = file_input.GetColumnNames(num_columns);
+    std::vector<std::vector<std::string>> columns =
+        ParseColumns(file_input, num_columns, max_rows);
+    /* Encode the parsed fields first, then hand them over to the typed columns */
+    std::unique_ptr<ColumnLayoutRelationData> relation = ColumnLayoutRelationData::CreateFrom(
+        file_input.GetRelationName(), column_names, columns, is_null_eq_null);
+    std::unique_ptr<ColumnLayoutTypedRelationData> typed_relation = BuildTypedRelation(
+        file_input.GetRelationName(), column_names, std::move(columns), is_null_eq_null);
+    return {std::move(relation), std::move(typed_relation)};
+}
+
 }  // namespace model
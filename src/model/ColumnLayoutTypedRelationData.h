@@ -1,9 +1,14 @@
 #pragma once
 
+#include <memory>
+#include <utility>
+
 #include "CSVParser.h"
 #include "RelationData.h"
 #include "TypedColumnData.h"
 
+class ColumnLayoutRelationData;
+
 namespace model {
 
 using TypedRelationData = AbstractRelationData<TypedColumnData>;
@@ -24,6 +29,12 @@ public:
                                                                      bool is_null_eq_null,
                                                                      int max_cols = -1,
                                                                      long max_rows = -1);
+    /* Parses the table once and builds both its dictionary-encoded and its typed representation
+     * from the same parsed fields */
+    static std::pair<std::unique_ptr<ColumnLayoutRelationData>,
+                     std::unique_ptr<ColumnLayoutTypedRelationData>>
+    CreateWithUntypedFrom(CSVParser& file_input, bool is_null_eq_null, int max_cols = -1,
+                          long max_rows = -1);
 };
 
 }  // namespace model
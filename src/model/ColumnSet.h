@@ -0,0 +1,296 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <variant>
+
+#include <boost/dynamic_bitset.hpp>
+
+/* Set of column indices stored inline in kWords 64-bit words, so copying it and set operations
+ * on it never allocate. Loops over the words have a constant trip count, which lets the compiler
+ * unroll and vectorize them. The interface follows boost::dynamic_bitset, so code can be generic
+ * over both. Bits at and above size() are always zero */
+template <std::size_t kWords>
+class FixedColumnSet {
+private:
+    static constexpr std::size_t kWordBits = 64;
+
+    std::array<std::uint64_t, kWords> words_{};
+    std::size_t size_ = 0;
+
+    static std::size_t WordIndex(std::size_t pos) noexcept { return pos / kWordBits; }
+    static std::uint64_t BitMask(std::size_t pos) noexcept {
+        return std::uint64_t{1} << (pos % kWordBits);
+    }
+    /* Position of the first set bit not less than pos */
+    std::size_t FindFrom(std::size_t pos) const noexcept {
+        std::size_t i = WordIndex(pos);
+        if (i >= kWords) {
+            return npos;
+        }
+        std::uint64_t word = words_[i] & (~std::uint64_t{0} << (pos % kWordBits));
+        while (word == 0) {
+            if (++i == kWords) {
+                return npos;
+            }
+            word = words_[i];
+        }
+        return i * kWordBits + __builtin_ctzll(word);
+    }
+
+public:
+    static constexpr std::size_t kCapacity = kWords * kWordBits;
+    static constexpr std::size_t npos = boost::dynamic_bitset<>::npos;
+
+    FixedColumnSet() = default;
+    explicit FixedColumnSet(std::size_t size) noexcept : size_(size) { assert(size <= kCapacity); }
+
+    std::size_t size() const noexcept { return size_; }
+    std::size_t count() const noexcept {
+        std::size_t count = 0;
+        for (std::uint64_t word : words_) {
+            count += __builtin_popcountll(word);
+        }
+        return count;
+    }
+    bool any() const noexcept {
+        std::uint64_t bits = 0;
+        for (std::uint64_t word : words_) {
+            bits |= word;
+        }
+        return bits != 0;
+    }
+    bool none() const noexcept { return !any(); }
+
+    bool test(std::size_t pos) const noexcept {
+        assert(pos < size_);
+        return (words_[WordIndex(pos)] & BitMask(pos)) != 0;
+    }
+    bool operator[](std::size_t pos) const noexcept { return test(pos); }
+    FixedColumnSet& set(std::size_t pos, bool value = true) noexcept {
+        assert(pos < size_);
+        if (value) {
+            words_[WordIndex(pos)] |= BitMask(pos);
+        } else {
+            words_[WordIndex(pos)] &= ~BitMask(pos);
+        }
+        return *this;
+    }
+    FixedColumnSet& reset(std::size_t pos) noexcept { return set(pos, false); }
+    FixedColumnSet& reset() noexcept {
+        words_.fill(0);
+        return *this;
+    }
+    FixedColumnSet& flip() noexcept {
+        for (std::size_t i = 0; i < kWords; ++i) {
+            std::size_t const begin = i * kWordBits;
+            if (begin >= size_) {
+                break;
+            }
+            std::size_t const bits = size_ - begin;
+            words_[i] = ~words_[i] & (bits >= kWordBits ? ~std::uint64_t{0}
+                                                         : (std::uint64_t{1} << bits) - 1);
+        }
+        return *this;
+    }
+
+    std::size_t find_first() const noexcept { return FindFrom(0); }
+    std::size_t find_next(std::size_t pos) const noexcept {
+        return pos + 1 >= size_ ? npos : FindFrom(pos + 1);
+    }
+    bool is_subset_of(FixedColumnSet const& that) const noexcept {
+        std::uint64_t excess = 0;
+        for (std::size_t i = 0; i < kWords; ++i) {
+            excess |= words_[i] & ~that.words_[i];
+        }
+        return excess == 0;
+    }
+    bool intersects(FixedColumnSet const& that) const noexcept {
+        std::uint64_t common = 0;
+        for (std::size_t i = 0; i < kWords; ++i) {
+            common |= words_[i] & that.words_[i];
+        }
+        return common != 0;
+    }
+
+    FixedColumnSet& operator|=(FixedColumnSet const& that) noexcept {
+        for (std::size_t i = 0; i < kWords; ++i) {
+            words_[i] |= that.words_[i];
+        }
+        return *this;
+    }
+    FixedColumnSet& operator&=(FixedColumnSet const& that) noexcept {
+        for (std::size_t i = 0; i < kWords; ++i) {
+            words_[i] &= that.words_[i];
+        }
+        return *this;
+    }
+    FixedColumnSet& operator^=(FixedColumnSet const& that) noexcept {
+        for (std::size_t i = 0; i < kWords; ++i) {
+            words_[i] ^= that.words_[i];
+        }
+        return *this;
+    }
+    FixedColumnSet& operator-=(FixedColumnSet const& that) noexcept {
+        for (std::size_t i = 0; i < kWords; ++i) {
+            words_[i] &= ~that.words_[i];
+        }
+        return *this;
+    }
+
+    bool operator==(FixedColumnSet const& that) const noexcept {
+        return size_ == that.size_ && words_ == that.words_;
+    }
+    bool operator!=(FixedColumnSet const& that) const noexcept { return !(*this == that); }
+
+    /* Depends on all the bits, unlike dynamic_bitset::to_ulong() */
+    std::size_t Hash() const noexcept {
+        std::size_t hash = size_;
+        for (std::uint64_t word : words_) {
+            hash ^= word + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        }
+        return hash;
+    }
+};
+
+/* Column indices of a Vertical. The representation is chosen by the width of the schema when the
+ * set is created: schemas of up to 64, 128 and 256 columns get a FixedColumnSet of 1, 2 and 4
+ * words, wider ones fall back to boost::dynamic_bitset. Sets taking part in one operation must
+ * come from the same schema */
+class ColumnSet {
+private:
+    using Storage = std::variant<FixedColumnSet<1>, FixedColumnSet<2>, FixedColumnSet<4>,
+                                 boost::dynamic_bitset<>>;
+
+    Storage storage_;
+
+    static Storage MakeStorage(std::size_t size) {
+        if (size <= FixedColumnSet<1>::kCapacity) return FixedColumnSet<1>(size);
+        if (size <= FixedColumnSet<2>::kCapacity) return FixedColumnSet<2>(size);
+        if (size <= FixedColumnSet<4>::kCapacity) return FixedColumnSet<4>(size);
+        return boost::dynamic_bitset<>(size);
+    }
+
+    /* Applies op to the representations of this set and that one, which are of the same type */
+    template <typename Op>
+    ColumnSet& Combine(ColumnSet const& that, Op op) {
+        assert(storage_.index() == that.storage_.index());
+        std::visit(
+            [&that, &op](auto& bits) {
+                op(bits, std::get<std::decay_t<decltype(bits)>>(that.storage_));
+            },
+            storage_);
+        return *this;
+    }
+    template <typename Op>
+    bool Compare(ColumnSet const& that, Op op) const {
+        assert(storage_.index() == that.storage_.index());
+        return std::visit(
+            [&that, &op](auto const& bits) {
+                return op(bits, std::get<std::decay_t<decltype(bits)>>(that.storage_));
+            },
+            storage_);
+    }
+
+public:
+    static constexpr std::size_t npos = boost::dynamic_bitset<>::npos;
+
+    ColumnSet() : storage_(FixedColumnSet<1>()) {}
+    explicit ColumnSet(std::size_t size) : storage_(MakeStorage(size)) {}
+    explicit ColumnSet(boost::dynamic_bitset<> const& bits) : storage_(MakeStorage(bits.size())) {
+        if (auto* dynamic_bits = std::get_if<boost::dynamic_bitset<>>(&storage_)) {
+            *dynamic_bits = bits;
+            return;
+        }
+        for (std::size_t pos = bits.find_first(); pos != npos; pos = bits.find_next(pos)) {
+            set(pos);
+        }
+    }
+
+    boost::dynamic_bitset<> ToDynamicBitset() const {
+        if (auto const* dynamic_bits = std::get_if<boost::dynamic_bitset<>>(&storage_)) {
+            return *dynamic_bits;
+        }
+        boost::dynamic_bitset<> bits(size());
+        for (std::size_t pos = find_first(); pos != npos; pos = find_next(pos)) {
+            bits.set(pos);
+        }
+        return bits;
+    }
+
+    std::size_t size() const noexcept {
+        return std::visit([](auto const& bits) { return bits.size(); }, storage_);
+    }
+    std::size_t count() const noexcept {
+        return std::visit([](auto const& bits) { return bits.count(); }, storage_);
+    }
+    bool any() const noexcept {
+        return std::visit([](auto const& bits) { return bits.any(); }, storage_);
+    }
+    bool none() const noexcept { return !any(); }
+    bool test(std::size_t pos) const {
+        return std::visit([pos](auto const& bits) { return bits.test(pos); }, storage_);
+    }
+    bool operator[](std::size_t pos) const { return test(pos); }
+    ColumnSet& set(std::size_t pos, bool value = true) {
+        std::visit([pos, value](auto& bits) { bits.set(pos, value); }, storage_);
+        return *this;
+    }
+    ColumnSet& reset(std::size_t pos) { return set(pos, false); }
+    ColumnSet& reset() {
+        std::visit([](auto& bits) { bits.reset(); }, storage_);
+        return *this;
+    }
+    ColumnSet& flip() {
+        std::visit([](auto& bits) { bits.flip(); }, storage_);
+        return *this;
+    }
+    std::size_t find_first() const noexcept {
+        return std::visit([](auto const& bits) { return bits.find_first(); }, storage_);
+    }
+    std::size_t find_next(std::size_t pos) const noexcept {
+        return std::visit([pos](auto const& bits) { return bits.find_next(pos); }, storage_);
+    }
+
+    bool is_subset_of(ColumnSet const& that) const {
+        return Compare(that, [](auto const& a, auto const& b) { return a.is_subset_of(b); });
+    }
+    bool intersects(ColumnSet const& that) const {
+        return Compare(that, [](auto const& a, auto const& b) { return a.intersects(b); });
+    }
+    bool operator==(ColumnSet const& that) const {
+        return storage_.index() == that.storage_.index() &&
+               Compare(that, [](auto const& a, auto const& b) { return a == b; });
+    }
+    bool operator!=(ColumnSet const& that) const { return !(*this == that); }
+
+    ColumnSet& operator|=(ColumnSet const& that) {
+        return Combine(that, [](auto& a, auto const& b) { a |= b; });
+    }
+    ColumnSet& operator&=(ColumnSet const& that) {
+        return Combine(that, [](auto& a, auto const& b) { a &= b; });
+    }
+    ColumnSet& operator^=(ColumnSet const& that) {
+        return Combine(that, [](auto& a, auto const& b) { a ^= b; });
+    }
+    ColumnSet& operator-=(ColumnSet const& that) {
+        return Combine(that, [](auto& a, auto const& b) { a -= b; });
+    }
+
+    /* Depends on all the bits, unlike dynamic_bitset::to_ulong() */
+    std::size_t Hash() const {
+        return std::visit(
+            [](auto const& bits) -> std::size_t {
+                if constexpr (std::is_same_v<std::decay_t<decltype(bits)>,
+                                             boost::dynamic_bitset<>>) {
+                    return boost::hash_value(bits);
+                } else {
+                    return bits.Hash();
+                }
+            },
+            storage_);
+    }
+};
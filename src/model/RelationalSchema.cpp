@@ -60,7 +60,8 @@ bool RelationalSchema::IsNullEqualNull() const { return is_null_eq_null_; }
 // TODO: list -> vector as list doesn't have RAIterators therefore can't be sorted
 std::unordered_set<Vertical> RelationalSchema::CalculateHittingSet(
     std::vector<Vertical> verticals,
-    boost::optional<std::function<bool(Vertical const&)>> pruning_function) const {
+    boost::optional<std::function<boost::dynamic_bitset<>(std::vector<Vertical> const&)>>
+        pruning_function) const {
     std::sort(verticals.begin(), verticals.end(), [](auto& vertical1, auto& vertical2) {
         return vertical1.GetArity() < vertical2.GetArity();
     });
@@ -86,24 +87,37 @@ std::unordered_set<Vertical> RelationalSchema::CalculateHittingSet(
             hitting_set.Remove(invalid_hitting_set_member);
         }
 
+        /* Members found in the hitting set now stay there while the corrected members are
+         * added, and pruning does not depend on it, so both checks are done for all of them in
+         * batches before adding them one by one */
+        std::vector<Vertical> corrected_members;
         for (auto& invalid_member : invalid_hitting_set_members) {
-            for (size_t corrective_column_index = vertical.GetColumnIndices().find_first();
+            for (size_t corrective_column_index = vertical.GetColumnSet().find_first();
                  corrective_column_index != boost::dynamic_bitset<>::npos;
                  corrective_column_index =
-                     vertical.GetColumnIndices().find_next(corrective_column_index)) {
+                     vertical.GetColumnSet().find_next(corrective_column_index)) {
                 auto corrective_column = *GetColumn(corrective_column_index);
-                auto corrected_member =
-                    invalid_member.Union(static_cast<Vertical>(corrective_column));
-
-                if (hitting_set.GetAnySubsetEntry(corrected_member).second == nullptr) {
-                    if (pruning_function) {
-                        bool is_pruned = (*pruning_function)(corrected_member);
-                        if (is_pruned) {
-                            continue;
-                        }
-                    }
-                    hitting_set.Put(corrected_member, std::make_unique<Vertical>(corrected_member));
-                }
+                corrected_members.push_back(
+                    invalid_member.Union(static_cast<Vertical>(corrective_column)));
+            }
+        }
+        auto covering_entries = hitting_set.GetAnySubsetEntries(corrected_members);
+        std::vector<Vertical> uncovered_members;
+        for (size_t i = 0; i < corrected_members.size(); ++i) {
+            if (covering_entries[i].second == nullptr) {
+                uncovered_members.push_back(std::move(corrected_members[i]));
+            }
+        }
+        boost::dynamic_bitset<> is_pruned(uncovered_members.size());
+        if (pruning_function && !uncovered_members.empty()) {
+            is_pruned = (*pruning_function)(uncovered_members);
+        }
+
+        for (size_t i = 0; i < uncovered_members.size(); ++i) {
+            Vertical const& corrected_member = uncovered_members[i];
+            if (!is_pruned[i] &&
+                hitting_set.GetAnySubsetEntry(corrected_member).second == nullptr) {
+                hitting_set.Put(corrected_member, std::make_unique<Vertical>(corrected_member));
             }
         }
         if (hitting_set.IsEmpty()) break;
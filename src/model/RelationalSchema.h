@@ -46,9 +46,12 @@ public:
     template <typename ForwardIt>
     boost::dynamic_bitset<> IndicesToBitset(ForwardIt begin, ForwardIt end) const;
 
+    /* pruning_function takes a batch of hitting set candidates and returns the bitset of the
+     * pruned ones */
     std::unordered_set<Vertical> CalculateHittingSet(
         std::vector<Vertical> verticals,
-        boost::optional<std::function<bool(Vertical const&)>> pruning_function) const;
+        boost::optional<std::function<boost::dynamic_bitset<>(std::vector<Vertical> const&)>>
+            pruning_function) const;
 
     ~RelationalSchema();
 
@@ -1,6 +1,8 @@
 #include "TransactionalData.h"
 
 #include <cassert>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 
 namespace model {
@@ -28,20 +30,22 @@ std::unique_ptr<TransactionalData> TransactionalData::CreateFromSingular(CSVPars
     assert(file_input.GetNumberOfColumns() >
            static_cast<int>(std::max(tid_col_index, item_col_index)));
 
+    std::vector<std::string_view> row;
+    std::string item_name;
     while (file_input.GetHasNext()) {
-        std::vector<std::string> row = file_input.ParseNext();
+        file_input.ParseNext(row);
         if (row.empty()) {
             continue;
         }
 
-        unsigned const tid = std::stoi(row[tid_col_index]);
-        std::string& item_name = row[item_col_index];
+        unsigned const tid = std::stoi(std::string(row[tid_col_index]));
+        item_name.assign(row[item_col_index]);
         unsigned item_id = latest_item_id;
 
         auto const [item_iter, was_inserted] = item_universe_set.try_emplace(item_name, item_id);
         if (was_inserted) {
             // TODO(alexandrsmirn) попробовать избежать этого добавления.
-            item_universe.push_back(std::move(item_name));
+            item_universe.push_back(item_name);
             ++latest_item_id;
         } else {
             // if this item already exists in the universe, set the old item id
@@ -68,30 +72,32 @@ std::unique_ptr<TransactionalData> TransactionalData::CreateFromTabular(CSVParse
     unsigned latest_item_id = 0;
     unsigned tid = 0;
 
+    std::vector<std::string_view> row;
+    std::string item_name;
     while (file_input.GetHasNext()) {
-        std::vector<std::string> row = file_input.ParseNext();
+        file_input.ParseNext(row);
         if (row.empty()) {
             continue;
         }
 
         auto row_iter = row.begin();
         if (has_tid) {
-            tid = std::stoi(*row_iter);
+            tid = std::stoi(std::string(*row_iter));
             row_iter++;
         }
 
         Itemset items;
         for (; row_iter != row.end(); ++row_iter) {
-            std::string& item_name = *row_iter;
-            if (item_name.empty()) {
+            if (row_iter->empty()) {
                 continue;
             }
+            item_name.assign(*row_iter);
             unsigned item_id = latest_item_id;
 
             auto const [item_iter, was_inserted] = item_universe_set.try_emplace(item_name, item_id);
             if (was_inserted) {
                 // TODO(alexandrsmirn) попробовать избежать этого добавления.
-                item_universe.push_back(std::move(item_name));
+                item_universe.push_back(item_name);
                 ++latest_item_id;
             } else {
                 // if this item already exists in the universe, set the old item id
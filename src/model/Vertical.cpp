@@ -3,17 +3,21 @@
 #include "Vertical.h"
 
 Vertical::Vertical(RelationalSchema const* rel_schema, boost::dynamic_bitset<> indices) :
+    column_indices_(indices),
+    schema_(rel_schema) {}
+
+Vertical::Vertical(RelationalSchema const* rel_schema, ColumnSet indices) :
     column_indices_(std::move(indices)),
     schema_(rel_schema) {}
 
-Vertical::Vertical(Column const& col) : schema_(col.GetSchema()) {
-    column_indices_ = boost::dynamic_bitset<>(schema_->GetNumColumns());
+Vertical::Vertical(Column const& col) :
+    column_indices_(col.GetSchema()->GetNumColumns()),
+    schema_(col.GetSchema()) {
     column_indices_.set(col.GetIndex());
 }
 
 bool Vertical::Contains(Vertical const& that) const {
-    boost::dynamic_bitset<> const& that_indices = that.column_indices_;
-    if (column_indices_.size() < that_indices.size()) return false;
+    if (column_indices_.size() < that.column_indices_.size()) return false;
 
     return that.column_indices_.is_subset_of(column_indices_);
 }
@@ -23,62 +27,65 @@ bool Vertical::Contains(Column const& that) const {
 }
 
 bool Vertical::Intersects(Vertical const& that) const {
-    boost::dynamic_bitset<> const& that_indices = that.column_indices_;
-    return column_indices_.intersects(that_indices);
+    return column_indices_.intersects(that.column_indices_);
 }
 
 Vertical Vertical::Union(Vertical const& that) const {
-    boost::dynamic_bitset<> retained_column_indices(column_indices_);
+    ColumnSet retained_column_indices(column_indices_);
     retained_column_indices |= that.column_indices_;
-    return schema_->GetVertical(retained_column_indices);
+    return Vertical(schema_, std::move(retained_column_indices));
 }
 
 Vertical Vertical::Union(Column const& that) const {
-    boost::dynamic_bitset<> retained_column_indices(column_indices_);
+    ColumnSet retained_column_indices(column_indices_);
     retained_column_indices.set(that.GetIndex());
-    return schema_->GetVertical(retained_column_indices);
+    return Vertical(schema_, std::move(retained_column_indices));
 }
 
 Vertical Vertical::Project(Vertical const& that) const {
-    boost::dynamic_bitset<> retained_column_indices(column_indices_);
+    ColumnSet retained_column_indices(column_indices_);
     retained_column_indices &= that.column_indices_;
-    return schema_->GetVertical(retained_column_indices);
+    return Vertical(schema_, std::move(retained_column_indices));
 }
 
 Vertical Vertical::Without(Vertical const& that) const {
-    boost::dynamic_bitset<> retained_column_indices(column_indices_);
-    retained_column_indices &= ~that.column_indices_;
-    return schema_->GetVertical(retained_column_indices);
+    ColumnSet retained_column_indices(column_indices_);
+    retained_column_indices -= that.column_indices_;
+    return Vertical(schema_, std::move(retained_column_indices));
 }
 
 Vertical Vertical::Without(Column const& that) const {
-    boost::dynamic_bitset<> retained_column_indices(column_indices_);
+    ColumnSet retained_column_indices(column_indices_);
     retained_column_indices.reset(that.GetIndex());
-    return schema_->GetVertical(retained_column_indices);
+    return Vertical(schema_, std::move(retained_column_indices));
 }
 
 Vertical Vertical::Invert() const {
-    boost::dynamic_bitset<> flipped_indices(column_indices_);
-    flipped_indices.resize(schema_->GetNumColumns());
+    ColumnSet flipped_indices(column_indices_);
+    if (flipped_indices.size() != schema_->GetNumColumns()) {
+        boost::dynamic_bitset<> indices = column_indices_.ToDynamicBitset();
+        indices.resize(schema_->GetNumColumns());
+        flipped_indices = ColumnSet(indices);
+    }
     flipped_indices.flip();
-    return schema_->GetVertical(flipped_indices);
+    return Vertical(schema_, std::move(flipped_indices));
 }
 
 Vertical Vertical::Invert(Vertical const& scope) const {
-    boost::dynamic_bitset<> flipped_indices(column_indices_);
+    ColumnSet flipped_indices(column_indices_);
     flipped_indices ^= scope.column_indices_;
-    return schema_->GetVertical(flipped_indices);
+    return Vertical(schema_, std::move(flipped_indices));
 }
 
 std::unique_ptr<Vertical> Vertical::EmptyVertical(RelationalSchema const* rel_schema) {
-    return std::make_unique<Vertical>(rel_schema,
-                                      boost::dynamic_bitset<>(rel_schema->GetNumColumns()));
+    return std::unique_ptr<Vertical>(
+        new Vertical(rel_schema, ColumnSet(rel_schema->GetNumColumns())));
 }
 
 std::vector<Column const*> Vertical::GetColumns() const {
     std::vector<Column const*> columns;
     for (size_t index = column_indices_.find_first();
-         index != boost::dynamic_bitset<>::npos;
+         index != ColumnSet::npos;
          index = column_indices_.find_next(index)) {
         columns.push_back(schema_->GetColumns()[index].get());
     }
@@ -88,7 +95,7 @@ std::vector<Column const*> Vertical::GetColumns() const {
 std::vector<unsigned> Vertical::GetColumnIndicesAsVector() const {
     std::vector<unsigned> columns;
     for (size_t index = column_indices_.find_first();
-         index != boost::dynamic_bitset<>::npos;
+         index != ColumnSet::npos;
          index = column_indices_.find_next(index)) {
         columns.push_back(schema_->GetColumns()[index].get()->GetIndex());
     }
@@ -98,14 +105,14 @@ std::vector<unsigned> Vertical::GetColumnIndicesAsVector() const {
 std::string Vertical::ToString() const {
     std::string result = "[";
 
-    if (column_indices_.find_first() == boost::dynamic_bitset<>::npos)
+    if (column_indices_.find_first() == ColumnSet::npos)
         return "[]";
 
     for (size_t index = column_indices_.find_first();
-         index != boost::dynamic_bitset<>::npos;
+         index != ColumnSet::npos;
          index = column_indices_.find_next(index)) {
         result += schema_->GetColumn(index)->GetName();
-        if (column_indices_.find_next(index) != boost::dynamic_bitset<>::npos) {
+        if (column_indices_.find_next(index) != ColumnSet::npos) {
             result += ' ';
         }
     }
@@ -118,15 +125,15 @@ std::string Vertical::ToString() const {
 std::string Vertical::ToIndicesString() const {
     std::string result = "[";
 
-    if (column_indices_.find_first() == boost::dynamic_bitset<>::npos) {
+    if (column_indices_.find_first() == ColumnSet::npos) {
         return "[]";
     }
 
     for (size_t index = column_indices_.find_first();
-         index != boost::dynamic_bitset<>::npos;
+         index != ColumnSet::npos;
          index = column_indices_.find_next(index)) {
         result += std::to_string(index);
-        if (column_indices_.find_next(index) != boost::dynamic_bitset<>::npos) {
+        if (column_indices_.find_next(index) != ColumnSet::npos) {
             result += ',';
         }
     }
@@ -141,11 +148,11 @@ std::vector<Vertical> Vertical::GetParents() const {
     std::vector<Vertical> parents(GetArity());
     int i = 0;
     for (size_t column_index = column_indices_.find_first();
-         column_index != boost::dynamic_bitset<>::npos;
+         column_index != ColumnSet::npos;
          column_index = column_indices_.find_next(column_index)) {
-        auto parent_column_indices = column_indices_;
+        ColumnSet parent_column_indices(column_indices_);
         parent_column_indices.reset(column_index);
-        parents[i++] = GetSchema()->GetVertical(std::move(parent_column_indices));
+        parents[i++] = Vertical(schema_, std::move(parent_column_indices));
     }
     return parents;
 }
@@ -155,6 +162,7 @@ bool Vertical::operator<(Vertical const& rhs) const {
     if (this->column_indices_ == rhs.column_indices_)
         return false;
 
-    boost::dynamic_bitset<> const& lr_xor = (this->column_indices_ ^ rhs.column_indices_);
+    ColumnSet lr_xor(this->column_indices_);
+    lr_xor ^= rhs.column_indices_;
     return rhs.column_indices_.test(lr_xor.find_first());
 }
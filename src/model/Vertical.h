@@ -13,13 +13,13 @@
 #include <boost/dynamic_bitset.hpp>
 
 #include "Column.h"
+#include "ColumnSet.h"
 
 class Vertical {
 private:
     //Vertical(shared_ptr<RelationalSchema>& relSchema, int indices);
 
-    //TODO: unique_ptr<column_indices_> if this is big
-    boost::dynamic_bitset<> column_indices_;
+    ColumnSet column_indices_;
     RelationalSchema const* schema_;
 
 public:
@@ -27,6 +27,7 @@ public:
     static std::unique_ptr<Vertical> EmptyVertical(RelationalSchema const* rel_schema);
 
     Vertical(RelationalSchema const* rel_schema, boost::dynamic_bitset<> indices);
+    Vertical(RelationalSchema const* rel_schema, ColumnSet indices);
     Vertical() = default;
 
     explicit Vertical(Column const& col);
@@ -53,8 +54,9 @@ public:
     }
     bool operator>(Vertical const& rhs) const { return !(*this < rhs && *this == rhs); }
 
-    boost::dynamic_bitset<> GetColumnIndices() const { return column_indices_; }
-    boost::dynamic_bitset<> const& GetColumnIndicesRef() const { return column_indices_; }
+    /* Copies the indices into a bitset, prefer GetColumnSet() in hot code */
+    boost::dynamic_bitset<> GetColumnIndices() const { return column_indices_.ToDynamicBitset(); }
+    ColumnSet const& GetColumnSet() const { return column_indices_; }
     RelationalSchema const* GetSchema() const { return schema_; }
 
     bool Contains(Vertical const& that) const;
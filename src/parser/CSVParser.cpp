@@ -1,38 +1,52 @@
 #include "CSVParser.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <filesystem>
-#include <fstream>
+#include <functional>
+#include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
 
-#include <boost/algorithm/string.hpp>
-#include <boost/tokenizer.hpp>
+#include <boost/token_functions.hpp>
 
-inline std::string& CSVParser::rtrim(std::string& s) {
-    boost::trim_right(s);
+inline std::string_view CSVParser::rtrim(std::string_view s) {
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) {
+        s.remove_suffix(1);
+    }
     return s;
 }
 
 CSVParser::CSVParser(const std::filesystem::path& path) : CSVParser(path, ',', true) {}
 
 CSVParser::CSVParser(const std::filesystem::path& path, char separator, bool has_header)
-    : source_(path),
-      separator_(separator),
+    : separator_(separator),
       has_header_(has_header),
       has_next_(true),
       next_line_(),
       number_of_columns_(),
       column_names_(),
+      path_(path),
       relation_name_(path.filename().string()) {
     //Wrong path
-    if (!source_) {
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error)) {
         throw std::runtime_error("Error: couldn't find file " + path.string());
     }
     if (separator == '\0') {
         throw std::invalid_argument("Invalid separator");
     }
+    /* Empty files cannot be mapped */
+    if (std::filesystem::file_size(path) != 0) {
+        file_mapping_ = boost::interprocess::file_mapping(path.string().c_str(),
+                                                          boost::interprocess::read_only);
+        mapped_region_ = boost::interprocess::mapped_region(file_mapping_,
+                                                            boost::interprocess::read_only);
+        data_ = std::string_view(static_cast<char const*>(mapped_region_.get_address()),
+                                 mapped_region_.get_size());
+    }
     if (has_header) {
         GetNext();
     } else {
@@ -50,27 +64,94 @@ CSVParser::CSVParser(const std::filesystem::path& path, char separator, bool has
     }
 }
 
+CSVParser::CSVParser(CSVParser const& parent, std::string_view data)
+    : data_(data),
+      separator_(parent.separator_),
+      escape_symbol_(parent.escape_symbol_),
+      quote_(parent.quote_),
+      has_header_(false),
+      has_next_(true),
+      next_line_(),
+      number_of_columns_(parent.number_of_columns_),
+      column_names_(parent.column_names_),
+      path_(parent.path_),
+      relation_name_(parent.relation_name_) {
+    GetNext();
+}
+
+std::vector<CSVParser> CSVParser::SplitIntoChunks(unsigned chunks_num) {
+    assert(chunks_num != 0);
+    std::vector<CSVParser> chunks;
+    if (!has_next_) return chunks;
+
+    /* Rows are lines, quoted fields never span several of them. The last line of every chunk
+     * but the last one loses its line break, so that it is not followed by an empty line.
+     * Right after Reset() no line is read yet */
+    std::size_t begin =
+        next_line_.data() == nullptr ? position_ : next_line_.data() - data_.data();
+    std::size_t const chunk_size = (data_.size() - begin) / chunks_num + 1;
+    while (true) {
+        std::size_t end = begin + chunk_size < data_.size()
+                              ? data_.find('\n', begin + chunk_size)
+                              : std::string_view::npos;
+        if (end == std::string_view::npos) {
+            chunks.push_back(CSVParser(*this, data_.substr(begin)));
+            break;
+        }
+        chunks.push_back(CSVParser(*this, data_.substr(begin, end - begin)));
+        begin = end + 1;
+    }
+
+    position_ = data_.size();
+    is_eof_ = true;
+    next_line_ = {};
+    has_next_ = false;
+    return chunks;
+}
+
+bool CSVParser::IsMapped(std::string_view field) const {
+    return std::less_equal<char const*>()(data_.data(), field.data()) &&
+           std::less_equal<char const*>()(field.data() + field.size(),
+                                          data_.data() + data_.size());
+}
+
+/* Behaves like std::getline on a stream over the mapped file */
+std::string_view CSVParser::ReadLine() {
+    if (position_ >= data_.size()) {
+        is_eof_ = true;
+        return data_.substr(data_.size());
+    }
+    std::size_t line_end = data_.find('\n', position_);
+    if (line_end == std::string_view::npos) {
+        line_end = data_.size();
+        is_eof_ = true;
+    }
+    std::string_view line = data_.substr(position_, line_end - position_);
+    position_ = std::min(line_end + 1, data_.size());
+    return line;
+}
+
 void CSVParser::GetNext() {
-    next_line_ = "";
-    std::getline(source_, next_line_);
-    rtrim(next_line_);
+    next_line_ = rtrim(ReadLine());
 }
 
 void CSVParser::PeekNext() {
-    int len = source_.tellg();
+    std::size_t position = position_;
+    bool is_eof = is_eof_;
     GetNext();
-    source_.seekg(len, std::ios_base::beg);
+    position_ = position;
+    is_eof_ = is_eof;
 }
 
 void CSVParser::SkipLine() {
-    source_.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    ReadLine();
 }
 
 void CSVParser::Reset() {
-    source_.clear();
-    source_.seekg(0);
+    position_ = 0;
+    is_eof_ = false;
 
-    next_line_.clear();
+    next_line_ = {};
     has_next_ = true;
 
     /* Skip header */
@@ -79,21 +160,32 @@ void CSVParser::Reset() {
     }
 }
 
-void CSVParser::GetLine(const unsigned long long line_index) {
-    Reset();
+void CSVParser::BuildLineOffsets() {
+    line_offsets_.push_back(0);
+    for (std::size_t line_end = data_.find('\n'); line_end != std::string_view::npos;
+         line_end = data_.find('\n', line_end + 1)) {
+        line_offsets_.push_back(line_end + 1);
+    }
+}
 
-    /* Index is less than the line number by one. Skip line_index lines */
-    for (unsigned long long i = 0; i < line_index; ++i) {
-        SkipLine();
+void CSVParser::GetLine(const unsigned long long line_index) {
+    if (line_offsets_.empty()) {
+        BuildLineOffsets();
     }
 
-    std::getline(source_, next_line_);
+    /* Same state as after skipping line_index lines past the header from the beginning. Lines
+     * skipped before the last one end with a line break, so none of them could reach the end */
+    unsigned long long const offset_index = line_index + (has_header_ ? 1 : 0);
+    position_ =
+        offset_index < line_offsets_.size() ? line_offsets_[offset_index] : data_.size();
+    is_eof_ = false;
+    has_next_ = true;
 
-    rtrim(next_line_);
+    GetNext();
 }
 
 void CSVParser::GetNextIfHas() {
-    has_next_ = !source_.eof();
+    has_next_ = !is_eof_;
     if (has_next_) {
         GetNext();
     }
@@ -101,7 +193,7 @@ void CSVParser::GetNextIfHas() {
 
 std::string CSVParser::GetUnparsedLine(const unsigned long long line_index) {
     GetLine(line_index);
-    std::string line = next_line_;
+    std::string line(next_line_);
 
     /* For correctness of ParseNext() after this method */
     GetNextIfHas();
@@ -109,16 +201,82 @@ std::string CSVParser::GetUnparsedLine(const unsigned long long line_index) {
     return line;
 }
 
-std::vector<std::string> CSVParser::ParseString(const std::string& s) const {
-    std::vector<std::string> tokens;
-    boost::escaped_list_separator<char> list_sep(escape_symbol_, separator_, quote_);
-    boost::tokenizer<boost::escaped_list_separator<char>> tokenizer(s, list_sep);
+/* Unescapes the field starting at position into unescaped_fields_ following the rules of
+ * boost::escaped_list_separator. Leaves position at the separator after the field */
+std::string_view CSVParser::UnescapeField(std::string_view s, std::size_t& position) {
+    std::size_t const begin = unescaped_fields_.size();
+    bool is_in_quote = false;
+    for (; position < s.size(); ++position) {
+        char c = s[position];
+        if (c == escape_symbol_) {
+            if (++position == s.size()) {
+                throw boost::escaped_list_error("cannot end with escape");
+            }
+            c = s[position];
+            if (c == 'n') {
+                unescaped_fields_.push_back('\n');
+            } else if (c == quote_ || c == separator_ || c == escape_symbol_) {
+                unescaped_fields_.push_back(c);
+            } else {
+                throw boost::escaped_list_error("unknown escape sequence");
+            }
+        } else if (c == separator_ && !is_in_quote) {
+            break;
+        } else if (c == quote_) {
+            is_in_quote = !is_in_quote;
+        } else {
+            unescaped_fields_.push_back(c);
+        }
+    }
+    return std::string_view(unescaped_fields_).substr(begin);
+}
 
-    for (auto& token : tokenizer) {
-        tokens.push_back(token);
+/* Tokenizes s like boost::escaped_list_separator does. Fields without escape sequences and
+ * quotes, and fields that are simply enclosed in quotes, are viewed in place */
+void CSVParser::ParseString(std::string_view s, std::vector<std::string_view>& fields) {
+    fields.clear();
+    unescaped_fields_.clear();
+    /* Unescaped fields are never longer than their line, so the views stay valid */
+    unescaped_fields_.reserve(s.size());
+    if (s.empty()) return;
+
+    char const special_symbols[] = {separator_, quote_, escape_symbol_};
+    std::string_view const field_end_symbols(special_symbols, 3);
+    std::string_view const quote_end_symbols(special_symbols + 1, 2);
+    std::size_t position = 0;
+    while (true) {
+        std::size_t const begin = position;
+        std::size_t special = s.find_first_of(field_end_symbols, position);
+        if (special == std::string_view::npos || s[special] == separator_) {
+            position = std::min(special, s.size());
+            fields.push_back(s.substr(begin, position - begin));
+        } else if (special == begin && s[begin] == quote_) {
+            std::size_t closing = s.find_first_of(quote_end_symbols, begin + 1);
+            if (closing != std::string_view::npos && s[closing] == quote_ &&
+                (closing + 1 == s.size() || s[closing + 1] == separator_)) {
+                fields.push_back(s.substr(begin + 1, closing - begin - 1));
+                position = closing + 1;
+            } else {
+                fields.push_back(UnescapeField(s, position));
+            }
+        } else {
+            fields.push_back(UnescapeField(s, position));
+        }
+
+        if (position == s.size()) break;
+        /* Skip the separator. A separator at the end of the line starts an empty field */
+        ++position;
+        if (position == s.size()) {
+            fields.push_back(s.substr(position));
+            break;
+        }
     }
+}
 
-    return tokens;
+std::vector<std::string> CSVParser::ParseString(std::string_view s) {
+    std::vector<std::string_view> fields;
+    ParseString(s, fields);
+    return std::vector<std::string>(fields.begin(), fields.end());
 }
 
 std::vector<std::string> CSVParser::ParseLine(const unsigned long long line_index) {
@@ -127,6 +285,21 @@ std::vector<std::string> CSVParser::ParseLine(const unsigned long long line_inde
     return parsed;
 }
 
+std::vector<std::vector<std::string>> CSVParser::ParseLines(
+    std::vector<unsigned long long> const& line_indices) {
+    std::vector<std::size_t> order(line_indices.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&line_indices](std::size_t a, std::size_t b) {
+        return line_indices[a] < line_indices[b];
+    });
+
+    std::vector<std::vector<std::string>> lines(line_indices.size());
+    for (std::size_t i : order) {
+        lines[i] = ParseLine(line_indices[i]);
+    }
+    return lines;
+}
+
 std::vector<std::string> CSVParser::ParseNext() {
     std::vector<std::string> result = ParseString(next_line_);
 
@@ -135,3 +308,8 @@ std::vector<std::string> CSVParser::ParseNext() {
     return result;
 }
 
+void CSVParser::ParseNext(std::vector<std::string_view>& fields) {
+    ParseString(next_line_, fields);
+
+    GetNextIfHas();
+}
@@ -6,31 +6,57 @@
 
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
-#include <fstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+/* Reads the file through a read-only memory mapping. Lines are views into the mapping, so
+ * ParseNext(std::vector<std::string_view>&) tokenizes rows without copying their fields */
 class CSVParser {
 private:
-    std::ifstream source_;
+    boost::interprocess::file_mapping file_mapping_;
+    boost::interprocess::mapped_region mapped_region_;
+    /* Contents of the file */
+    std::string_view data_;
+    /* Offset of the first character not read yet */
+    std::size_t position_ = 0;
+    /* Set when a read reaches the end of the file, like eofbit of a stream */
+    bool is_eof_ = false;
     char separator_;
     char escape_symbol_ = '\\';
     char quote_ = '\"';
     bool has_header_;
     bool has_next_;
-    std::string next_line_;
+    std::string_view next_line_;
+    /* Storage of the fields that cannot be viewed in the mapping because they contain escape
+     * sequences or quotes in the middle */
+    std::string unescaped_fields_;
+    /* Offsets of the line beginnings, built by the first random access to a line */
+    std::vector<std::size_t> line_offsets_;
     int number_of_columns_;
     std::vector<std::string> column_names_;
+    std::filesystem::path path_;
     std::string relation_name_;
     void GetNext();
     void PeekNext();
     void GetLine(const unsigned long long line_index);
-    std::vector<std::string> ParseString(const std::string& s) const;
+    std::string_view ReadLine();
+    std::vector<std::string> ParseString(std::string_view s);
+    void ParseString(std::string_view s, std::vector<std::string_view>& fields);
+    std::string_view UnescapeField(std::string_view s, std::size_t& position);
     void GetNextIfHas();
     void SkipLine();
+    void BuildLineOffsets();
+
+    static inline std::string_view rtrim(std::string_view s);
 
-    static inline std::string& rtrim(std::string& s);
+    /* Parser of the given part of the file mapped by parent */
+    CSVParser(CSVParser const& parent, std::string_view data);
 
 public:
     CSVParser() = default;
@@ -38,16 +64,34 @@ public:
     CSVParser(const std::filesystem::path& path, char separator, bool has_header);
 
     std::vector<std::string> ParseNext();
+    /* Zero-copy version of ParseNext(). The fields stay valid until the next call of a parsing
+     * method, the ones for which IsMapped() holds stay valid as long as the parser */
+    void ParseNext(std::vector<std::string_view>& fields);
+    bool IsMapped(std::string_view field) const;
+    /* Splits the rows not parsed yet into at most chunks_num parsers of consecutive parts of the
+     * file, starting at line boundaries. The parsers view the mapping of this one and must not
+     * outlive it. This parser is left at the end of the file */
+    std::vector<CSVParser> SplitIntoChunks(unsigned chunks_num);
     std::string GetUnparsedLine(const unsigned long long line_index);
     std::vector<std::string> ParseLine(const unsigned long long line_index);
+    /* Parses the lines with the given indices in increasing order of the indices. The i-th
+     * element of the result is the line with index line_indices[i] */
+    std::vector<std::vector<std::string>> ParseLines(
+        std::vector<unsigned long long> const& line_indices);
     bool GetHasNext() const {
         return has_next_;
     }
     char GetSeparator() const {
         return separator_;
     }
+    bool GetHasHeader() const { return has_header_; }
+    std::filesystem::path const& GetPath() const { return path_; }
     int GetNumberOfColumns() const { return number_of_columns_; }
     std::string GetColumnName(int index) const { return column_names_[index]; }
+    /* Names of the first num_columns columns */
+    std::vector<std::string> GetColumnNames(int num_columns) const {
+        return {column_names_.begin(), column_names_.begin() + num_columns};
+    }
     std::string GetRelationName() const { return relation_name_; }
     void Reset();
 };
@@ -236,7 +236,7 @@ AgreeSetFactory::SetOfAgreeSets AgreeSetFactory::GenAsUsingGetAgreeSets() const
     // ~40436 ms on CIPublicHighway700 (Debug build)
     for (ColumnData const& column_data : columns_data) {
         PositionListIndex const* const pli = column_data.GetPositionListIndex();
-        for (vector<int> const& cluster : pli->GetIndex()) {
+        for (PositionListIndex::ClusterSpan cluster : pli->GetClusters()) {
             for (auto p = cluster.begin(); p != cluster.end(); ++p) {
                 for (auto q = std::next(p); q != cluster.end(); ++q) {
                     agree_sets.insert(GetAgreeSet(*p, *q));
@@ -316,13 +316,15 @@ AgreeSetFactory::SetOfVectors AgreeSetFactory::GenMcUsingCalculateSupersets() co
         return max_representation;
     }
 
-    max_representation.insert(not_empty_pli->GetPositionListIndex()->GetIndex().begin(),
-                              not_empty_pli->GetPositionListIndex()->GetIndex().end());
+    for (PositionListIndex::ClusterSpan cluster :
+         not_empty_pli->GetPositionListIndex()->GetClusters()) {
+        max_representation.insert(cluster.ToCluster());
+    }
 
     for (auto p = std::next(not_empty_pli); p != columns_data.end(); ++p) {
         PositionListIndex const* pli = p->GetPositionListIndex();
         if (pli->GetSize() != 0) {
-            CalculateSupersets(max_representation, pli->GetIndex());
+            CalculateSupersets(max_representation, pli->GetClusters());
         }
     }
 
@@ -383,8 +385,9 @@ AgreeSetFactory::GenSortedEqvClasses(VectorComp comp) const {
 
     // Fill sorted_partitions
     for (ColumnData const& data : columns_data) {
-        std::deque<vector<int>> const& index = data.GetPositionListIndex()->GetIndex();
-        sorted_eqv_classes.insert(index.begin(), index.end());
+        for (PositionListIndex::ClusterSpan cluster : data.GetPositionListIndex()->GetClusters()) {
+            sorted_eqv_classes.insert(cluster.ToCluster());
+        }
     }
 
     return sorted_eqv_classes;
@@ -557,35 +560,36 @@ void AgreeSetFactory::HandleEqvClass(vector<int>& eqv_class,
 
 void AgreeSetFactory::CalculateSupersets(
     std::unordered_set<std::vector<int>, boost::hash<std::vector<int>>>& max_representation,
-    std::deque<vector<int>> const& partition) const {
+    PositionListIndex::ClusterCollection const& partition) const {
     SetOfVectors to_add_to_mc;
     auto hash = [beg = max_representation.begin()](SetOfVectors::const_iterator it) {
         return std::distance<SetOfVectors::const_iterator>(beg, it);
     };
     unordered_set<SetOfVectors::const_iterator, decltype(hash)> to_delete_from_mc(1, hash);
-    set<std::deque<vector<int>>::const_iterator> to_exclude_from_partition;
+    set<size_t> to_exclude_from_partition;
 
     for (auto it = max_representation.begin(); it != max_representation.end(); ++it) {
-        for (auto p = partition.begin();
-             to_exclude_from_partition.size() != partition.size() && p != partition.end();
-             ++p) {
-            if (to_exclude_from_partition.find(p) != to_exclude_from_partition.end()) {
+        for (size_t p_index = 0;
+             to_exclude_from_partition.size() != partition.size() && p_index != partition.size();
+             ++p_index) {
+            if (to_exclude_from_partition.find(p_index) != to_exclude_from_partition.end()) {
                 continue;
             }
 
-            if (it->size() >= p->size() &&
-                std::includes(it->begin(), it->end(), p->begin(), p->end())) {
-                to_add_to_mc.erase(*p);
-                to_exclude_from_partition.insert(p);
+            PositionListIndex::ClusterSpan const p = partition[p_index];
+            if (it->size() >= p.size() &&
+                std::includes(it->begin(), it->end(), p.begin(), p.end())) {
+                to_add_to_mc.erase(p.ToCluster());
+                to_exclude_from_partition.insert(p_index);
                 break;
             }
 
-            if (p->size() >= it->size() &&
-                std::includes(p->begin(), p->end(), it->begin(), it->end())) {
+            if (p.size() >= it->size() &&
+                std::includes(p.begin(), p.end(), it->begin(), it->end())) {
                 to_delete_from_mc.insert(it);
             }
 
-            to_add_to_mc.insert(*p);
+            to_add_to_mc.insert(p.ToCluster());
         }
     }
 
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <set>
-#include <deque>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
@@ -166,7 +165,7 @@ private:
 
     void CalculateSupersets(
         std::unordered_set<std::vector<int>, boost::hash<std::vector<int>>>& max_representation,
-        std::deque<std::vector<int>> const& partition) const;
+        PositionListIndex::ClusterCollection const& partition) const;
     /* From Metanome: `handleList`.
      * Extremely slow for anything big eqv_class,
      * I think it is not usable at all
@@ -2,11 +2,17 @@
 
 #include <algorithm>
 #include <exception>
+#include <functional>
 #include <limits>
 #include <memory>
+#include <numeric>
 #include <random>
 #include <utility>
 
+#include "BitMatrixAgreeSetSample.h"
+#include "BitmapIndexAgreeSetSample.h"
+#include "ParallelFor.h"
+
 namespace util {
 
 using namespace std;
@@ -20,6 +26,150 @@ AgreeSetSample::AgreeSetSample(ColumnLayoutRelationData const* relation_data, Ve
       sample_size_(sample_size),
       population_size_(population_size) {}
 
+unsigned int AgreeSetSample::CollectFocusedAgreeSets(
+    ColumnLayoutRelationData const* relation, Vertical const& restriction_vertical,
+    PositionListIndex const* restriction_pli, unsigned int sample_size, long long seed,
+    unsigned int num_threads,
+    std::unordered_map<boost::dynamic_bitset<>, int>& agree_set_counters) {
+    using AgreeSetCounters = std::unordered_map<boost::dynamic_bitset<>, int>;
+
+    boost::dynamic_bitset<> free_column_indices(relation->GetNumColumns());
+    free_column_indices.set();
+    free_column_indices &= ~restriction_vertical.GetColumnIndices();
+    std::vector<std::reference_wrapper<const ColumnData>> relevant_column_data;
+    for (size_t column_index = free_column_indices.find_first();
+         column_index != boost::dynamic_bitset<>::npos;
+         column_index = free_column_indices.find_next(column_index)) {
+        relevant_column_data.emplace_back(relation->GetColumnData(column_index));
+    }
+    boost::dynamic_bitset<> agree_set_prototype(restriction_vertical.GetColumnIndices());
+    auto count_agree_set = [&relevant_column_data, &agree_set_prototype](
+                               int tuple_index_1, int tuple_index_2, AgreeSetCounters& counters) {
+        boost::dynamic_bitset<> agree_set(agree_set_prototype);
+        for (auto& column_data : relevant_column_data) {
+            int value1 = column_data.get().GetProbingTableValue(tuple_index_1);
+            if (value1 != PositionListIndex::singleton_value_id_ &&
+                value1 == column_data.get().GetProbingTableValue(tuple_index_2)) {
+                agree_set.set(column_data.get().GetColumn()->GetIndex());
+            }
+        }
+        auto location = counters.find(agree_set);
+        if (location == counters.end()) {
+            counters.emplace_hint(location, std::move(agree_set), 1);
+        } else {
+            location->second += 1;
+        }
+    };
+
+    unsigned long long restriction_nep = restriction_pli->GetNepAsLong();
+    sample_size = std::min(static_cast<unsigned long long>(sample_size), restriction_nep);
+    /* The pairs are split into fixed streams that do not depend on the number of threads, every
+     * thread takes every num_threads-th stream and counts into its own map */
+    unsigned int const num_streams = (sample_size + kPairsPerStream - 1) / kPairsPerStream;
+    num_threads = std::max(1U, std::min(num_threads, num_streams));
+    std::vector<AgreeSetCounters> thread_counters(num_threads);
+    std::vector<unsigned int> thread_indices(num_threads);
+    std::iota(thread_indices.begin(), thread_indices.end(), 0);
+    PositionListIndex::ClusterCollection const clusters = restriction_pli->GetClusters();
+    if (sample_size >= restriction_nep) {
+        util::parallel_foreach(
+            thread_indices.begin(), thread_indices.end(), num_threads, [&](unsigned int thread) {
+                for (size_t cluster_index = thread; cluster_index < clusters.size();
+                     cluster_index += num_threads) {
+                    PositionListIndex::ClusterSpan cluster = clusters[cluster_index];
+                    for (unsigned int i = 0; i < cluster.size(); i++) {
+                        for (unsigned int j = i + 1; j < cluster.size(); j++) {
+                            count_agree_set(cluster[i], cluster[j], thread_counters[thread]);
+                        }
+                    }
+                }
+            });
+    } else {
+        std::vector<unsigned long long> cluster_sizes(restriction_pli->GetNumNonSingletonCluster() -
+                                                      1);
+        for (unsigned int i = 0; i < cluster_sizes.size(); i++) {
+            unsigned long long cluster_size = clusters[i].size();
+            unsigned long long num_tuple_pairs = cluster_size * (cluster_size - 1) / 2;
+            if (i > 0) {
+                cluster_sizes[i] = num_tuple_pairs + cluster_sizes[i - 1];
+            } else {
+                cluster_sizes[i] = num_tuple_pairs;
+            }
+        }
+
+        long long const sample_seed =
+            CustomRandom::SplitSeed(seed, restriction_vertical.GetColumnSet().Hash());
+        util::parallel_foreach(
+            thread_indices.begin(), thread_indices.end(), num_threads, [&](unsigned int thread) {
+                for (unsigned int stream = thread; stream < num_streams; stream += num_threads) {
+                    CustomRandom random(CustomRandom::SplitSeed(sample_seed, stream));
+                    unsigned int const stream_end =
+                        std::min(sample_size, (stream + 1) * kPairsPerStream);
+                    for (unsigned int i = stream * kPairsPerStream; i < stream_end; i++) {
+                        auto cluster_index_iter =
+                            std::lower_bound(cluster_sizes.begin(), cluster_sizes.end(),
+                                             random.NextULL() % restriction_nep);
+                        unsigned int cluster_index =
+                            std::distance(cluster_sizes.begin(), cluster_index_iter);
+                        PositionListIndex::ClusterSpan cluster = clusters[cluster_index];
+
+                        int tuple_index_1 = random.NextInt(cluster.size());
+                        int tuple_index_2 = random.NextInt(cluster.size());
+                        while (tuple_index_1 == tuple_index_2) {
+                            tuple_index_2 = random.NextInt(cluster.size());
+                        }
+                        count_agree_set(cluster[tuple_index_1], cluster[tuple_index_2],
+                                        thread_counters[thread]);
+                    }
+                }
+            });
+    }
+
+    agree_set_counters = std::move(thread_counters.front());
+    for (auto it = std::next(thread_counters.begin()); it != thread_counters.end(); ++it) {
+        for (auto& [agree_set, count] : *it) {
+            agree_set_counters[agree_set] += count;
+        }
+    }
+    //std::cout << "-----------------\n";
+    /*string agreeSetCountersStr = "{";
+    for (auto& [key, value] : agree_set_counters) {
+        agreeSetCountersStr += '\"';
+        for (unsigned int columnIndex = key.find_first(); columnIndex < key.size(); columnIndex = key.find_next(columnIndex)){
+            agreeSetCountersStr += std::to_string(columnIndex) + ' ';
+        }
+        agreeSetCountersStr += '\"';
+        agreeSetCountersStr += " : "+ std::to_string(value) + ',';
+    }
+    agreeSetCountersStr.erase(agreeSetCountersStr.end()-1);
+    agreeSetCountersStr += '}';
+
+    LOG(DEBUG) << boost::format {"Created sample focused on %1%: %2%"} % restriction_vertical->ToString() % agreeSetCountersStr;
+    */
+    return sample_size;
+}
+
+std::unique_ptr<AgreeSetSample> AgreeSetSample::CreateFocusedSample(
+    ColumnLayoutRelationData const* relation, Vertical const& restriction_vertical,
+    PositionListIndex const* restriction_pli, unsigned int sample_size, long long seed,
+    unsigned int num_threads) {
+    std::unordered_map<boost::dynamic_bitset<>, int> agree_set_counters;
+    unsigned long long restriction_nep = restriction_pli->GetNepAsLong();
+    sample_size = CollectFocusedAgreeSets(relation, restriction_vertical, restriction_pli,
+                                          sample_size, seed, num_threads, agree_set_counters);
+    /* Scanning wins only while the rows fit in a few hundred words, past that the index touches
+     * several times fewer words per query */
+    constexpr unsigned long long kMaxScannedWords = 256;
+    unsigned long long const num_words_per_row = (relation->GetNumColumns() + 63) / 64;
+    if (agree_set_counters.size() * num_words_per_row <= kMaxScannedWords) {
+        return std::make_unique<BitMatrixAgreeSetSample>(relation, restriction_vertical,
+                                                         sample_size, restriction_nep,
+                                                         agree_set_counters);
+    }
+    return std::make_unique<BitmapIndexAgreeSetSample>(relation, restriction_vertical, sample_size,
+                                                       restriction_nep, agree_set_counters);
+}
+
 double AgreeSetSample::CalculateNonNegativeFraction(double a, double b) {
     // TODO: checking 0/b, comparing double to 0.
     if (a == 0)
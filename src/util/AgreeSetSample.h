@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include <unordered_map>
+
 #include <boost/dynamic_bitset.hpp>
 
 #include "ColumnLayoutRelationData.h"
@@ -14,7 +16,7 @@
 
 namespace util {
 
-//abstract base class for Agree Set Sample implementations (trie <- not used, list)
+//abstract base class for Agree Set Sample implementations (list, bit matrix, bitmap index)
 class AgreeSetSample {
 public:
 
@@ -32,6 +34,15 @@ public:
     double GetSamplingRatio() const { return sample_size_ / static_cast<double>(population_size_); }
     bool IsExact() const { return population_size_ == sample_size_; }
 
+    /* Creates a sample focused on restriction_vertical in the implementation that answers its
+     * queries fastest: BitMatrixAgreeSetSample scans every distinct agree set, which is cheapest
+     * while there are few of them in a narrow schema, BitmapIndexAgreeSetSample only reads the
+     * bitmaps of the queried columns */
+    static std::unique_ptr<AgreeSetSample> CreateFocusedSample(
+        ColumnLayoutRelationData const* relation, Vertical const& restriction_vertical,
+        PositionListIndex const* restriction_pli, unsigned int sample_size, long long seed,
+        unsigned int num_threads = 1);
+
     virtual ~AgreeSetSample() = default;
 
 protected:
@@ -49,8 +60,20 @@ protected:
     static std::unique_ptr<T> CreateFocusedFor(ColumnLayoutRelationData const* relation,
                                                Vertical const& restriction_vertical,
                                                PositionListIndex const* restriction_pli,
-                                               unsigned int sample_size, CustomRandom& random);
+                                               unsigned int sample_size, long long seed,
+                                               unsigned int num_threads = 1);
+    /* Fills agree_set_counters with the agree sets of at most sample_size pairs of tuples of
+     * restriction_pli, or of all of them if there are not more, returns the number of pairs.
+     * The pairs depend only on seed and restriction_vertical, not on num_threads */
+    static unsigned int CollectFocusedAgreeSets(
+        ColumnLayoutRelationData const* relation, Vertical const& restriction_vertical,
+        PositionListIndex const* restriction_pli, unsigned int sample_size, long long seed,
+        unsigned int num_threads,
+        std::unordered_map<boost::dynamic_bitset<>, int>& agree_set_counters);
 private:
+    /* Number of sampled pairs drawn from one random stream, the unit of work of a thread */
+    static constexpr unsigned int kPairsPerStream = 1024;
+
     static double std_dev_smoothing_;
 
     double RatioToRelationRatio(double ratio) const {
@@ -0,0 +1,116 @@
+#include "BitMatrixAgreeSetSample.h"
+
+#include <array>
+
+namespace util {
+
+std::unique_ptr<BitMatrixAgreeSetSample> BitMatrixAgreeSetSample::CreateFocusedFor(
+    ColumnLayoutRelationData const* relation, Vertical const& restriction_vertical,
+    PositionListIndex const* restriction_pli, unsigned int sample_size, long long seed,
+    unsigned int num_threads) {
+    return AgreeSetSample::CreateFocusedFor<BitMatrixAgreeSetSample>(
+        relation, restriction_vertical, restriction_pli, sample_size, seed, num_threads);
+}
+
+std::size_t BitMatrixAgreeSetSample::GetNumWords(std::size_t num_columns) {
+    std::size_t const num_words = (num_columns + kWordBits - 1) / kWordBits;
+    if (num_words <= 1) return 1;
+    if (num_words <= 2) return 2;
+    if (num_words <= kMaxFixedWords) return kMaxFixedWords;
+    return num_words;
+}
+
+BitMatrixAgreeSetSample::BitMatrixAgreeSetSample(
+    ColumnLayoutRelationData const* relation, Vertical const& focus, unsigned int sample_size,
+    unsigned long long population_size,
+    std::unordered_map<boost::dynamic_bitset<>, int> const& agree_set_counters)
+    : AgreeSetSample(relation, focus, sample_size, population_size),
+      num_words_(GetNumWords(relation->GetNumColumns())),
+      agree_sets_(agree_set_counters.size() * num_words_, 0) {
+    counts_.reserve(agree_set_counters.size());
+    Word* row = agree_sets_.data();
+    for (auto const& [agree_set, count] : agree_set_counters) {
+        for (std::size_t column_index = agree_set.find_first();
+             column_index != boost::dynamic_bitset<>::npos;
+             column_index = agree_set.find_next(column_index)) {
+            row[column_index / kWordBits] |= Word{1} << (column_index % kWordBits);
+        }
+        counts_.push_back(count);
+        row += num_words_;
+    }
+}
+
+void BitMatrixAgreeSetSample::SetBits(Vertical const& vertical, Word* mask) const {
+    ColumnSet const& columns = vertical.GetColumnSet();
+    for (std::size_t column_index = columns.find_first(); column_index != ColumnSet::npos;
+         column_index = columns.find_next(column_index)) {
+        mask[column_index / kWordBits] |= Word{1} << (column_index % kWordBits);
+    }
+}
+
+template <std::size_t kWords>
+std::pair<unsigned long long, unsigned long long> BitMatrixAgreeSetSample::CountSupersets(
+    Word const* agree_mask, Word const* disagree_mask) const {
+    /* kWords == 0 stands for the width of the schema */
+    std::size_t const num_words = kWords == 0 ? num_words_ : kWords;
+    unsigned long long num_agreeing = 0;
+    unsigned long long num_matching = 0;
+    Word const* row = agree_sets_.data();
+    for (std::size_t i = 0; i < counts_.size(); ++i, row += num_words) {
+        Word missing = 0;
+        Word conflicting = 0;
+        for (std::size_t word = 0; word < num_words; ++word) {
+            missing |= agree_mask[word] & ~row[word];
+            conflicting |= disagree_mask[word] & row[word];
+        }
+        num_agreeing += missing == 0 ? counts_[i] : 0;
+        num_matching += (missing | conflicting) == 0 ? counts_[i] : 0;
+    }
+    return {num_agreeing, num_matching};
+}
+
+std::pair<unsigned long long, unsigned long long> BitMatrixAgreeSetSample::CountSupersets(
+    Vertical const& agreement, Vertical const* disagreement) const {
+    std::array<Word, 2 * kMaxFixedWords> fixed_masks{};
+    std::vector<Word> wide_masks;
+    Word* masks = fixed_masks.data();
+    if (num_words_ > kMaxFixedWords) {
+        wide_masks.assign(2 * num_words_, 0);
+        masks = wide_masks.data();
+    }
+    Word* const agree_mask = masks;
+    Word* const disagree_mask = masks + num_words_;
+    SetBits(agreement, agree_mask);
+    if (disagreement != nullptr) {
+        SetBits(*disagreement, disagree_mask);
+    }
+
+    switch (num_words_) {
+    case 1:
+        return CountSupersets<1>(agree_mask, disagree_mask);
+    case 2:
+        return CountSupersets<2>(agree_mask, disagree_mask);
+    case kMaxFixedWords:
+        return CountSupersets<kMaxFixedWords>(agree_mask, disagree_mask);
+    default:
+        return CountSupersets<0>(agree_mask, disagree_mask);
+    }
+}
+
+unsigned long long BitMatrixAgreeSetSample::GetNumAgreeSupersets(Vertical const& agreement) const {
+    return CountSupersets(agreement, nullptr).first;
+}
+
+unsigned long long BitMatrixAgreeSetSample::GetNumAgreeSupersets(
+    Vertical const& agreement, Vertical const& disagreement) const {
+    return CountSupersets(agreement, &disagreement).second;
+}
+
+std::unique_ptr<std::vector<unsigned long long>> BitMatrixAgreeSetSample::GetNumAgreeSupersetsExt(
+    Vertical const& agreement, Vertical const& disagreement) const {
+    auto [num_agreeing, num_matching] = CountSupersets(agreement, &disagreement);
+    return std::make_unique<std::vector<unsigned long long>>(
+        std::vector<unsigned long long>{num_agreeing, num_matching});
+}
+
+}  // namespace util
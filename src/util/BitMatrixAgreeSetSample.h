@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AgreeSetSample.h"
+
+namespace util {
+
+/* Stores the distinct agree sets of the sample as the rows of a bit matrix in one contiguous
+ * array, next to their counts. A query builds the masks of its agreement and disagreement once
+ * and tests every row with branchless AND/compare loops, so nothing is copied or allocated per
+ * row. Rows of schemas up to 64, 128 and 256 columns take 1, 2 and 4 words, which gives the
+ * inner loop a constant trip count the compiler unrolls and vectorizes. Answers every query
+ * exactly like ListAgreeSetSample built from the same agree set counters */
+class BitMatrixAgreeSetSample : public AgreeSetSample {
+private:
+    using Word = std::uint64_t;
+    static constexpr std::size_t kWordBits = 64;
+    static constexpr std::size_t kMaxFixedWords = 4;
+
+    std::size_t num_words_;
+    /* Row i takes the words [i * num_words_, (i + 1) * num_words_) */
+    std::vector<Word> agree_sets_;
+    std::vector<unsigned long long> counts_;
+
+    static std::size_t GetNumWords(std::size_t num_columns);
+    void SetBits(Vertical const& vertical, Word* mask) const;
+    /* Returns the number of sampled pairs agreeing on all the columns of agree_mask, and the
+     * number of those disagreeing on all the columns of disagree_mask as well */
+    template <std::size_t kWords>
+    std::pair<unsigned long long, unsigned long long> CountSupersets(
+        Word const* agree_mask, Word const* disagree_mask) const;
+    std::pair<unsigned long long, unsigned long long> CountSupersets(
+        Vertical const& agreement, Vertical const* disagreement) const;
+
+public:
+    static std::unique_ptr<BitMatrixAgreeSetSample> CreateFocusedFor(
+        ColumnLayoutRelationData const* relation, Vertical const& restriction_vertical,
+        PositionListIndex const* restriction_pli, unsigned int sample_size, long long seed,
+        unsigned int num_threads = 1);
+
+    BitMatrixAgreeSetSample(
+        ColumnLayoutRelationData const* relation, Vertical const& focus, unsigned int sample_size,
+        unsigned long long population_size,
+        std::unordered_map<boost::dynamic_bitset<>, int> const& agree_set_counters);
+
+    unsigned long long GetNumAgreeSupersets(Vertical const& agreement) const override;
+    unsigned long long GetNumAgreeSupersets(Vertical const& agreement,
+                                            Vertical const& disagreement) const override;
+    std::unique_ptr<std::vector<unsigned long long>> GetNumAgreeSupersetsExt(
+        Vertical const& agreement, Vertical const& disagreement) const override;
+};
+
+}  // namespace util
@@ -0,0 +1,95 @@
+#include "BitmapIndexAgreeSetSample.h"
+
+namespace util {
+
+std::unique_ptr<BitmapIndexAgreeSetSample> BitmapIndexAgreeSetSample::CreateFocusedFor(
+    ColumnLayoutRelationData const* relation, Vertical const& restriction_vertical,
+    PositionListIndex const* restriction_pli, unsigned int sample_size, long long seed,
+    unsigned int num_threads) {
+    return AgreeSetSample::CreateFocusedFor<BitmapIndexAgreeSetSample>(
+        relation, restriction_vertical, restriction_pli, sample_size, seed, num_threads);
+}
+
+BitmapIndexAgreeSetSample::BitmapIndexAgreeSetSample(
+    ColumnLayoutRelationData const* relation, Vertical const& focus, unsigned int sample_size,
+    unsigned long long population_size,
+    std::unordered_map<boost::dynamic_bitset<>, int> const& agree_set_counters)
+    : AgreeSetSample(relation, focus, sample_size, population_size),
+      num_blocks_((agree_set_counters.size() + kWordBits - 1) / kWordBits),
+      column_bitmaps_(relation->GetNumColumns() * num_blocks_, 0) {
+    counts_.reserve(agree_set_counters.size());
+    for (auto const& [agree_set, count] : agree_set_counters) {
+        std::size_t const row = counts_.size();
+        Word const row_bit = Word{1} << (row % kWordBits);
+        for (std::size_t column_index = agree_set.find_first();
+             column_index != boost::dynamic_bitset<>::npos;
+             column_index = agree_set.find_next(column_index)) {
+            column_bitmaps_[column_index * num_blocks_ + row / kWordBits] |= row_bit;
+        }
+        counts_.push_back(count);
+    }
+}
+
+std::vector<BitmapIndexAgreeSetSample::Word const*> BitmapIndexAgreeSetSample::GetBitmaps(
+    Vertical const& vertical, bool skip_focus) const {
+    ColumnSet const& columns = vertical.GetColumnSet();
+    ColumnSet const& focus_columns = focus_.GetColumnSet();
+    std::vector<Word const*> bitmaps;
+    for (std::size_t column_index = columns.find_first(); column_index != ColumnSet::npos;
+         column_index = columns.find_next(column_index)) {
+        if (!skip_focus || !focus_columns.test(column_index)) {
+            bitmaps.push_back(column_bitmaps_.data() + column_index * num_blocks_);
+        }
+    }
+    return bitmaps;
+}
+
+std::pair<unsigned long long, unsigned long long> BitmapIndexAgreeSetSample::CountSupersets(
+    Vertical const& agreement, Vertical const* disagreement) const {
+    std::vector<Word const*> const agree_bitmaps = GetBitmaps(agreement, true);
+    std::vector<Word const*> const disagree_bitmaps =
+        disagreement == nullptr ? std::vector<Word const*>{} : GetBitmaps(*disagreement, false);
+    unsigned long long num_agreeing = 0;
+    unsigned long long num_matching = 0;
+    for (std::size_t block = 0; block < num_blocks_; ++block) {
+        std::size_t const first_row = block * kWordBits;
+        Word agreeing = first_row + kWordBits <= counts_.size()
+                                ? ~Word{0}
+                                : (Word{1} << (counts_.size() - first_row)) - 1;
+        for (auto it = agree_bitmaps.begin(); agreeing != 0 && it != agree_bitmaps.end(); ++it) {
+            agreeing &= (*it)[block];
+        }
+        if (agreeing == 0) continue;
+        Word matching = agreeing;
+        for (auto it = disagree_bitmaps.begin(); matching != 0 && it != disagree_bitmaps.end();
+             ++it) {
+            matching &= ~(*it)[block];
+        }
+        for (; agreeing != 0; agreeing &= agreeing - 1) {
+            std::size_t const row = first_row + __builtin_ctzll(agreeing);
+            num_agreeing += counts_[row];
+            num_matching += (matching >> (row - first_row) & 1) != 0 ? counts_[row] : 0;
+        }
+    }
+    return {num_agreeing, num_matching};
+}
+
+unsigned long long BitmapIndexAgreeSetSample::GetNumAgreeSupersets(
+    Vertical const& agreement) const {
+    return CountSupersets(agreement, nullptr).first;
+}
+
+unsigned long long BitmapIndexAgreeSetSample::GetNumAgreeSupersets(
+    Vertical const& agreement, Vertical const& disagreement) const {
+    return CountSupersets(agreement, &disagreement).second;
+}
+
+std::unique_ptr<std::vector<unsigned long long>>
+BitmapIndexAgreeSetSample::GetNumAgreeSupersetsExt(Vertical const& agreement,
+                                                    Vertical const& disagreement) const {
+    auto [num_agreeing, num_matching] = CountSupersets(agreement, &disagreement);
+    return std::make_unique<std::vector<unsigned long long>>(
+        std::vector<unsigned long long>{num_agreeing, num_matching});
+}
+
+}  // namespace util
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AgreeSetSample.h"
+
+namespace util {
+
+/* Indexes the distinct agree sets of the sample by column: the bitmap of a column has bit i set
+ * if agree set i contains the column. A query intersects the bitmaps of its agreement, drops the
+ * agree sets of the bitmaps of its disagreement and sums the counts of the survivors. A block of
+ * 64 agree sets is left as soon as none of them survives, so a query touches about
+ * (|agreement| + |disagreement|) / 64 words per agree set instead of the whole row the scan of
+ * BitMatrixAgreeSetSample reads, see AgreeSetSample::CreateFocusedSample */
+class BitmapIndexAgreeSetSample : public AgreeSetSample {
+private:
+    using Word = std::uint64_t;
+    static constexpr std::size_t kWordBits = 64;
+
+    std::size_t num_blocks_;
+    /* The bitmap of column j takes the words [j * num_blocks_, (j + 1) * num_blocks_) */
+    std::vector<Word> column_bitmaps_;
+    std::vector<unsigned long long> counts_;
+
+    /* Every agree set has the focus columns, so agreements can skip their bitmaps */
+    std::vector<Word const*> GetBitmaps(Vertical const& vertical, bool skip_focus) const;
+    /* Returns the number of sampled pairs agreeing on all the columns of agreement, and the
+     * number of those disagreeing on all the columns of disagreement as well */
+    std::pair<unsigned long long, unsigned long long> CountSupersets(
+        Vertical const& agreement, Vertical const* disagreement) const;
+
+public:
+    static std::unique_ptr<BitmapIndexAgreeSetSample> CreateFocusedFor(
+        ColumnLayoutRelationData const* relation, Vertical const& restriction_vertical,
+        PositionListIndex const* restriction_pli, unsigned int sample_size, long long seed,
+        unsigned int num_threads = 1);
+
+    BitmapIndexAgreeSetSample(
+        ColumnLayoutRelationData const* relation, Vertical const& focus, unsigned int sample_size,
+        unsigned long long population_size,
+        std::unordered_map<boost::dynamic_bitset<>, int> const& agree_set_counters);
+
+    unsigned long long GetNumAgreeSupersets(Vertical const& agreement) const override;
+    unsigned long long GetNumAgreeSupersets(Vertical const& agreement,
+                                            Vertical const& disagreement) const override;
+    std::unique_ptr<std::vector<unsigned long long>> GetNumAgreeSupersetsExt(
+        Vertical const& agreement, Vertical const& disagreement) const override;
+};
+
+}  // namespace util
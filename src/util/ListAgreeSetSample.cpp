@@ -6,9 +6,10 @@ namespace util {
 
 std::unique_ptr<ListAgreeSetSample> ListAgreeSetSample::CreateFocusedFor(
     ColumnLayoutRelationData const* relation, Vertical const& restriction_vertical,
-    PositionListIndex const* restriction_p_li, unsigned int sample_size, CustomRandom& random) {
+    PositionListIndex const* restriction_p_li, unsigned int sample_size, long long seed,
+    unsigned int num_threads) {
     return AgreeSetSample::CreateFocusedFor<ListAgreeSetSample>(
-        relation, restriction_vertical, restriction_p_li, sample_size, random);
+        relation, restriction_vertical, restriction_p_li, sample_size, seed, num_threads);
 }
 
 std::unique_ptr<std::vector<unsigned long long>> ListAgreeSetSample::BitSetToLongLongVector(
@@ -17,7 +18,7 @@ std::unique_ptr<std::vector<unsigned long long>> ListAgreeSetSample::BitSetToLon
         std::vector<unsigned long long>((bitset.size() + 63) / 64, 0));
     for (size_t i = 0; i < bitset.size(); i++) {
         //idea is: long long ~ 64 bits. shift i-th bit in the bitset i mod 64 times and set the corresponding bit
-        (*result)[i / 64] |= bitset[i] << i % 64;
+        (*result)[i / 64] |= static_cast<unsigned long long>(bitset[i]) << i % 64;
     }
     return result;
 }
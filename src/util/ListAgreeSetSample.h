@@ -27,7 +27,8 @@ public:
 
     static std::unique_ptr<ListAgreeSetSample> CreateFocusedFor(
         ColumnLayoutRelationData const* relation, Vertical const& restriction_vertical,
-        PositionListIndex const* restriction_p_li, unsigned int sample_size, CustomRandom& random);
+        PositionListIndex const* restriction_p_li, unsigned int sample_size, long long seed,
+        unsigned int num_threads = 1);
 
     ListAgreeSetSample(ColumnLayoutRelationData const* relation, Vertical const& focus,
                        unsigned int sample_size, unsigned long long population_size,
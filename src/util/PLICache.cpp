@@ -1,5 +1,9 @@
 #include "PLICache.h"
 
+#include <algorithm>
+#include <cmath>
+#include <exception>
+
 #include <boost/optional.hpp>
 #include <easylogging++.h>
 
@@ -7,19 +11,35 @@
 
 namespace util {
 
-PositionListIndex* PLICache::Get(Vertical const& vertical) {
-    return index_->Get(vertical).get();
+namespace {
+
+PositionListIndex::IntersectionStats GetStats(PositionListIndex const& pli) {
+    PositionListIndex::IntersectionStats stats;
+    stats.num_non_singleton_clusters = pli.GetNumNonSingletonCluster();
+    stats.size = pli.GetSize();
+    stats.nep = pli.GetNepAsLong();
+    stats.entropy = pli.GetEntropy();
+    stats.num_clusters = pli.GetNumCluster();
+    return stats;
+}
+
+}  // namespace
+
+std::shared_ptr<PositionListIndex> PLICache::Get(Vertical const& vertical) {
+    return index_->Get(vertical);
 }
 
 PLICache::PLICache(ColumnLayoutRelationData* relation_data, CachingMethod caching_method,
                    CacheEvictionMethod eviction_method, double caching_method_value,
                    double min_entropy, double mean_entropy, double median_entropy,
-                   double maximum_entropy, double median_gini, double median_inverted_entropy)
+                   double maximum_entropy, double median_gini, double median_inverted_entropy,
+                   std::size_t memory_limit)
     : relation_data_(relation_data),
       // TODO: сделать
       // index_(std::make_unique<VerticalMap<PositionListIndex>>(relation_data->GetSchema())) при
       // одном потоке
-      index_(std::make_unique<BlockingVerticalMap<PositionListIndex>>(relation_data->GetSchema())),
+      index_(std::make_unique<ConcurrentVerticalMap<PositionListIndex>>(relation_data->GetSchema())),
+      memory_limit_(memory_limit),
       caching_method_(caching_method),
       eviction_method_(eviction_method),
       caching_method_value_(caching_method_value),
@@ -35,6 +55,17 @@ PLICache::PLICache(ColumnLayoutRelationData* relation_data, CachingMethod cachin
     }
 }
 
+PLICache::PLICache(ColumnLayoutRelationData* relation_data, CachingMethod caching_method,
+                   CacheEvictionMethod eviction_method, double caching_method_value,
+                   std::size_t memory_limit)
+    : PLICache(relation_data, caching_method, eviction_method, caching_method_value,
+               ProfilingContext::GetMinEntropy(relation_data),
+               ProfilingContext::GetMeanEntropy(relation_data),
+               ProfilingContext::GetMedianEntropy(relation_data),
+               ProfilingContext::GetMaximumEntropy(relation_data),
+               ProfilingContext::GetMedianGini(relation_data),
+               ProfilingContext::GetMedianInvertedEntropy(relation_data), memory_limit) {}
+
 PLICache::~PLICache() {
     for (auto& column_ptr : relation_data_->GetSchema()->GetColumns()) {
         //auto PLI =
@@ -44,27 +75,119 @@ PLICache::~PLICache() {
 }
 
 // obtains or calculates a PositionListIndex using cache
-std::variant<PositionListIndex*, std::unique_ptr<PositionListIndex>> PLICache::GetOrCreateFor(
-    Vertical const& vertical, ProfilingContext* profiling_context) {
-    std::scoped_lock lock(getting_pli_mutex_);
+std::shared_ptr<PositionListIndex> PLICache::GetOrCreateFor(Vertical const& vertical,
+                                                            ProfilingContext* profiling_context) {
+    return GetOrCalculate(vertical, profiling_context, nullptr);
+}
+
+PositionListIndex::IntersectionStats PLICache::GetStatsFor(Vertical const& vertical,
+                                                           ProfilingContext* profiling_context) {
+    std::shared_ptr<PositionListIndex> pli = Get(vertical);
+    if (pli != nullptr) {
+        Use(*pli);
+        hits_++;
+        return GetStats(*pli);
+    }
+
+    auto start_time = std::chrono::system_clock::now();
+    IntersectionPlan plan = PlanIntersection(vertical, true, profiling_context);
+    if (plan.kind != PlanKind::kCountOnly) {
+        return GetStats(*GetOrCalculate(vertical, profiling_context, &plan));
+    }
+    misses_++;
+    PositionListIndex const& base = *plan.operands[0].pli_;
+    PositionListIndex::IntersectionStats stats;
+    if (plan.probing_plis.empty()) {
+        stats = GetStats(base);
+    } else {
+        // refines the base cluster by cluster and counts at the last probe, no PLI is built
+        std::vector<PositionListIndex const*> plis{&base};
+        plis.insert(plis.end(), plan.probing_plis.begin(), plan.probing_plis.end());
+        stats = PositionListIndex::GetIntersectionStats(std::move(plis));
+    }
+    LogPlan(plan, vertical, stats.size, start_time);
+    return stats;
+}
+
+unsigned long long PLICache::GetG1ViolationsFor(Vertical const& lhs, PositionListIndex const* rhs,
+                                                ProfilingContext* profiling_context) {
+    std::shared_ptr<PositionListIndex> pli = Get(lhs);
+    if (pli != nullptr) {
+        Use(*pli);
+        hits_++;
+        return pli->GetG1Violations(rhs);
+    }
+
+    IntersectionPlan plan = PlanIntersection(lhs, true, profiling_context);
+    if (plan.kind != PlanKind::kCountOnly) {
+        return GetOrCalculate(lhs, profiling_context, &plan)->GetG1Violations(rhs);
+    }
+    misses_++;
+    return plan.operands[0].pli_->GetG1Violations(plan.probing_plis, rhs);
+}
+
+std::shared_ptr<PositionListIndex> PLICache::GetOrCalculate(Vertical const& vertical,
+                                                            ProfilingContext* profiling_context,
+                                                            IntersectionPlan const* plan) {
     LOG(DEBUG) << boost::format{"PLI for %1% requested: "} % vertical.ToString();
 
     // is PLI already cached?
-    PositionListIndex* pli = Get(vertical);
+    std::shared_ptr<PositionListIndex> pli = Get(vertical);
     if (pli != nullptr) {
-        pli->IncFreq();
+        Use(*pli);
+        hits_++;
         LOG(DEBUG) << boost::format{"Served from PLI cache."};
-        //addToUsageCounter
         return pli;
     }
-    // look for cached PLIs to construct the requested one
+
+    // Only the first thread to miss the vertical calculates its PLI, the others wait for it
+    std::promise<std::shared_ptr<PositionListIndex>> calculation;
+    {
+        std::unique_lock lock(calculations_mutex_);
+        // the PLI could have been cached since the lookup above
+        pli = Get(vertical);
+        if (pli != nullptr) {
+            Use(*pli);
+            hits_++;
+            return pli;
+        }
+        if (auto it = calculations_.find(vertical); it != calculations_.end()) {
+            std::shared_future<std::shared_ptr<PositionListIndex>> result = it->second;
+            lock.unlock();
+            hits_++;
+            LOG(DEBUG) << boost::format{"Served from a concurrent calculation."};
+            return result.get();
+        }
+        calculations_.emplace(vertical, calculation.get_future().share());
+    }
+    misses_++;
+
+    try {
+        pli = Calculate(vertical,
+                        plan != nullptr ? *plan
+                                        : PlanIntersection(vertical, false, profiling_context),
+                        profiling_context);
+        calculation.set_value(pli);
+    } catch (...) {
+        calculation.set_exception(std::current_exception());
+        std::scoped_lock lock(calculations_mutex_);
+        calculations_.erase(vertical);
+        throw;
+    }
+    std::scoped_lock lock(calculations_mutex_);
+    calculations_.erase(vertical);
+    return pli;
+}
+
+// picks cached PLIs to construct the requested one from
+std::vector<PLICache::PositionListIndexRank> PLICache::SelectOperands(Vertical const& vertical) {
     auto subset_entries = index_->GetSubsetEntries(vertical);
     boost::optional<PositionListIndexRank> smallest_pli_rank;
     std::vector<PositionListIndexRank> ranks;
     ranks.reserve(subset_entries.size());
     for (auto& [sub_vertical, sub_pli_ptr] : subset_entries) {
         // TODO: избавиться от таких const_cast, которые сбрасывают константность
-        PositionListIndexRank pli_rank(&sub_vertical,
+        PositionListIndexRank pli_rank(sub_vertical,
                                        std::const_pointer_cast<PositionListIndex>(sub_pli_ptr),
                                        sub_vertical.GetArity());
         ranks.push_back(pli_rank);
@@ -77,12 +200,12 @@ std::variant<PositionListIndex*, std::unique_ptr<PositionListIndex>> PLICache::G
     assert(smallest_pli_rank);            // check if smallest_pli_rank is initialized
 
     std::vector<PositionListIndexRank> operands;
-    boost::dynamic_bitset<> cover(relation_data_->GetNumColumns());
-    boost::dynamic_bitset<> cover_tester(relation_data_->GetNumColumns());
+    ColumnSet cover(relation_data_->GetNumColumns());
+    ColumnSet cover_tester(relation_data_->GetNumColumns());
     if (smallest_pli_rank) {
-        smallest_pli_rank->pli_->IncFreq();
+        Use(*smallest_pli_rank->pli_);
         operands.push_back(*smallest_pli_rank);
-        cover |= smallest_pli_rank->vertical_->GetColumnIndices();
+        cover |= smallest_pli_rank->vertical_.GetColumnSet();
 
         while (cover.count() < vertical.GetArity() && !ranks.empty()) {
             boost::optional<PositionListIndexRank> best_rank;
@@ -90,7 +213,7 @@ std::variant<PositionListIndex*, std::unique_ptr<PositionListIndex>> PLICache::G
             ranks.erase(std::remove_if(ranks.begin(), ranks.end(),
                                        [&cover_tester, &cover](auto& rank) {
                                            cover_tester.reset();
-                                           cover_tester |= rank.vertical_->GetColumnIndices();
+                                           cover_tester |= rank.vertical_.GetColumnSet();
                                            cover_tester -= cover;
                                            rank.added_arity_ = cover_tester.count();
                                            return rank.added_arity_ < 2;
@@ -106,96 +229,359 @@ std::variant<PositionListIndex*, std::unique_ptr<PositionListIndex>> PLICache::G
             }
 
             if (best_rank) {
-                best_rank->pli_->IncFreq();
+                Use(*best_rank->pli_);
                 operands.push_back(*best_rank);
-                cover |= best_rank->vertical_->GetColumnIndices();
+                cover |= best_rank->vertical_.GetColumnSet();
             }
         }
     }
 
-    // TODO: конкретные костыли, надо делать Column : Vertical
-    std::vector<std::unique_ptr<Vertical>> vertical_columns;
-
     for (auto& column : vertical.GetColumns()) {
         if (!cover[column->GetIndex()]) {
-            vertical_columns.push_back(std::make_unique<Vertical>(static_cast<Vertical>(*column)));
-            auto column_pli = index_->Get(**vertical_columns.rbegin());
-            operands.emplace_back(vertical_columns.rbegin()->get(), column_pli, 1);
-            column_pli->IncFreq();
+            Vertical column_vertical = static_cast<Vertical>(*column);
+            auto column_pli = index_->Get(column_vertical);
+            Use(*column_pli);
+            operands.emplace_back(std::move(column_vertical), column_pli, 1);
         }
     }
     // sort operands by ascending order
     std::sort(operands.begin(), operands.end(),
               [](auto& el1, auto& el2) { return el1.pli_->GetSize() < el2.pli_->GetSize(); });
-    // TODO: Profiling context stuff
-
-    LOG(DEBUG) << boost::format{"Intersecting %1%."} % "[UNIMPLEMENTED]";
 
     if (operands.empty()) {
         throw std::logic_error("Current implementation assumes operands.size() > 0");
     }
+    return operands;
+}
+
+PLICache::PliEstimate PLICache::EstimateRefinement(PliEstimate const& estimate,
+                                                   PositionListIndex const& probing) const {
+    double const maximum_entropy = relation_data_->GetMaximumEntropy();
+    if (estimate.num_clusters < 1 || probing.GetMaximumNip() == 0) {
+        return {0, 0, maximum_entropy};
+    }
+    // probability that two tuples agree on the probing PLI
+    double const agreement = probing.GetNep() / probing.GetMaximumNip();
+    double const cluster_size = estimate.size / estimate.num_clusters;
+    // a tuple stays in a non-singleton cluster if another tuple of its cluster agrees with it
+    double const survival = 1 - std::pow(1 - agreement, cluster_size - 1);
+    if (survival <= 0) {
+        return {0, 0, maximum_entropy};
+    }
+    double const size = estimate.size * survival;
+    double const new_cluster_size =
+        std::max(2.0, 1 + (cluster_size - 1) * agreement / survival);
+    return {size, size / new_cluster_size,
+            std::min(estimate.entropy + probing.GetEntropy(), maximum_entropy)};
+}
+
+double PLICache::EstimateAdmission(PliEstimate const& estimate,
+                                   ProfilingContext const* profiling_context) const {
+    switch (caching_method_) {
+    case CachingMethod::kCoin:
+        return profiling_context != nullptr
+                   ? profiling_context->GetConfiguration().caching_probability
+                   : kCachingProbability;
+    case CachingMethod::kNoCaching:
+        return 0;
+    case CachingMethod::kAllCaching:
+        return 1;
+    case CachingMethod::kGini:
+    case CachingMethod::kInvertedEntropy:
+        // these measures are not estimated
+        return 0.5;
+    default:
+        return estimate.entropy <= GetEntropyThreshold() ? 1 : 0;
+    }
+}
+
+/* The cost of a plan is the number of tuples visited by its probes, plus the rows of the probing
+ * tables it builds, plus kMaterializationCost per tuple of every PLI it materializes. Sizes of the
+ * intermediate PLIs are estimated by EstimateRefinement. Every PLI offered to the cache is
+ * credited with kReuseCredit of the cost of obtaining it, weighted by its chance to be admitted */
+PLICache::IntersectionPlan PLICache::PlanIntersection(Vertical const& vertical,
+                                                      bool is_count_only_allowed,
+                                                      ProfilingContext* profiling_context) {
+    std::vector<PositionListIndexRank> operands = SelectOperands(vertical);
+    double const num_rows = relation_data_->GetNumRows();
+    auto const estimate_of = [](PositionListIndex const& pli) {
+        return PliEstimate{static_cast<double>(pli.GetSize()),
+                           static_cast<double>(pli.GetNumNonSingletonCluster()), pli.GetEntropy()};
+    };
+    auto const table_cost = [num_rows](PositionListIndex const& pli) {
+        return pli.GetCachedProbingTable() == nullptr ? num_rows : 0;
+    };
+
+    // Pairwise chain. Intersect probes a PLI with a cached probing table if there is one,
+    // otherwise it builds the probing table of the larger PLI and iterates over the smaller one
+    PliEstimate chain = estimate_of(*operands[0].pli_);
+    bool is_chain_table_cached = operands[0].pli_->GetCachedProbingTable() != nullptr;
+    double pairwise_cost = 0;
+    double pairwise_credit = 0;
+    for (std::size_t i = 1; i < operands.size(); ++i) {
+        PositionListIndex const& operand = *operands[i].pli_;
+        if (operand.GetCachedProbingTable() != nullptr) {
+            pairwise_cost += chain.size;
+        } else if (is_chain_table_cached) {
+            pairwise_cost += operand.GetSize();
+        } else {
+            pairwise_cost += std::min(chain.size, static_cast<double>(operand.GetSize())) + num_rows;
+        }
+        chain = EstimateRefinement(chain, operand);
+        is_chain_table_cached = false;
+        pairwise_cost += kMaterializationCost * chain.size;
+        if (i + 1 < operands.size()) {
+            pairwise_credit +=
+                kReuseCredit * EstimateAdmission(chain, profiling_context) * pairwise_cost;
+        }
+    }
+
+    // N-ary refinement of the smallest operand. Every other operand is probed either by its own
+    // probing table or by the probing tables of the columns it adds, which are always cached
+    std::vector<PositionListIndex const*> probing_plis;
+    PliEstimate refined = estimate_of(*operands[0].pli_);
+    ColumnSet probed = operands[0].vertical_.GetColumnSet();
+    for (std::size_t i = 1; i < operands.size(); ++i) {
+        ColumnSet added = operands[i].vertical_.GetColumnSet();
+        added -= probed;
+        std::vector<PositionListIndex const*> columns;
+        PliEstimate by_columns = refined;
+        double by_columns_cost = 0;
+        for (std::size_t index = added.find_first(); index < added.size();
+             index = added.find_next(index)) {
+            columns.push_back(relation_data_->GetColumnData(index).GetPositionListIndex());
+            by_columns_cost += by_columns.size + table_cost(*columns.back());
+            by_columns = EstimateRefinement(by_columns, *columns.back());
+        }
+        double const by_operand_cost = refined.size + table_cost(*operands[i].pli_);
+        if (by_columns_cost <= by_operand_cost) {
+            probing_plis.insert(probing_plis.end(), columns.begin(), columns.end());
+            refined = by_columns;
+        } else {
+            probing_plis.push_back(operands[i].pli_.get());
+            refined = EstimateRefinement(refined, *operands[i].pli_);
+        }
+        probed |= operands[i].vertical_.GetColumnSet();
+    }
+    // ProbeAll copies the base and probes by the smallest PLIs first
+    std::sort(probing_plis.begin(), probing_plis.end(),
+              [](PositionListIndex const* a, PositionListIndex const* b) {
+                  return a->GetSize() < b->GetSize();
+              });
+    refined = estimate_of(*operands[0].pli_);
+    double nary_cost = refined.size;
+    for (PositionListIndex const* probing_pli : probing_plis) {
+        nary_cost += refined.size + table_cost(*probing_pli);
+        refined = EstimateRefinement(refined, *probing_pli);
+    }
+    // a count-only plan refines the base cluster by cluster without copying or materializing it
+    double const count_only_cost = nary_cost - operands[0].pli_->GetSize();
+    nary_cost += kMaterializationCost * refined.size;
+
+    IntersectionPlan plan =
+        pairwise_cost - pairwise_credit <= nary_cost
+            ? IntersectionPlan{PlanKind::kPairwise, std::move(operands), {}, pairwise_cost, chain}
+            : IntersectionPlan{PlanKind::kNary, std::move(operands), std::move(probing_plis),
+                               nary_cost, refined};
+    if (is_count_only_allowed && plan.operands.size() > 1) {
+        double const result_credit =
+            kReuseCredit * EstimateAdmission(plan.estimate, profiling_context) *
+            plan.estimated_cost;
+        if (count_only_cost < plan.estimated_cost - result_credit) {
+            if (plan.kind == PlanKind::kPairwise) {
+                plan.probing_plis = std::move(probing_plis);
+            }
+            plan.kind = PlanKind::kCountOnly;
+            plan.estimated_cost = count_only_cost;
+            plan.estimate = refined;
+        }
+    }
+    return plan;
+}
+
+void PLICache::LogPlan(IntersectionPlan const& plan, Vertical const& vertical,
+                       unsigned int actual_size,
+                       std::chrono::system_clock::time_point start_time) const {
+    static char const* const plan_names[] = {"Pairwise", "N-ary", "Count-only"};
+    LOG(DEBUG) << boost::format{"%1% plan for %2% from %3% operands: estimated cost %4%, "
+                                "estimated size %5%, actual size %6%, %7% us."} %
+                      plan_names[static_cast<int>(plan.kind)] % vertical.ToString() %
+                      plan.operands.size() % plan.estimated_cost % plan.estimate.size %
+                      actual_size %
+                      std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::system_clock::now() - start_time)
+                          .count();
+}
+
+// calculates a PositionListIndex by intersecting the cached PLIs of its subsets as planned
+std::shared_ptr<PositionListIndex> PLICache::Calculate(Vertical const& vertical,
+                                                       IntersectionPlan const& plan,
+                                                       ProfilingContext* profiling_context) {
+    auto start_time = std::chrono::system_clock::now();
+    std::vector<PositionListIndexRank> const& operands = plan.operands;
 
-    // TODO: тут не очень понятно: CachingProcess может забрать себе PLI, а может и отдать обратно,
-    //  поэтому приходится через variant разбирать. Проверить, насколько много платим за обёртку.
     // Intersect and cache
-    std::variant<PositionListIndex*, std::unique_ptr<PositionListIndex>> variant_intersection_pli;
-    if (operands.size() >= profiling_context->GetConfiguration().nary_intersection_size) {
-        PositionListIndexRank base_pli_rank = operands[0];
-        auto intersection_pli = base_pli_rank.pli_->ProbeAll(
-            vertical.Without(*base_pli_rank.vertical_), *relation_data_);
-        variant_intersection_pli =
-            CachingProcess(vertical, std::move(intersection_pli), profiling_context);
+    std::shared_ptr<PositionListIndex> intersection_pli;
+    if (plan.kind == PlanKind::kNary) {
+        intersection_pli = CachingProcess(
+            vertical, operands[0].pli_->ProbeAll(plan.probing_plis), profiling_context);
     } else {
-        Vertical current_vertical = *operands.begin()->vertical_;
-        variant_intersection_pli = operands.begin()->pli_.get();
+        Vertical current_vertical = operands[0].vertical_;
+        intersection_pli = operands[0].pli_;
 
         for (size_t i = 1; i < operands.size(); i++) {
-            current_vertical = current_vertical.Union(*operands[i].vertical_);
-            variant_intersection_pli =
-                std::holds_alternative<PositionListIndex*>(variant_intersection_pli)
-                    ? std::get<PositionListIndex*>(variant_intersection_pli)
-                          ->Intersect(operands[i].pli_.get())
-                    : std::get<std::unique_ptr<PositionListIndex>>(variant_intersection_pli)
-                          ->Intersect(operands[i].pli_.get());
-            variant_intersection_pli = CachingProcess(
-                current_vertical,
-                std::move(std::get<std::unique_ptr<PositionListIndex>>(variant_intersection_pli)),
+            current_vertical = current_vertical.Union(operands[i].vertical_);
+            intersection_pli = CachingProcess(
+                current_vertical, intersection_pli->Intersect(operands[i].pli_.get()),
                 profiling_context);
         }
     }
 
+    LogPlan(plan, vertical, intersection_pli->GetSize(), start_time);
     LOG(DEBUG) << boost::format{"Calculated from %1% sub-PLIs (saved %2% intersections)."} %
                       operands.size() % (vertical.GetArity() - operands.size());
 
-    return variant_intersection_pli;
+    return intersection_pli;
 }
 
 size_t PLICache::Size() const {
     return index_->GetSize();
 }
 
-std::variant<PositionListIndex*, std::unique_ptr<PositionListIndex>> PLICache::CachingProcess(
+std::shared_ptr<PositionListIndex> PLICache::CachingProcess(
     Vertical const& vertical, std::unique_ptr<PositionListIndex> pli,
     ProfilingContext* profiling_context) {
-    auto pli_pointer = pli.get();
+    std::shared_ptr<PositionListIndex> shared_pli = std::move(pli);
+    std::scoped_lock lock(caching_mutex_);
+    auto const put = [this, &vertical, &shared_pli]() {
+        Use(*shared_pli);
+        memory_usage_ += shared_pli->GetMemoryUsage();
+        if (auto old_pli = index_->Put(vertical, shared_pli); old_pli != nullptr) {
+            memory_usage_ -= old_pli->GetMemoryUsage();
+        }
+        if (memory_limit_ != 0 && memory_usage_ > memory_limit_) {
+            Evict();
+        }
+        return shared_pli;
+    };
     switch (caching_method_) {
     case CachingMethod::kCoin:
-        if (profiling_context->NextDouble() <
-            profiling_context->GetConfiguration().caching_probability) {
-            index_->Put(vertical, std::move(pli));
-            return pli_pointer;
+        if (profiling_context != nullptr
+                ? profiling_context->NextDouble() <
+                      profiling_context->GetConfiguration().caching_probability
+                : std::uniform_real_distribution<double>()(random_) < kCachingProbability) {
+            return put();
         } else {
-            return pli;
+            return shared_pli;
         }
     case CachingMethod::kNoCaching:
-        return pli;
+        return shared_pli;
     case CachingMethod::kAllCaching:
-        index_->Put(vertical, std::move(pli));
-        return pli_pointer;
+        return put();
+    default:
+        return IsAdmitted(*shared_pli) ? put() : shared_pli;
+    }
+}
+
+/* The threshold policies cache PLIs with clusters larger than typical for the relation's
+ * columns: such PLIs are expensive to recompute and are good operands for further
+ * intersections, whereas nearly unique ones are cheap and rarely reused.
+ * caching_method_value_ scales the threshold */
+bool PLICache::IsAdmitted(PositionListIndex const& pli) const {
+    switch (caching_method_) {
+    case CachingMethod::kEntropy:
+    case CachingMethod::kTrueUniquenessEntropy:
+    case CachingMethod::kMeanEntropyThreshold:
+    case CachingMethod::kHeuristicQ2:
+        return pli.GetEntropy() <= GetEntropyThreshold();
+    case CachingMethod::kGini:
+        return pli.GetGiniImpurity() <= caching_method_value_ * median_gini_;
+    case CachingMethod::kInvertedEntropy:
+        return pli.GetInvertedEntropy() <= caching_method_value_ * median_inverted_entropy_;
     default:
-        throw std::runtime_error(
-            "Only kNoCaching and kAllCaching strategies are currently available");
+        throw std::logic_error("Caching method without admission threshold");
+    }
+}
+
+double PLICache::GetEntropyThreshold() const {
+    switch (caching_method_) {
+    case CachingMethod::kEntropy:
+        // a share of the entropy of a key, log N, which every PLI is below
+        return caching_method_value_ * kKeyEntropyShare * relation_data_->GetMaximumEntropy();
+    case CachingMethod::kTrueUniquenessEntropy:
+        // not more unique than the most unique column
+        return caching_method_value_ * maximum_entropy_;
+    case CachingMethod::kMeanEntropyThreshold:
+        return caching_method_value_ * mean_entropy_;
+    case CachingMethod::kHeuristicQ2:
+        // second quartile of the column entropies
+        return caching_method_value_ * median_entropy_;
+    default:
+        throw std::logic_error("Caching method without entropy threshold");
+    }
+}
+
+void PLICache::Evict() {
+    using Entry = VerticalMap<PositionListIndex>::Entry;
+    std::vector<Entry> candidates;
+    for (Entry const& entry : index_->EntrySet()) {
+        if (entry.first.GetArity() > 1) {
+            candidates.push_back(entry);
+        }
+    }
+
+    auto const by_last_use = [](Entry const& first, Entry const& second) {
+        return first.second->GetLastUse() < second.second->GetLastUse();
+    };
+    switch (eviction_method_) {
+    case CacheEvictionMethod::kDefault:
+        // least recently used first
+        std::sort(candidates.begin(), candidates.end(), by_last_use);
+        break;
+    case CacheEvictionMethod::kMedainUsage: {
+        // PLIs used at most median number of times go first, least recently used first
+        std::vector<unsigned int> freqs;
+        freqs.reserve(candidates.size());
+        for (Entry const& entry : candidates) {
+            freqs.push_back(entry.second->GetFreq());
+        }
+        auto median = freqs.begin() + freqs.size() / 2;
+        std::nth_element(freqs.begin(), median, freqs.end());
+        unsigned int median_freq = freqs.empty() ? 0 : *median;
+        std::sort(candidates.begin(), candidates.end(),
+                  [median_freq, &by_last_use](Entry const& first, Entry const& second) {
+                      bool first_is_cold = first.second->GetFreq() <= median_freq;
+                      bool second_is_cold = second.second->GetFreq() <= median_freq;
+                      return first_is_cold != second_is_cold ? first_is_cold
+                                                             : by_last_use(first, second);
+                  });
+        break;
+    }
+    case CacheEvictionMethod::kHottoRemain:
+        // least frequently used first, ties are broken by recency
+        std::sort(candidates.begin(), candidates.end(),
+                  [&by_last_use](Entry const& first, Entry const& second) {
+                      return first.second->GetFreq() != second.second->GetFreq()
+                                 ? first.second->GetFreq() < second.second->GetFreq()
+                                 : by_last_use(first, second);
+                  });
+        break;
+    }
+
+    std::size_t const target_usage = memory_limit_ * kEvictionTarget;
+    auto it = candidates.begin();
+    for (; it != candidates.end() && memory_usage_ > target_usage; ++it) {
+        index_->Remove(it->first);
+        memory_usage_ -= it->second->GetMemoryUsage();
+        evictions_++;
+    }
+    // Frequencies of the survivors are aged, otherwise PLIs that were hot long ago never leave
+    if (eviction_method_ != CacheEvictionMethod::kDefault) {
+        for (; it != candidates.end(); ++it) {
+            std::const_pointer_cast<PositionListIndex>(it->second)->AgeFreq();
+        }
     }
+    LOG(DEBUG) << boost::format{"Evicted PLIs down to %1% bytes."} % memory_usage_;
 }
 
 } // namespace util
@@ -6,8 +6,14 @@ class ProfilingContext;
 #include "CachingMethod.h"
 #include "ProfilingContext.h"
 #include "ColumnLayoutRelationData.h"
+#include "custom/CustomHashes.h"
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <mutex>
+#include <random>
+#include <unordered_map>
 
 namespace util {
 
@@ -15,13 +21,43 @@ class PLICache {
 private:
     class PositionListIndexRank {
     public:
-        Vertical const* vertical_;
+        Vertical vertical_;
         std::shared_ptr<PositionListIndex> pli_;
         int added_arity_;
 
-        PositionListIndexRank(Vertical const* vertical, std::shared_ptr<PositionListIndex> pli,
+        PositionListIndexRank(Vertical vertical, std::shared_ptr<PositionListIndex> pli,
                               int initial_arity)
-            : vertical_(vertical), pli_(pli), added_arity_(initial_arity) {}
+            : vertical_(std::move(vertical)), pli_(pli), added_arity_(initial_arity) {}
+    };
+
+    /* Ways to combine the operands of a requested PLI */
+    enum class PlanKind {
+        /* Intersects the operands one by one, every intermediate PLI is offered to the cache */
+        kPairwise,
+        /* Refines the first operand by the probing tables of the others without materializing
+         * intermediate PLIs, only the result is offered to the cache */
+        kNary,
+        /* Like kNary, but only the statistics of the result are computed */
+        kCountOnly
+    };
+
+    /* Expected properties of a PLI that is not calculated yet */
+    struct PliEstimate {
+        double size;
+        double num_clusters;
+        double entropy;
+    };
+
+    struct IntersectionPlan {
+        PlanKind kind;
+        /* Operands in ascending order of size, the first one is the base of the refinement */
+        std::vector<PositionListIndexRank> operands;
+        /* PLIs refining the base under kNary and kCountOnly: other operands, or the columns
+         * they add to the base when probing those is cheaper than building their probing tables */
+        std::vector<PositionListIndex const*> probing_plis;
+        /* In tuples visited, see PlanIntersection */
+        double estimated_cost;
+        PliEstimate estimate;
     };
 
     //using CacheMap = VerticalMap<PositionListIndex>;
@@ -31,7 +67,40 @@ private:
 
     int saved_intersections_ = 0;
 
-    mutable std::mutex getting_pli_mutex_;
+    /* Futures of the PLIs being calculated. Threads missing a vertical that is already being
+     * calculated wait for the result instead of intersecting the same PLIs once more */
+    std::unordered_map<Vertical, std::shared_future<std::shared_ptr<PositionListIndex>>>
+        calculations_;
+    std::mutex calculations_mutex_;
+    /* Serializes the admission and eviction of PLIs. Lookups and intersections are not locked */
+    std::mutex caching_mutex_;
+
+    /* Ceiling on the bytes taken by the cached multi-column PLIs, 0 means no ceiling.
+     * Single-column PLIs are owned by the relation and are never evicted */
+    std::size_t memory_limit_;
+    std::atomic<std::size_t> memory_usage_ = 0;
+    /* Incremented on every use of a cached PLI to order the uses */
+    std::atomic<unsigned long long> clock_ = 0;
+    std::atomic<unsigned long long> hits_ = 0;
+    std::atomic<unsigned long long> misses_ = 0;
+    std::atomic<unsigned long long> evictions_ = 0;
+
+    /* Evictions free memory down to this share of memory_limit_, so that they do not run on
+     * every insertion */
+    static constexpr double kEvictionTarget = 0.9;
+    /* Coin probability used when no ProfilingContext is given, same as in Configuration */
+    static constexpr double kCachingProbability = 0.5;
+    /* Share of the entropy of a key that CachingMethod::kEntropy admits at a caching_method_value
+     * of 1 */
+    static constexpr double kKeyEntropyShare = 0.5;
+    /* Cost model of PlanIntersection. Costs are measured in tuples visited by a probe, building
+     * a probing table visits every row and materializing a PLI visits its tuples this many times */
+    static constexpr double kMaterializationCost = 2;
+    /* Share of the cost of a PLI that caching it is expected to save later */
+    static constexpr double kReuseCredit = 0.5;
+    /* Tosses the coin of CachingMethod::kCoin without a ProfilingContext, guarded by
+     * caching_mutex_ */
+    std::mt19937 random_;
 
     CachingMethod caching_method_;
     CacheEvictionMethod eviction_method_;
@@ -44,23 +113,76 @@ private:
     double median_gini_;
     double median_inverted_entropy_;
 
-    std::variant<PositionListIndex*, std::unique_ptr<PositionListIndex>> CachingProcess(
-        Vertical const& vertical, std::unique_ptr<PositionListIndex> pli,
-        ProfilingContext* profiling_context);
+    std::shared_ptr<PositionListIndex> GetOrCalculate(Vertical const& vertical,
+                                                      ProfilingContext* profiling_context,
+                                                      IntersectionPlan const* plan);
+    std::shared_ptr<PositionListIndex> Calculate(Vertical const& vertical,
+                                                 IntersectionPlan const& plan,
+                                                 ProfilingContext* profiling_context);
+    /* Picks cached PLIs whose verticals cover the given one, the rest is covered by columns */
+    std::vector<PositionListIndexRank> SelectOperands(Vertical const& vertical);
+    /* Chooses the cheapest way to calculate the PLI of vertical. kCountOnly is considered only
+     * if is_count_only_allowed */
+    IntersectionPlan PlanIntersection(Vertical const& vertical, bool is_count_only_allowed,
+                                      ProfilingContext* profiling_context);
+    /* Expected result of refining a PLI with the given estimate by probing, assuming that the
+     * columns are independent */
+    PliEstimate EstimateRefinement(PliEstimate const& estimate,
+                                   PositionListIndex const& probing) const;
+    /* Probability that CachingProcess puts a PLI with the given estimate into the cache */
+    double EstimateAdmission(PliEstimate const& estimate,
+                             ProfilingContext const* profiling_context) const;
+    void LogPlan(IntersectionPlan const& plan, Vertical const& vertical, unsigned int actual_size,
+                 std::chrono::system_clock::time_point start_time) const;
+    std::shared_ptr<PositionListIndex> CachingProcess(Vertical const& vertical,
+                                                      std::unique_ptr<PositionListIndex> pli,
+                                                      ProfilingContext* profiling_context);
+    /* Whether a threshold caching method admits pli into the cache */
+    bool IsAdmitted(PositionListIndex const& pli) const;
+    /* Entropy up to which the entropy-based caching methods admit PLIs */
+    double GetEntropyThreshold() const;
+    void Use(PositionListIndex& pli) { pli.Use(++clock_); }
+    /* Evicts multi-column PLIs according to eviction_method_ until the cached PLIs fit into
+     * memory_limit_ */
+    void Evict();
 
 public:
     PLICache(ColumnLayoutRelationData* relation_data, CachingMethod caching_method,
              CacheEvictionMethod eviction_method, double caching_method_value, double min_entropy,
              double mean_entropy, double median_entropy, double maximum_entropy, double median_gini,
-             double median_inverted_entropy);
-
-    PositionListIndex* Get(Vertical const& vertical);
-    std::variant<PositionListIndex*, std::unique_ptr<PositionListIndex>> GetOrCreateFor(
-        Vertical const& vertical, ProfilingContext* profiling_context);
+             double median_inverted_entropy, std::size_t memory_limit = 0);
+    /* Takes the admission thresholds from the columns of relation_data. Meant for the
+     * algorithms that share the cache without keeping a ProfilingContext */
+    PLICache(ColumnLayoutRelationData* relation_data, CachingMethod caching_method,
+             CacheEvictionMethod eviction_method, double caching_method_value = 1,
+             std::size_t memory_limit = 0);
+
+    /* Returned PLIs are shared, so they stay valid after being evicted. Both methods can be
+     * called concurrently. Without a profiling context the intersection and coin settings
+     * default to the ones of Configuration */
+    std::shared_ptr<PositionListIndex> Get(Vertical const& vertical);
+    std::shared_ptr<PositionListIndex> GetOrCreateFor(
+        Vertical const& vertical, ProfilingContext* profiling_context = nullptr);
+    /* Statistics of the PLI of vertical. Unless it is cached, the PLI is materialized only if
+     * caching it is expected to pay off */
+    PositionListIndex::IntersectionStats GetStatsFor(
+        Vertical const& vertical, ProfilingContext* profiling_context = nullptr);
+    /* Number of tuple pairs violating lhs -> rhs. Unless it is cached, the PLI of lhs is
+     * materialized only if caching it is expected to pay off, otherwise the violations are
+     * counted while refining the operands of lhs */
+    unsigned long long GetG1ViolationsFor(Vertical const& lhs, PositionListIndex const* rhs,
+                                          ProfilingContext* profiling_context = nullptr);
 
     void SetMaximumEntropy(double e) { maximum_entropy_ = e; }
 
     size_t Size() const;
+    std::size_t GetMemoryUsage() const { return memory_usage_; }
+    unsigned long long GetHits() const { return hits_; }
+    double GetHitRate() const {
+        return hits_ + misses_ == 0 ? 0 : static_cast<double>(hits_) / (hits_ + misses_);
+    }
+    unsigned long long GetMisses() const { return misses_; }
+    unsigned long long GetEvictions() const { return evictions_; }
 
     // returns ownership of single column PLIs back to ColumnLayoutRelationData
     virtual ~PLICache();
@@ -7,8 +7,9 @@
 #include <chrono>
 #include <cmath>
 #include <deque>
-#include <map>
 #include <memory>
+#include <numeric>
+#include <unordered_map>
 #include <utility>
 
 #include <boost/dynamic_bitset.hpp>
@@ -20,17 +21,35 @@
 
 namespace util {
 
+namespace {
+
+/* Scratch memory of the dense probing kernel. slots is indexed by probing table value id and is
+ * all zeroes between calls: only the ids listed in touched get modified and they are reset
+ * before returning */
+struct ProbeScratch {
+    std::vector<int> slots;
+    std::vector<int> touched;
+};
+
+thread_local ProbeScratch probe_scratch;
+
+} // namespace
+
 const int PositionListIndex::singleton_value_id_ = 0;
-unsigned long long PositionListIndex::micros_ = 0;
-int PositionListIndex::intersection_count_ = 0;
+std::atomic<unsigned long long> PositionListIndex::micros_ = 0;
+std::atomic<unsigned long long> PositionListIndex::intersection_count_ = 0;
+PositionListIndex::IntersectionMethod PositionListIndex::intersection_method_ =
+    PositionListIndex::IntersectionMethod::kDenseScratch;
 
-PositionListIndex::PositionListIndex(std::deque<std::vector<int>> index,
+PositionListIndex::PositionListIndex(std::vector<int> positions,
+                                     std::vector<unsigned int> offsets,
                                      std::vector<int> null_cluster, unsigned int size,
                                      double entropy, unsigned long long nep,
                                      unsigned int relation_size,
                                      unsigned int original_relation_size, double inverted_entropy,
                                      double gini_impurity)
-    : index_(std::move(index)),
+    : positions_(std::move(positions)),
+      offsets_(std::move(offsets)),
       null_cluster_(std::move(null_cluster)),
       size_(size),
       entropy_(entropy),
@@ -39,44 +58,65 @@ PositionListIndex::PositionListIndex(std::deque<std::vector<int>> index,
       nep_(nep),
       relation_size_(relation_size),
       original_relation_size_(original_relation_size),
-      probing_table_cache_() {}
+      probing_table_cache_() {
+    assert(!offsets_.empty() && offsets_.back() == positions_.size());
+}
 
 std::unique_ptr<PositionListIndex> PositionListIndex::CreateFor(std::vector<int>& data,
                                                                 bool is_null_eq_null) {
-    std::unordered_map<int, std::vector<int>> index;
-    for (unsigned long position = 0; position < data.size(); ++position) {
-        int value_id = data[position];
-        index[value_id].push_back(position);
+    // Value ids are dense, so tuples are bucketed by a two-pass counting sort over the
+    // thread-local probing scratch. Slot of a value id is shifted by one to fit the null id
+    static_assert(ColumnLayoutRelationData::kNullValueId == -1);
+    int max_value_id = ColumnLayoutRelationData::kNullValueId;
+    for (int value_id : data) {
+        max_value_id = std::max(max_value_id, value_id);
+    }
+    ReserveProbeScratch(max_value_id + 1);
+    std::vector<int>& slots = probe_scratch.slots;
+    std::vector<int>& touched = probe_scratch.touched;
+    int const null_slot = ColumnLayoutRelationData::kNullValueId + 1;
+
+    // Count tuples per value, remembering values in order of first appearance
+    for (int value_id : data) {
+        assert(value_id >= ColumnLayoutRelationData::kNullValueId);
+        if (slots[value_id + 1]++ == 0) {
+            touched.push_back(value_id + 1);
+        }
     }
 
     std::vector<int> null_cluster;
-    if (index.count(ColumnLayoutRelationData::kNullValueId) != 0) {
-        null_cluster = index[ColumnLayoutRelationData::kNullValueId];
-    }
-    if (!is_null_eq_null) {
-        index.erase(ColumnLayoutRelationData::kNullValueId); // move?
-    }
+    null_cluster.reserve(slots[null_slot]);
 
     double key_gap = 0.0;
     double inv_ent = 0;
     double gini_gap = 0;
     unsigned long long nep = 0;
     unsigned int size = 0;
-    std::deque<std::vector<int>> clusters;
-
-    for (auto& iter : index) {
-        if (iter.second.size() == 1) {
+    std::vector<unsigned int> offsets{0};
+
+    // Turn counts into write cursors of the clusters, -1 marks values without a cluster.
+    // Clusters are laid out in order of their first tuple, so no sorting is needed
+    for (int slot_index : touched) {
+        int& slot = slots[slot_index];
+        unsigned int cluster_size = slot;
+        if (slot_index == null_slot && !is_null_eq_null) {
+            slot = -1;
+            continue;
+        }
+        if (cluster_size == 1) {
             gini_gap += std::pow(1 / static_cast<double>(data.size()), 2);
+            slot = -1;
             continue;
         }
-        key_gap += iter.second.size() * log(iter.second.size());
-        nep += CalculateNep(iter.second.size());
-        size += iter.second.size();
-        inv_ent += -(1 - iter.second.size() / static_cast<double>(data.size())) *
-                   std::log(1 - (iter.second.size() / static_cast<double>(data.size())));
-        gini_gap += std::pow(iter.second.size() / static_cast<double>(data.size()), 2);
-
-        clusters.emplace_back(std::move(iter.second));
+        key_gap += cluster_size * log(cluster_size);
+        nep += CalculateNep(cluster_size);
+        inv_ent += -(1 - cluster_size / static_cast<double>(data.size())) *
+                   std::log(1 - (cluster_size / static_cast<double>(data.size())));
+        gini_gap += std::pow(cluster_size / static_cast<double>(data.size()), 2);
+
+        slot = size;
+        size += cluster_size;
+        offsets.push_back(size);
     }
     double entropy = log(data.size()) - key_gap / data.size();
 
@@ -85,19 +125,59 @@ std::unique_ptr<PositionListIndex> PositionListIndex::CreateFor(std::vector<int>
         inv_ent = 0;
     }
 
-    SortClusters(clusters);
-    return std::make_unique<PositionListIndex>(std::move(clusters), std::move(null_cluster), size,
-                                               entropy, nep, data.size(), data.size(), inv_ent,
-                                               gini_impurity);
+    std::vector<int> positions(size);
+    for (unsigned long position = 0; position < data.size(); ++position) {
+        int slot_index = data[position] + 1;
+        if (slot_index == null_slot) {
+            null_cluster.push_back(position);
+        }
+        int& slot = slots[slot_index];
+        if (slot >= 0) {
+            positions[slot++] = position;
+        }
+    }
+
+    for (int slot_index : touched) {
+        slots[slot_index] = 0;
+    }
+    touched.clear();
+
+    return std::make_unique<PositionListIndex>(std::move(positions), std::move(offsets),
+                                               std::move(null_cluster), size, entropy, nep,
+                                               data.size(), data.size(), inv_ent, gini_impurity);
 }
 
 //unsigned long long PositionListIndex::CalculateNep(unsigned int numElements) {
 //
 //}
 
-void PositionListIndex::SortClusters(std::deque<std::vector<int>>& clusters) {
-    sort(clusters.begin(), clusters.end(),
-         [](std::vector<int>& a, std::vector<int>& b) { return a[0] < b[0]; });
+void PositionListIndex::SortClusters(std::vector<int>& positions,
+                                     std::vector<unsigned int>& offsets) {
+    std::size_t const num_clusters = offsets.size() - 1;
+    bool is_sorted = true;
+    for (std::size_t i = 1; i < num_clusters && is_sorted; ++i) {
+        is_sorted = positions[offsets[i - 1]] < positions[offsets[i]];
+    }
+    if (is_sorted) return;
+
+    std::vector<unsigned int> order(num_clusters);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&positions, &offsets](unsigned a, unsigned b) {
+        return positions[offsets[a]] < positions[offsets[b]];
+    });
+
+    std::vector<int> sorted_positions;
+    std::vector<unsigned int> sorted_offsets;
+    sorted_positions.reserve(positions.size());
+    sorted_offsets.reserve(offsets.size());
+    sorted_offsets.push_back(0);
+    for (unsigned int cluster_index : order) {
+        sorted_positions.insert(sorted_positions.end(), positions.begin() + offsets[cluster_index],
+                                positions.begin() + offsets[cluster_index + 1]);
+        sorted_offsets.push_back(sorted_positions.size());
+    }
+    positions = std::move(sorted_positions);
+    offsets = std::move(sorted_offsets);
 }
 
 std::shared_ptr<const std::vector<int>> PositionListIndex::CalculateAndGetProbingTable() const {
@@ -105,7 +185,7 @@ std::shared_ptr<const std::vector<int>> PositionListIndex::CalculateAndGetProbin
 
     std::vector<int> probing_table = std::vector<int>(original_relation_size_);
     int next_cluster_id = singleton_value_id_ + 1;
-    for (auto& cluster : index_) {
+    for (ClusterSpan cluster : GetClusters()) {
         int value_id = next_cluster_id++;
         assert(value_id != singleton_value_id_);
         for (int position : cluster) {
@@ -129,42 +209,362 @@ std::shared_ptr<const std::vector<int>> PositionListIndex::CalculateAndGetProbin
     return probingTable;
 }*/
 
-//std::deque<std::vector<int>> const & PositionListIndex::getIndex() const {
-//    return index;
-//}
+std::deque<std::vector<int>> PositionListIndex::GetIndex() const {
+    std::deque<std::vector<int>> index;
+    for (ClusterSpan cluster : GetClusters()) {
+        index.push_back(cluster.ToCluster());
+    }
+    return index;
+}
+
+std::size_t PositionListIndex::GetMemoryUsage() const {
+    std::size_t memory_usage = sizeof(PositionListIndex) + positions_.capacity() * sizeof(int) +
+                               offsets_.capacity() * sizeof(unsigned int) +
+                               null_cluster_.capacity() * sizeof(int);
+    if (probing_table_cache_ != nullptr) {
+        memory_usage += probing_table_cache_->capacity() * sizeof(int);
+    }
+    return memory_usage;
+}
+
+std::pair<PositionListIndex const*, PositionListIndex const*> PositionListIndex::ChooseProbeOrder(
+    PositionListIndex const* first, PositionListIndex const* second) {
+    bool const first_cached = first->GetCachedProbingTable() != nullptr;
+    bool const second_cached = second->GetCachedProbingTable() != nullptr;
+    if (first_cached != second_cached) {
+        return first_cached ? std::make_pair(second, first) : std::make_pair(first, second);
+    }
+    return first->size_ > second->size_ ? std::make_pair(second, first)
+                                        : std::make_pair(first, second);
+}
 
 std::unique_ptr<PositionListIndex> PositionListIndex::Intersect(PositionListIndex const* that) const {
     assert(this->relation_size_ == that->relation_size_);
-    return this->size_ > that->size_ ?
-           that->Probe(this->CalculateAndGetProbingTable()) :
-           this->Probe(that->CalculateAndGetProbingTable());
+    auto start_time = std::chrono::system_clock::now();
+    auto [iterated, probed] = ChooseProbeOrder(this, that);
+    std::unique_ptr<PositionListIndex> intersection = iterated->Probe(
+        *probed->CalculateAndGetProbingTable(), probed->GetNumNonSingletonCluster());
+    micros_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now() - start_time)
+                   .count();
+    intersection_count_++;
+    return intersection;
+}
+
+std::unique_ptr<PositionListIndex> PositionListIndex::Probe(
+    std::shared_ptr<const std::vector<int>> probing_table) const {
+    if (probing_table->empty()) {
+        return Probe(*probing_table, singleton_value_id_);
+    }
+    return Probe(*probing_table, *std::max_element(probing_table->begin(), probing_table->end()));
+}
+
+std::unique_ptr<PositionListIndex> PositionListIndex::Probe(std::vector<int> const& probing_table,
+                                                            unsigned int max_value_id) const {
+    switch (intersection_method_) {
+    case IntersectionMethod::kHashing:
+        return ProbeHashing(probing_table);
+    case IntersectionMethod::kDenseScratch:
+        return ProbeDenseScratch(probing_table, max_value_id);
+    }
+    assert(0);
+    return nullptr;
+}
+
+void PositionListIndex::RefineCluster(ClusterSpan cluster, std::vector<int> const& probing_table,
+                                      std::vector<int>& new_positions,
+                                      std::vector<unsigned int>& new_offsets) {
+    ProbeScratch& scratch = probe_scratch;
+    std::vector<int>& slots = scratch.slots;
+    std::vector<int>& touched = scratch.touched;
+
+    // Count tuples per probing table value, remembering values in order of first appearance
+    for (int position : cluster) {
+        int probing_table_value_id = probing_table[position];
+        if (probing_table_value_id == singleton_value_id_) continue;
+        if (slots[probing_table_value_id]++ == 0) {
+            touched.push_back(probing_table_value_id);
+        }
+    }
+
+    // Turn counts into write cursors of the new clusters, -1 marks singletons
+    unsigned int cursor = new_positions.size();
+    for (int probing_table_value_id : touched) {
+        int& slot = slots[probing_table_value_id];
+        unsigned int cluster_size = slot;
+        if (cluster_size == 1) {
+            slot = -1;
+            continue;
+        }
+        slot = cursor;
+        cursor += cluster_size;
+        new_offsets.push_back(cursor);
+    }
+    new_positions.resize(cursor);
+
+    for (int position : cluster) {
+        int probing_table_value_id = probing_table[position];
+        if (probing_table_value_id == singleton_value_id_) continue;
+        int& slot = slots[probing_table_value_id];
+        if (slot >= 0) {
+            new_positions[slot++] = position;
+        }
+    }
+
+    for (int probing_table_value_id : touched) {
+        slots[probing_table_value_id] = 0;
+    }
+    touched.clear();
+}
+
+void PositionListIndex::ReserveProbeScratch(unsigned int max_value_id) {
+    std::vector<int>& slots = probe_scratch.slots;
+    if (slots.size() <= max_value_id) {
+        slots.resize(max_value_id + 1, 0);
+    }
+}
+
+std::unique_ptr<PositionListIndex> PositionListIndex::CreateFromClusters(
+    std::vector<int> positions, std::vector<unsigned int> offsets, unsigned int relation_size) {
+    double key_gap = 0.0;
+    double inv_ent = 0;
+    double gini_gap = 0;
+    unsigned long long nep = 0;
+    for (std::size_t i = 0; i + 1 < offsets.size(); ++i) {
+        unsigned int cluster_size = offsets[i + 1] - offsets[i];
+        key_gap += cluster_size * log(cluster_size);
+        nep += CalculateNep(cluster_size);
+        AccumulateImpurity(cluster_size, relation_size, inv_ent, gini_gap);
+    }
+    double entropy = log(relation_size) - key_gap / relation_size;
+    unsigned int size = positions.size();
+    double gini_impurity = FinishImpurity(size, relation_size, inv_ent, gini_gap);
+    SortClusters(positions, offsets);
+
+    return std::make_unique<PositionListIndex>(std::move(positions), std::move(offsets),
+                                               std::vector<int>(), size, entropy, nep,
+                                               relation_size, relation_size, inv_ent,
+                                               gini_impurity);
+}
+
+void PositionListIndex::AccumulateImpurity(unsigned int cluster_size, unsigned int relation_size,
+                                           double& inv_ent, double& gini_gap) {
+    double const share = cluster_size / static_cast<double>(relation_size);
+    inv_ent += -(1 - share) * std::log(1 - share);
+    gini_gap += std::pow(share, 2);
+}
+
+/* Adds the singleton clusters, which AccumulateImpurity does not see, and returns the Gini
+ * impurity, the same as CreateFor computes for a column */
+double PositionListIndex::FinishImpurity(unsigned int size, unsigned int relation_size,
+                                         double& inv_ent, double gini_gap) {
+    gini_gap += (relation_size - size) * std::pow(1 / static_cast<double>(relation_size), 2);
+    double gini_impurity = 1 - gini_gap;
+    if (gini_impurity == 0) {
+        inv_ent = 0;
+    }
+    return gini_impurity;
+}
+
+std::unique_ptr<PositionListIndex> PositionListIndex::ProbeDenseScratch(
+    std::vector<int> const& probing_table, unsigned int max_value_id) const {
+    assert(this->relation_size_ == probing_table.size());
+    std::vector<int> new_positions;
+    std::vector<unsigned int> new_offsets{0};
+
+    ReserveProbeScratch(max_value_id);
+    for (ClusterSpan cluster : GetClusters()) {
+        RefineCluster(cluster, probing_table, new_positions, new_offsets);
+    }
+
+    return CreateFromClusters(std::move(new_positions), std::move(new_offsets), relation_size_);
+}
+
+unsigned long long PositionListIndex::CountG1Violations(ClusterSpan cluster,
+                                                      std::vector<int> const& rhs_probing_table) {
+    std::vector<int>& slots = probe_scratch.slots;
+    std::vector<int>& touched = probe_scratch.touched;
+
+    for (int position : cluster) {
+        int probing_table_value_id = rhs_probing_table[position];
+        if (probing_table_value_id == singleton_value_id_) continue;
+        if (slots[probing_table_value_id]++ == 0) {
+            touched.push_back(probing_table_value_id);
+        }
+    }
+
+    // Pairs agreeing on the rhs are the pairs within its clusters, the others violate
+    unsigned long long num_violations = CalculateNep(cluster.size());
+    for (int probing_table_value_id : touched) {
+        num_violations -= CalculateNep(slots[probing_table_value_id]);
+        slots[probing_table_value_id] = 0;
+    }
+    touched.clear();
+    return num_violations;
+}
+
+unsigned long long PositionListIndex::GetG1Violations(
+    std::vector<PositionListIndex const*> const& probing_plis,
+    PositionListIndex const* rhs) const {
+    assert(this->relation_size_ == rhs->relation_size_);
+    std::shared_ptr<const std::vector<int>> rhs_probing_table = rhs->CalculateAndGetProbingTable();
+    std::vector<std::shared_ptr<const std::vector<int>>> probing_tables;
+    unsigned int max_value_id = rhs->GetNumNonSingletonCluster();
+    for (PositionListIndex const* probing_pli : probing_plis) {
+        probing_tables.push_back(probing_pli->CalculateAndGetProbingTable());
+        max_value_id = std::max(max_value_id, probing_pli->GetNumNonSingletonCluster());
+    }
+    ReserveProbeScratch(max_value_id);
+
+    // Parts of the cluster being refined by probing_tables[level], reused by all its clusters
+    std::vector<std::vector<int>> level_positions(probing_tables.size());
+    std::vector<std::vector<unsigned int>> level_offsets(probing_tables.size());
+    auto count_violations = [&](auto& self, ClusterSpan cluster,
+                                std::size_t level) -> unsigned long long {
+        if (level == probing_tables.size()) {
+            return CountG1Violations(cluster, *rhs_probing_table);
+        }
+        std::vector<int>& positions = level_positions[level];
+        std::vector<unsigned int>& offsets = level_offsets[level];
+        positions.clear();
+        offsets.assign(1, 0);
+        RefineCluster(cluster, *probing_tables[level], positions, offsets);
+        unsigned long long num_violations = 0;
+        for (std::size_t i = 0; i + 1 < offsets.size(); ++i) {
+            num_violations += self(self,
+                                   ClusterSpan(positions.data() + offsets[i],
+                                               positions.data() + offsets[i + 1]),
+                                   level + 1);
+        }
+        return num_violations;
+    };
+
+    unsigned long long num_violations = 0;
+    for (ClusterSpan cluster : GetClusters()) {
+        num_violations += count_violations(count_violations, cluster, 0);
+    }
+    return num_violations;
+}
+
+PositionListIndex::IntersectionStats PositionListIndex::GetIntersectionStats(
+    PositionListIndex const* that) const {
+    assert(this->relation_size_ == that->relation_size_);
+    auto [iterated, probed] = ChooseProbeOrder(this, that);
+    return iterated->ProbeStats(*probed->CalculateAndGetProbingTable(),
+                                probed->GetNumNonSingletonCluster());
+}
+
+PositionListIndex::IntersectionStats PositionListIndex::GetIntersectionStats(
+    std::vector<PositionListIndex const*> plis) {
+    assert(plis.size() >= 2);
+    // The smallest PLI is iterated, the most selective probing tables are applied first
+    std::sort(plis.begin(), plis.end(), [](PositionListIndex const* a, PositionListIndex const* b) {
+        return a->size_ < b->size_;
+    });
+    PositionListIndex const* base = plis.front();
+    std::vector<std::shared_ptr<const std::vector<int>>> probing_tables;
+    unsigned int max_value_id = 0;
+    for (auto it = std::next(plis.begin()); it != plis.end(); ++it) {
+        assert(base->relation_size_ == (*it)->relation_size_);
+        probing_tables.push_back((*it)->CalculateAndGetProbingTable());
+        max_value_id = std::max(max_value_id, (*it)->GetNumNonSingletonCluster());
+    }
+    ReserveProbeScratch(max_value_id);
+
+    IntersectionStats stats;
+    double key_gap = 0.0;
+    // Parts of the cluster being refined by probing_tables[level], reused by all its clusters.
+    // The last probing table only counts, so nothing is materialized
+    std::size_t const last_level = probing_tables.size() - 1;
+    std::vector<std::vector<int>> level_positions(last_level);
+    std::vector<std::vector<unsigned int>> level_offsets(last_level);
+    auto count_stats = [&](auto& self, ClusterSpan cluster, std::size_t level) -> void {
+        if (level == last_level) {
+            AccumulateStats(cluster, *probing_tables[level], stats, key_gap);
+            return;
+        }
+        std::vector<int>& positions = level_positions[level];
+        std::vector<unsigned int>& offsets = level_offsets[level];
+        positions.clear();
+        offsets.assign(1, 0);
+        RefineCluster(cluster, *probing_tables[level], positions, offsets);
+        for (std::size_t i = 0; i + 1 < offsets.size(); ++i) {
+            self(self,
+                 ClusterSpan(positions.data() + offsets[i], positions.data() + offsets[i + 1]),
+                 level + 1);
+        }
+    };
+    for (ClusterSpan cluster : base->GetClusters()) {
+        count_stats(count_stats, cluster, 0);
+    }
+
+    stats.entropy = log(base->relation_size_) - key_gap / base->relation_size_;
+    stats.num_clusters = stats.num_non_singleton_clusters + base->relation_size_ - stats.size;
+    return stats;
+}
+
+void PositionListIndex::AccumulateStats(ClusterSpan cluster, std::vector<int> const& probing_table,
+                                        IntersectionStats& stats, double& key_gap) {
+    std::vector<int>& slots = probe_scratch.slots;
+    std::vector<int>& touched = probe_scratch.touched;
+
+    for (int position : cluster) {
+        int probing_table_value_id = probing_table[position];
+        if (probing_table_value_id == singleton_value_id_) continue;
+        if (slots[probing_table_value_id]++ == 0) {
+            touched.push_back(probing_table_value_id);
+        }
+    }
+
+    for (int probing_table_value_id : touched) {
+        unsigned int cluster_size = slots[probing_table_value_id];
+        slots[probing_table_value_id] = 0;
+        if (cluster_size == 1) continue;
+
+        stats.num_non_singleton_clusters++;
+        stats.size += cluster_size;
+        key_gap += cluster_size * log(cluster_size);
+        stats.nep += CalculateNep(cluster_size);
+    }
+    touched.clear();
+}
+
+PositionListIndex::IntersectionStats PositionListIndex::ProbeStats(
+    std::vector<int> const& probing_table, unsigned int max_value_id) const {
+    assert(this->relation_size_ == probing_table.size());
+    IntersectionStats stats;
+    double key_gap = 0.0;
+
+    ReserveProbeScratch(max_value_id);
+    for (ClusterSpan cluster : GetClusters()) {
+        AccumulateStats(cluster, probing_table, stats, key_gap);
+    }
+
+    stats.entropy = log(relation_size_) - key_gap / relation_size_;
+    stats.num_clusters = stats.num_non_singleton_clusters + relation_size_ - stats.size;
+    return stats;
 }
 
 //TODO: null_cluster_ некорректен
-std::unique_ptr<PositionListIndex> PositionListIndex::Probe(std::shared_ptr<const std::vector<int>> probing_table) const {
-    assert(this->relation_size_ == probing_table->size());
-    std::deque<std::vector<int>> new_index;
+std::unique_ptr<PositionListIndex> PositionListIndex::ProbeHashing(
+    std::vector<int> const& probing_table) const {
+    assert(this->relation_size_ == probing_table.size());
+    std::vector<int> new_positions;
+    std::vector<unsigned int> new_offsets{0};
     unsigned int new_size = 0;
     double new_key_gap = 0.0;
+    double new_inv_ent = 0;
+    double new_gini_gap = 0;
     unsigned long long new_nep = 0;
     std::vector<int> null_cluster;
 
     std::unordered_map<int, std::vector<int>> partial_index;
 
-    for (auto& positions : index_) {
+    for (ClusterSpan positions : GetClusters()) {
         for (int position : positions) {
-            if (probing_table == nullptr) LOG(DEBUG) << "NULLPTR";
-            if (position < 0 || static_cast<size_t>(position) >= probing_table->size()) {
-                LOG(DEBUG) << "position: " + std::to_string(position) +
-                                 ", size: " + std::to_string(probing_table->size());
-                for (size_t i = 0; i < positions.size(); ++i) {
-                    LOG(DEBUG) << "Position " + std::to_string(positions[i]);
-                }
-            }
-            int probing_table_value_id = (*probing_table)[position];
+            int probing_table_value_id = probing_table[position];
             if (probing_table_value_id == singleton_value_id_)
                 continue;
-            intersection_count_++;
             partial_index[probing_table_value_id].push_back(position);
         }
 
@@ -175,81 +575,83 @@ std::unique_ptr<PositionListIndex> PositionListIndex::Probe(std::shared_ptr<cons
             new_size += cluster.size();
             new_key_gap += cluster.size() * log(cluster.size());
             new_nep += CalculateNep(cluster.size());
+            AccumulateImpurity(cluster.size(), relation_size_, new_inv_ent, new_gini_gap);
 
-            new_index.push_back(std::move(cluster));
+            new_positions.insert(new_positions.end(), cluster.begin(), cluster.end());
+            new_offsets.push_back(new_positions.size());
         }
         partial_index.clear();
     }
 
     double new_entropy = log(relation_size_) - new_key_gap / relation_size_;
-    SortClusters(new_index);
+    double new_gini_impurity =
+        FinishImpurity(new_size, relation_size_, new_inv_ent, new_gini_gap);
+    SortClusters(new_positions, new_offsets);
 
-    return std::make_unique<PositionListIndex>(std::move(new_index), std::move(null_cluster),
+    return std::make_unique<PositionListIndex>(std::move(new_positions), std::move(new_offsets),
+                                               std::move(null_cluster),
                                                new_size, new_entropy, new_nep, relation_size_,
-                                               relation_size_);
+                                               relation_size_, new_inv_ent, new_gini_impurity);
 }
 
-//TODO: null_cluster_ не поддерживается
 std::unique_ptr<PositionListIndex> PositionListIndex::ProbeAll(
-    Vertical const& probing_columns, ColumnLayoutRelationData& relation_data) {
+    Vertical const& probing_columns, ColumnLayoutRelationData const& relation_data) const {
     assert(this->relation_size_ == relation_data.GetNumRows());
-    std::deque<std::vector<int>> new_index;
-    unsigned int new_size = 0;
-    double new_key_gap = 0.0;
-    unsigned long long new_nep = 0;
-
-    std::map<std::vector<int>, std::vector<int>> partial_index;
-    std::vector<int> null_cluster;
-    std::vector<int> probe;
-
-    for (auto& cluster : this->index_) {
-        for (int position : cluster) {
-            if (!TakeProbe(position, relation_data, probing_columns, probe)) {
-                probe.clear();
-                continue;
-            }
-
-            partial_index[probe].push_back(position);
-            probe.clear();
-        }
-
-        for (auto& iter : partial_index) {
-            auto& new_cluster = iter.second;
-            if (new_cluster.size() == 1) continue;
-
-            new_size += new_cluster.size();
-            new_key_gap += new_cluster.size() * log(new_cluster.size());
-            new_nep += CalculateNep(new_cluster.size());
-
-            new_index.emplace_back(std::move(new_cluster));
-        }
-        partial_index.clear();
+    std::vector<PositionListIndex const*> probing_plis;
+    boost::dynamic_bitset<> probing_indices = probing_columns.GetColumnIndices();
+    for (std::size_t index = probing_indices.find_first(); index < probing_indices.size();
+         index = probing_indices.find_next(index)) {
+        probing_plis.push_back(relation_data.GetColumnData(index).GetPositionListIndex());
     }
-
-    double new_entropy = log(this->relation_size_) - new_key_gap / this->relation_size_;
-
-    SortClusters(new_index);
-
-    return std::make_unique<PositionListIndex>(std::move(new_index), std::move(null_cluster),
-                                               new_size, new_entropy, new_nep, this->relation_size_,
-                                               this->relation_size_);
+    return ProbeAll(std::move(probing_plis));
 }
 
-bool PositionListIndex::TakeProbe(int position, ColumnLayoutRelationData& relation_data,
-                                  Vertical const& probing_columns, std::vector<int>& probe) {
-    boost::dynamic_bitset<> probing_indices = probing_columns.GetColumnIndices();
-    for (unsigned long index = probing_indices.find_first(); index < probing_indices.size();
-         index = probing_indices.find_next(index)) {
-        int value = relation_data.GetColumnData(index).GetProbingTableValue(position);
-        if (value == PositionListIndex::singleton_value_id_) return false;
-        probe.push_back(value);
+//TODO: null_cluster_ не поддерживается
+std::unique_ptr<PositionListIndex> PositionListIndex::ProbeAll(
+    std::vector<PositionListIndex const*> probing_plis) const {
+    auto start_time = std::chrono::system_clock::now();
+    // Refining by the most selective PLIs first shrinks the working clusters fastest
+    std::sort(probing_plis.begin(), probing_plis.end(),
+              [](PositionListIndex const* a, PositionListIndex const* b) {
+                  return a->size_ < b->size_;
+              });
+
+    std::vector<int> positions = positions_;
+    std::vector<unsigned int> offsets = offsets_;
+    std::vector<int> new_positions;
+    std::vector<unsigned int> new_offsets;
+    new_positions.reserve(positions.size());
+    new_offsets.reserve(offsets.size());
+
+    for (PositionListIndex const* probing_pli : probing_plis) {
+        assert(this->relation_size_ == probing_pli->relation_size_);
+        if (positions.empty()) break;
+
+        std::shared_ptr<const std::vector<int>> probing_table =
+            probing_pli->CalculateAndGetProbingTable();
+        ReserveProbeScratch(probing_pli->GetNumNonSingletonCluster());
+        new_positions.clear();
+        new_offsets.assign(1, 0);
+        ClusterCollection clusters(positions.data(), offsets.data(), offsets.size() - 1);
+        for (ClusterSpan cluster : clusters) {
+            RefineCluster(cluster, *probing_table, new_positions, new_offsets);
+        }
+        positions.swap(new_positions);
+        offsets.swap(new_offsets);
+        intersection_count_++;
     }
-    return true;
+
+    std::unique_ptr<PositionListIndex> intersection =
+        CreateFromClusters(std::move(positions), std::move(offsets), relation_size_);
+    micros_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now() - start_time)
+                   .count();
+    return intersection;
 }
 
 std::string PositionListIndex::ToString() const {
     std::string res = "[";
-    for (auto& cluster : index_) {
+    for (ClusterSpan cluster : GetClusters()) {
         res.push_back('[');
         for (int v : cluster) {
             res.append(std::to_string(v) + ",");
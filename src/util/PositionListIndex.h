@@ -4,8 +4,11 @@
 //
 
 #pragma once
-#include <memory>
+#include <atomic>
+#include <cstddef>
 #include <deque>
+#include <iterator>
+#include <memory>
 #include <vector>
 
 #include "Column.h"
@@ -16,11 +19,126 @@ namespace util {
 
 class PositionListIndex {
 public:
+    /* Implementation of the probing step used by Intersect/Probe. Both produce identical PLIs */
+    enum class IntersectionMethod {
+        /* Groups the tuples of every cluster in a hash map keyed by probing table value */
+        kHashing,
+        /* Counts the tuples of every cluster in a thread-local array indexed by probing table
+         * value, resetting only the touched entries afterwards. Allocates only the result */
+        kDenseScratch
+    };
+
     /* Vector of tuple indices */
     using Cluster = std::vector<int>;
 
+    /* Properties of an intersection that can be obtained without materializing its clusters */
+    struct IntersectionStats {
+        unsigned int num_non_singleton_clusters = 0;
+        /* Number of tuples in non-singleton clusters */
+        unsigned int size = 0;
+        unsigned long long nep = 0;
+        double entropy = 0;
+        unsigned int num_clusters = 0;
+    };
+
+    /* Non-owning view of one cluster, i.e. a contiguous part of the positions array.
+     * Stays valid as long as the PLI it was taken from is alive */
+    class ClusterSpan {
+    private:
+        int const* begin_;
+        int const* end_;
+
+    public:
+        using value_type = int;
+        using const_iterator = int const*;
+        using iterator = const_iterator;
+
+        ClusterSpan(int const* begin, int const* end) noexcept : begin_(begin), end_(end) {}
+
+        int const* begin() const noexcept { return begin_; }
+        int const* end() const noexcept { return end_; }
+        int const* cbegin() const noexcept { return begin_; }
+        int const* cend() const noexcept { return end_; }
+        int const* data() const noexcept { return begin_; }
+        std::size_t size() const noexcept { return end_ - begin_; }
+        bool empty() const noexcept { return begin_ == end_; }
+        int operator[](std::size_t i) const noexcept { return begin_[i]; }
+        int front() const noexcept { return *begin_; }
+        int back() const noexcept { return *(end_ - 1); }
+
+        Cluster ToCluster() const { return Cluster(begin_, end_); }
+    };
+
+    /* Iterable collection of ClusterSpans over compressed sparse row storage:
+     * cluster i occupies positions [offsets[i], offsets[i + 1]) */
+    class ClusterCollection {
+    private:
+        int const* positions_;
+        unsigned int const* offsets_;
+        std::size_t size_;
+
+    public:
+        class ConstIterator {
+        private:
+            int const* positions_;
+            unsigned int const* offset_;
+
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = ClusterSpan;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = ClusterSpan;
+
+            ConstIterator(int const* positions, unsigned int const* offset) noexcept
+                : positions_(positions), offset_(offset) {}
+
+            ClusterSpan operator*() const noexcept {
+                return ClusterSpan(positions_ + offset_[0], positions_ + offset_[1]);
+            }
+            ConstIterator& operator++() noexcept {
+                ++offset_;
+                return *this;
+            }
+            ConstIterator operator++(int) noexcept {
+                ConstIterator old = *this;
+                ++offset_;
+                return old;
+            }
+            difference_type operator-(ConstIterator const& that) const noexcept {
+                return offset_ - that.offset_;
+            }
+            bool operator==(ConstIterator const& that) const noexcept {
+                return offset_ == that.offset_;
+            }
+            bool operator!=(ConstIterator const& that) const noexcept {
+                return offset_ != that.offset_;
+            }
+        };
+        using const_iterator = ConstIterator;
+        using iterator = ConstIterator;
+        using value_type = ClusterSpan;
+
+        ClusterCollection(int const* positions, unsigned int const* offsets,
+                          std::size_t size) noexcept
+            : positions_(positions), offsets_(offsets), size_(size) {}
+
+        ConstIterator begin() const noexcept { return ConstIterator(positions_, offsets_); }
+        ConstIterator end() const noexcept { return ConstIterator(positions_, offsets_ + size_); }
+        ConstIterator cbegin() const noexcept { return begin(); }
+        ConstIterator cend() const noexcept { return end(); }
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+        ClusterSpan operator[](std::size_t i) const noexcept {
+            return ClusterSpan(positions_ + offsets_[i], positions_ + offsets_[i + 1]);
+        }
+    };
+
 private:
-    std::deque<Cluster> index_;
+    /* Tuple indices of all non-singleton clusters, stored back to back */
+    std::vector<int> positions_;
+    /* Cluster boundaries in positions_, always holds GetNumNonSingletonCluster() + 1 elements */
+    std::vector<unsigned int> offsets_;
     Cluster null_cluster_;
     unsigned int size_;
     double entropy_;
@@ -30,23 +148,70 @@ private:
     unsigned int relation_size_;
     unsigned int original_relation_size_;
     std::shared_ptr<const std::vector<int>> probing_table_cache_;
-    unsigned int freq_ = 0;
+    /* Usage statistics of PLICache, updated concurrently */
+    std::atomic<unsigned int> freq_ = 0;
+    /* Tick of the cache clock at the last use of this PLI */
+    std::atomic<unsigned long long> last_use_ = 0;
 
     static unsigned long long CalculateNep(unsigned int num_elements) {
         return static_cast<unsigned long long>(num_elements) * (num_elements - 1) / 2;
     }
-    static void SortClusters(std::deque<Cluster>& clusters);
-    static bool TakeProbe(int position, ColumnLayoutRelationData& relation_data,
-                          Vertical const& probing_columns, std::vector<int>& probe);
+    /* Reorders clusters stored in positions/offsets so that they are sorted by their first
+     * element. Clusters are expected to be internally sorted */
+    static void SortClusters(std::vector<int>& positions, std::vector<unsigned int>& offsets);
+    std::unique_ptr<PositionListIndex> ProbeHashing(std::vector<int> const& probing_table) const;
+    std::unique_ptr<PositionListIndex> ProbeDenseScratch(std::vector<int> const& probing_table,
+                                                         unsigned int max_value_id) const;
+    std::unique_ptr<PositionListIndex> Probe(std::vector<int> const& probing_table,
+                                             unsigned int max_value_id) const;
+    IntersectionStats ProbeStats(std::vector<int> const& probing_table,
+                                 unsigned int max_value_id) const;
+    /* Chooses which of the two PLIs to iterate over and which to probe, preferring to probe a
+     * PLI whose probing table is already cached */
+    static std::pair<PositionListIndex const*, PositionListIndex const*> ChooseProbeOrder(
+        PositionListIndex const* first, PositionListIndex const* second);
+    /* Dense scratch kernel shared by the probing methods: splits one cluster by the values of
+     * probing_table and appends the resulting non-singleton clusters to positions/offsets.
+     * ReserveProbeScratch must have been called for the largest id in probing_table */
+    static void RefineCluster(ClusterSpan cluster, std::vector<int> const& probing_table,
+                              std::vector<int>& new_positions,
+                              std::vector<unsigned int>& new_offsets);
+    static void ReserveProbeScratch(unsigned int max_value_id);
+    /* Adds the parts of the cluster split by probing_table to the statistics, key_gap collects
+     * the sum of size * log(size) of the parts. ReserveProbeScratch must have been called for
+     * the largest id in probing_table */
+    static void AccumulateStats(ClusterSpan cluster, std::vector<int> const& probing_table,
+                                IntersectionStats& stats, double& key_gap);
+    /* Number of tuple pairs of the cluster that disagree on the values of rhs_probing_table.
+     * ReserveProbeScratch must have been called for the largest id in rhs_probing_table */
+    static unsigned long long CountG1Violations(ClusterSpan cluster,
+                                                std::vector<int> const& rhs_probing_table);
+    /* Add a non-singleton cluster to the sums behind the inverted entropy and the Gini impurity
+     * of a PLI */
+    static void AccumulateImpurity(unsigned int cluster_size, unsigned int relation_size,
+                                   double& inv_ent, double& gini_gap);
+    static double FinishImpurity(unsigned int size, unsigned int relation_size, double& inv_ent,
+                                 double gini_gap);
+    /* Computes the statistics of the given (unsorted) clusters and wraps them into a PLI */
+    static std::unique_ptr<PositionListIndex> CreateFromClusters(std::vector<int> positions,
+                                                                 std::vector<unsigned int> offsets,
+                                                                 unsigned int relation_size);
 
 public:
 
-    static int intersection_count_;
-    static unsigned long long micros_;
+    /* Number of performed intersections and total time spent in them */
+    static std::atomic<unsigned long long> intersection_count_;
+    static std::atomic<unsigned long long> micros_;
     static const int singleton_value_id_;
+    /* Selects the probing implementation, intended for benchmarking */
+    static IntersectionMethod intersection_method_;
+
+    static double GetIntersectionsPerSecond() {
+        return micros_ == 0 ? 0 : intersection_count_ * 1e6 / micros_;
+    }
 
-    PositionListIndex(std::deque<Cluster> index, Cluster null_cluster,
-                      unsigned int size, double entropy, unsigned long long nep,
+    PositionListIndex(std::vector<int> positions, std::vector<unsigned int> offsets,
+                      Cluster null_cluster, unsigned int size, double entropy, unsigned long long nep,
                       unsigned int relation_size, unsigned int original_relation_size,
                       double inverted_entropy = 0, double gini_impurity = 0);
     static std::unique_ptr<PositionListIndex> CreateFor(std::vector<int>& data,
@@ -64,13 +229,11 @@ public:
 
     // std::shared_ptr<const std::vector<int>> GetProbingTable(bool isCaching);
 
-    std::deque<Cluster> const& GetIndex() const noexcept {
-        return index_;
-    };
-    /* If you use this method and change index in any way, all other methods will become invalid */
-    std::deque<Cluster>& GetIndex() noexcept {
-        return index_;
+    ClusterCollection GetClusters() const noexcept {
+        return ClusterCollection(positions_.data(), offsets_.data(), offsets_.size() - 1);
     }
+    /* Copies the clusters into separately allocated vectors. Prefer GetClusters() */
+    std::deque<Cluster> GetIndex() const;
     double GetNep() const {
         return (double)nep_;
     }
@@ -78,13 +241,13 @@ public:
         return nep_;
     }
     unsigned int GetNumNonSingletonCluster() const {
-        return index_.size();
+        return offsets_.size() - 1;
     }
     unsigned int GetNumCluster() const {
-        return index_.size() + original_relation_size_ - size_;
+        return GetNumNonSingletonCluster() + original_relation_size_ - size_;
     }
     unsigned int GetFreq() const {
-        return freq_;
+        return freq_.load(std::memory_order_relaxed);
     }
     unsigned int GetSize() const {
         return size_;
@@ -105,12 +268,51 @@ public:
         return GetMaximumNip() - GetNepAsLong();
     }
 
-    void IncFreq() { freq_++; }
+    void IncFreq() { freq_.fetch_add(1, std::memory_order_relaxed); }
+    /* Counts a use of this PLI that happened at the given tick of a cache clock */
+    void Use(unsigned long long tick) {
+        IncFreq();
+        last_use_.store(tick, std::memory_order_relaxed);
+    }
+    unsigned long long GetLastUse() const { return last_use_.load(std::memory_order_relaxed); }
+    /* Halves the use frequency, so that PLIs that were popular long ago get colder */
+    void AgeFreq() { freq_.store(GetFreq() / 2, std::memory_order_relaxed); }
+    /* Approximate number of bytes taken by this PLI */
+    std::size_t GetMemoryUsage() const;
 
     std::unique_ptr<PositionListIndex> Intersect(PositionListIndex const* that) const;
+
+    /* Count-only intersection: compute properties of this ∩ that (or of an n-way intersection)
+     * without allocating the resulting clusters. The n-way version refines the clusters of the
+     * smallest PLI one at a time and never builds an intermediate PLI */
+    IntersectionStats GetIntersectionStats(PositionListIndex const* that) const;
+    static IntersectionStats GetIntersectionStats(std::vector<PositionListIndex const*> plis);
+    unsigned int GetIntersectionNumCluster(PositionListIndex const* that) const {
+        return GetIntersectionStats(that).num_clusters;
+    }
+    unsigned long long GetIntersectionNep(PositionListIndex const* that) const {
+        return GetIntersectionStats(that).nep;
+    }
+    double GetIntersectionEntropy(PositionListIndex const* that) const {
+        return GetIntersectionStats(that).entropy;
+    }
+    /* Number of tuple pairs violating this -> rhs, i.e. the numerator of the g1 error */
+    unsigned long long GetG1Violations(PositionListIndex const* rhs) const {
+        return GetG1Violations({}, rhs);
+    }
+    /* Number of tuple pairs violating (this ∩ probing_plis) -> rhs. Every cluster of this PLI is
+     * refined by the probing tables one after another and its parts are counted right away, so
+     * neither the intersection nor the intermediate PLIs are materialized */
+    unsigned long long GetG1Violations(std::vector<PositionListIndex const*> const& probing_plis,
+                                       PositionListIndex const* rhs) const;
     std::unique_ptr<PositionListIndex> Probe(std::shared_ptr<const std::vector<int>> probing_table) const;
-    std::unique_ptr<PositionListIndex> ProbeAll(Vertical const& probing_columns,
-                                                ColumnLayoutRelationData& relation_data);
+    /* N-ary intersection: refines this PLI by the probing tables of the given columns */
+    std::unique_ptr<PositionListIndex> ProbeAll(
+        Vertical const& probing_columns, ColumnLayoutRelationData const& relation_data) const;
+    /* N-ary intersection: refines this PLI by the probing tables of the given PLIs one after
+     * another, without materializing the intermediate PLIs */
+    std::unique_ptr<PositionListIndex> ProbeAll(
+        std::vector<PositionListIndex const*> probing_plis) const;
     std::string ToString() const;
 };
 
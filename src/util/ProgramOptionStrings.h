@@ -17,9 +17,14 @@ constexpr auto SeparatorLibArg = SEPARATOR ",s";
 constexpr auto HasHeader = "has_header";
 constexpr auto EqualNulls = "is_null_equal_null";
 constexpr auto Threads = "threads";
+constexpr auto SnapshotDirectory = "snapshot_dir";
 constexpr auto Error = "error";
 constexpr auto MaximumLhs = "max_lhs";
 constexpr auto Seed = "seed";
+constexpr auto PliIntersection = "pli_intersection";
+constexpr auto PliCacheLimit = "pli_cache_limit";
+constexpr auto PliCaching = "pli_caching";
+constexpr auto PliCachingValue = "pli_caching_value";
 constexpr auto MinimumSupport = "minsup";
 constexpr auto MinimumConfidence = "minconf";
 constexpr auto InputFormat = "input_format";
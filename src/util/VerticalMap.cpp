@@ -8,223 +8,356 @@
 namespace util {
 
 template <class Value>
-std::shared_ptr<Value> VerticalMap<Value>::SetTrie::Associate(Bitset const& key, size_t next_bit,
-                                                              std::shared_ptr<Value> value) {
-    next_bit = (next_bit == 0 ? key.find_first() : key.find_next(next_bit - 1));
-    if (next_bit == boost::dynamic_bitset<>::npos) {
-        std::swap(value, value_);
-        return value;
-    }
-    return GetOrCreateSubTrie(next_bit)->Associate(key, next_bit + 1, std::move(value));
+VerticalMap<Value>::SetTrie::SetTrie(size_t dimension) : dimension_(dimension) {
+    AllocateNode(0);
 }
 
 template <class Value>
-std::shared_ptr<Value const> VerticalMap<Value>::SetTrie::Get(Bitset const& key,
-                                                              size_t next_bit) const {
-    next_bit = (next_bit == 0 ? key.find_first() : key.find_next(next_bit - 1));
-    if (next_bit == boost::dynamic_bitset<>::npos) {
-        return value_;
+typename VerticalMap<Value>::SetTrie::NodeIndex VerticalMap<Value>::SetTrie::AllocateNode(
+    unsigned int column) {
+    Node node{ColumnSet(dimension_), nullptr, kNoNode, kNoNode, column};
+    if (free_nodes_.empty()) {
+        nodes_.push_back(std::move(node));
+        return nodes_.size() - 1;
     }
+    NodeIndex index = free_nodes_.back();
+    free_nodes_.pop_back();
+    nodes_[index] = std::move(node);
+    return index;
+}
 
-    auto subtrie = GetSubtrie(next_bit);
-    if (subtrie == nullptr) return nullptr;
-    return subtrie->Get(key, next_bit + 1);
+template <class Value>
+typename VerticalMap<Value>::SetTrie::NodeIndex VerticalMap<Value>::SetTrie::FindChild(
+    NodeIndex node, unsigned int column) const {
+    NodeIndex child = nodes_[node].first_child;
+    while (child != kNoNode && nodes_[child].column < column) {
+        child = nodes_[child].next_sibling;
+    }
+    return child != kNoNode && nodes_[child].column == column ? child : kNoNode;
 }
 
 template <class Value>
-std::shared_ptr<Value> VerticalMap<Value>::SetTrie::Remove(Bitset const& key, size_t next_bit) {
-    next_bit = (next_bit == 0 ? key.find_first() : key.find_next(next_bit - 1));
-    if (next_bit == Bitset::npos) {
-        auto removed_value = value_;
-        value_ = nullptr;
-        return removed_value;
+typename VerticalMap<Value>::SetTrie::NodeIndex VerticalMap<Value>::SetTrie::GetOrCreateChild(
+    NodeIndex node, unsigned int column) {
+    NodeIndex previous = kNoNode;
+    NodeIndex next = nodes_[node].first_child;
+    while (next != kNoNode && nodes_[next].column < column) {
+        previous = next;
+        next = nodes_[next].next_sibling;
+    }
+    if (next != kNoNode && nodes_[next].column == column) {
+        return next;
     }
 
-    auto subtrie = GetSubtrie(next_bit);
-    if (subtrie == nullptr) return nullptr;
-    auto removed_value = subtrie->Remove(key, next_bit + 1);
-    if (subtrie->IsEmpty()) {
-        subtries_[next_bit - offset_] = nullptr;
+    NodeIndex child = AllocateNode(column);
+    nodes_[child].next_sibling = next;
+    if (previous == kNoNode) {
+        nodes_[node].first_child = child;
+    } else {
+        nodes_[previous].next_sibling = child;
     }
+    return child;
+}
 
-    return removed_value;
+template <class Value>
+void VerticalMap<Value>::SetTrie::RemoveChild(NodeIndex parent, NodeIndex child) {
+    NodeIndex const next = nodes_[child].next_sibling;
+    if (nodes_[parent].first_child == child) {
+        nodes_[parent].first_child = next;
+    } else {
+        NodeIndex previous = nodes_[parent].first_child;
+        while (nodes_[previous].next_sibling != child) {
+            previous = nodes_[previous].next_sibling;
+        }
+        nodes_[previous].next_sibling = next;
+    }
+    nodes_[child] = Node();
+    free_nodes_.push_back(child);
 }
 
 template <class Value>
-bool VerticalMap<Value>::SetTrie::IsEmpty() const {
-    if (value_ == nullptr) return false;
-    return std::all_of(subtries_.begin(), subtries_.end(),
-                       [](auto& subtrie_ptr) { return subtrie_ptr == nullptr; });
+bool VerticalMap<Value>::SetTrie::UpdateDescendantColumns(NodeIndex node) {
+    ColumnSet descendant_columns(dimension_);
+    for (NodeIndex child = nodes_[node].first_child; child != kNoNode;
+         child = nodes_[child].next_sibling) {
+        descendant_columns |= nodes_[child].descendant_columns;
+        descendant_columns.set(nodes_[child].column);
+    }
+    if (descendant_columns == nodes_[node].descendant_columns) return false;
+    nodes_[node].descendant_columns = std::move(descendant_columns);
+    return true;
 }
 
 template <class Value>
-typename VerticalMap<Value>::SetTrie* VerticalMap<Value>::SetTrie::GetOrCreateSubTrie(
-    size_t index) {
-    if (subtries_.empty()) {
-        subtries_ = std::vector<std::unique_ptr<SetTrie>>(dimension_ - offset_);
+typename VerticalMap<Value>::SetTrie::NodeIndex VerticalMap<Value>::SetTrie::FindNode(
+    ColumnSet const& key) const {
+    NodeIndex node = kRoot;
+    for (size_t column = key.find_first(); column != ColumnSet::npos && node != kNoNode;
+         column = key.find_next(column)) {
+        node = FindChild(node, column);
     }
-    SetTrie* subtrie = GetSubtrie(index);
-    if (subtrie == nullptr) {
-        subtries_[index - offset_] = std::make_unique<SetTrie>(index + 1, dimension_);
+    return node;
+}
+
+template <class Value>
+std::shared_ptr<Value> VerticalMap<Value>::SetTrie::Associate(ColumnSet const& key,
+                                                              std::shared_ptr<Value> value) {
+    ColumnSet following_columns = key;
+    NodeIndex node = kRoot;
+    for (size_t column = key.find_first(); column != ColumnSet::npos;
+         column = key.find_next(column)) {
+        following_columns.reset(column);
+        node = GetOrCreateChild(node, column);
+        nodes_[node].descendant_columns |= following_columns;
     }
-    return subtries_[index - offset_].get();
+    std::swap(value, nodes_[node].value);
+    return value;
 }
 
 template <class Value>
-typename VerticalMap<Value>::SetTrie* VerticalMap<Value>::SetTrie::GetSubtrie(size_t index) {
-    return const_cast<VerticalMap<Value>::SetTrie*>(
-        (const_cast<VerticalMap<Value>::SetTrie const*>(this))->GetSubtrie(index));
+std::shared_ptr<Value const> VerticalMap<Value>::SetTrie::Get(ColumnSet const& key) const {
+    NodeIndex node = FindNode(key);
+    return node == kNoNode ? nullptr : nodes_[node].value;
 }
 
 template <class Value>
-typename VerticalMap<Value>::SetTrie const* VerticalMap<Value>::SetTrie::GetSubtrie(
-    size_t index) const {
-    if (subtries_.empty()) {
-        return nullptr;
+std::shared_ptr<Value> VerticalMap<Value>::SetTrie::Remove(ColumnSet const& key) {
+    std::vector<NodeIndex> path{kRoot};
+    for (size_t column = key.find_first(); column != ColumnSet::npos;
+         column = key.find_next(column)) {
+        NodeIndex child = FindChild(path.back(), column);
+        if (child == kNoNode) return nullptr;
+        path.push_back(child);
     }
-    if (index < offset_ || index >= dimension_) {
-        throw std::runtime_error("Error in GetSubtrie: index must be in [offset_; dimension_)");
+    std::shared_ptr<Value> removed_value = std::move(nodes_[path.back()].value);
+    nodes_[path.back()].value = nullptr;
+    if (removed_value == nullptr) return nullptr;
+
+    /* Ancestors need an update only while the nodes below them are dropped or change. The
+     * descendant columns of the root are never used */
+    bool is_changed = false;
+    for (size_t i = path.size() - 1; i > 0; --i) {
+        Node const& node = nodes_[path[i]];
+        if (node.value == nullptr && node.first_child == kNoNode) {
+            RemoveChild(path[i - 1], path[i]);
+        } else if (!is_changed) {
+            break;
+        }
+        is_changed = path[i - 1] != kRoot && UpdateDescendantColumns(path[i - 1]);
     }
-    return subtries_[index - offset_].get();
+    return removed_value;
 }
 
 template <class Value>
-void VerticalMap<Value>::SetTrie::TraverseEntries(
-    Bitset& subset_key,
-    std::function<void(Bitset const&, std::shared_ptr<Value const>)> collector) const {
-    if (value_ != nullptr) {
-        collector(Bitset(subset_key), value_);
-    }
-    for (size_t i = offset_; i < dimension_; i++) {
-        auto subtrie = GetSubtrie(i);
-        if (subtrie != nullptr) {
-            subset_key.set(i);
-            subtrie->TraverseEntries(subset_key, collector);
-            subset_key.reset(i);
-        }
+bool VerticalMap<Value>::SetTrie::TraverseEntries(NodeIndex node, ColumnSet& key,
+                                                  Collector const& collector) const {
+    if (nodes_[node].value != nullptr) {
+        if (!collector(key, nodes_[node].value)) return false;
+    }
+    for (NodeIndex child = nodes_[node].first_child; child != kNoNode;
+         child = nodes_[child].next_sibling) {
+        key.set(nodes_[child].column);
+        if (!TraverseEntries(child, key, collector)) return false;
+        key.reset(nodes_[child].column);
     }
+    return true;
 }
 
 template <class Value>
-bool VerticalMap<Value>::SetTrie::CollectSubsetKeys(
-    Bitset const& key, size_t next_bit, Bitset& subset_key,
-    std::function<bool(Bitset const&, std::shared_ptr<Value const>)> const& collector) const {
-    if (value_ != nullptr) {
-        if (!collector(Bitset(subset_key), value_)) return false;
-    }
+void VerticalMap<Value>::SetTrie::TraverseEntries(
+    std::function<void(ColumnSet const&, std::shared_ptr<Value const>)> const& collector) const {
+    ColumnSet key(dimension_);
+    TraverseEntries(kRoot, key, [&collector](ColumnSet const& k, std::shared_ptr<Value const> v) {
+        collector(k, std::move(v));
+        return true;
+    });
+}
 
-    for (next_bit = (next_bit == 0 ? key.find_first() : key.find_next(next_bit - 1));
-         next_bit != Bitset::npos;
-         next_bit = key.find_next(next_bit)) {
-        auto subtrie = GetSubtrie(next_bit);
-        if (subtrie != nullptr) {
-            subset_key.set(next_bit);
-            if (!subtrie->CollectSubsetKeys(key, next_bit + 1, subset_key, collector)) return false;
-            subset_key.reset(next_bit);
-        }
+template <class Value>
+bool VerticalMap<Value>::SetTrie::CollectSubsetKeys(NodeIndex node, ColumnSet const& key,
+                                                    ColumnSet& subset_key,
+                                                    Collector const& collector) const {
+    if (nodes_[node].value != nullptr) {
+        if (!collector(subset_key, nodes_[node].value)) return false;
+    }
+    for (NodeIndex child = nodes_[node].first_child; child != kNoNode;
+         child = nodes_[child].next_sibling) {
+        unsigned int const column = nodes_[child].column;
+        if (!key.test(column)) continue;
+        subset_key.set(column);
+        /* Every key in the subtree is a subset, no need to test the columns further */
+        bool const proceed = nodes_[child].descendant_columns.is_subset_of(key)
+                                 ? TraverseEntries(child, subset_key, collector)
+                                 : CollectSubsetKeys(child, key, subset_key, collector);
+        if (!proceed) return false;
+        subset_key.reset(column);
     }
     return true;
 }
 
 template <class Value>
-bool VerticalMap<Value>::SetTrie::CollectSupersetKeys(
-    Bitset const& key, size_t next_bit, Bitset& superset_key,
-    std::function<bool(Bitset const&, std::shared_ptr<Value const>)> const& collector) const {
-    if (next_bit != Bitset::npos) {
-        next_bit = (next_bit == 0 ? key.find_first() : key.find_next(next_bit - 1));
+bool VerticalMap<Value>::SetTrie::CollectSubsetKeys(ColumnSet const& key,
+                                                    Collector const& collector) const {
+    ColumnSet subset_key(dimension_);
+    return CollectSubsetKeys(kRoot, key, subset_key, collector);
+}
+
+template <class Value>
+bool VerticalMap<Value>::SetTrie::CollectSupersetKeys(NodeIndex node, ColumnSet& missing_columns,
+                                                      ColumnSet const* blacklist,
+                                                      ColumnSet& superset_key,
+                                                      Collector const& collector) const {
+    size_t const next_column = missing_columns.find_first();
+    if (next_column == ColumnSet::npos && nodes_[node].value != nullptr) {
+        if (!collector(superset_key, nodes_[node].value)) return false;
     }
-    if (next_bit == Bitset::npos) {
-        if (value_ != nullptr) {
-            if (!collector(Bitset(superset_key), value_)) return false;
-        }
-        for (size_t i = offset_; i < dimension_; i++) {
-            auto subtrie = GetSubtrie(i);
-            if (subtrie != nullptr) {
-                superset_key.set(i);
-                if (!subtrie->CollectSupersetKeys(key, next_bit, superset_key, collector))
-                    return false;
-                superset_key.reset(i);
-            }
+    /* Children are sorted, so the ones past the next missing column cannot lead to it */
+    for (NodeIndex child = nodes_[node].first_child;
+         child != kNoNode && nodes_[child].column <= next_column;
+         child = nodes_[child].next_sibling) {
+        unsigned int const column = nodes_[child].column;
+        if (blacklist != nullptr && blacklist->test(column)) continue;
+        bool const is_missing = column == next_column;
+        if (is_missing) {
+            missing_columns.reset(column);
         }
-    } else {
-        for (size_t i = offset_; i < next_bit; i++) {
-            auto subtrie = GetSubtrie(i);
-            if (subtrie != nullptr) {
-                superset_key.set(i);
-                if (!subtrie->CollectSupersetKeys(key, next_bit, superset_key, collector))
-                    return false;
-                superset_key.reset(i);
-            }
-        }
-
-        auto subtrie = GetSubtrie(next_bit);
-        if (subtrie != nullptr) {
-            superset_key.set(next_bit);
-            if (!subtrie->CollectSupersetKeys(key, next_bit + 1, superset_key, collector))
+        if (missing_columns.is_subset_of(nodes_[child].descendant_columns)) {
+            superset_key.set(column);
+            if (!CollectSupersetKeys(child, missing_columns, blacklist, superset_key, collector))
                 return false;
-            superset_key.reset(next_bit);
+            superset_key.reset(column);
+        }
+        if (is_missing) {
+            missing_columns.set(column);
         }
     }
     return true;
 }
 
 template <class Value>
-bool VerticalMap<Value>::SetTrie::CollectRestrictedSupersetKeys(
-    Bitset const& key, Bitset const& blacklist, size_t next_bit, Bitset& superset_key,
-    std::function<void(Bitset const&, std::shared_ptr<Value const>)> const& collector) const {
-    if (next_bit != Bitset::npos) {
-        next_bit = (next_bit == 0 ? key.find_first() : key.find_next(next_bit - 1));
-    }
-    if (next_bit == Bitset::npos) {
-        if (value_ != nullptr) {
-            collector(Bitset(superset_key), value_);
-        }
-        for (size_t i = offset_; i < dimension_; i++) {
-            if (blacklist.test(i)) continue;
-            auto subtrie = GetSubtrie(i);
-            if (subtrie != nullptr) {
-                superset_key.set(i);
-                if (!subtrie->CollectRestrictedSupersetKeys(key, blacklist, next_bit, superset_key,
-                                                            collector)) {
-                    return false;
-                }
-                superset_key.reset(i);
+bool VerticalMap<Value>::SetTrie::CollectSupersetKeys(ColumnSet const& key,
+                                                      Collector const& collector) const {
+    ColumnSet missing_columns = key;
+    ColumnSet superset_key(dimension_);
+    return CollectSupersetKeys(kRoot, missing_columns, nullptr, superset_key, collector);
+}
+
+template <class Value>
+void VerticalMap<Value>::SetTrie::CollectRestrictedSupersetKeys(
+    ColumnSet const& key, ColumnSet const& blacklist, Collector const& collector) const {
+    ColumnSet missing_columns = key;
+    ColumnSet superset_key(dimension_);
+    CollectSupersetKeys(kRoot, missing_columns, &blacklist, superset_key, collector);
+}
+
+template <class Value>
+VerticalMap<Value>::SetTrie::BatchSearch::BatchSearch(std::vector<ColumnSet const*> const& keys,
+                                                      BatchCollector const& collector,
+                                                      size_t dimension)
+    : keys(keys), collector(collector), done(keys.size()), path(dimension) {
+    alive.emplace_back(keys.size());
+    alive.front().set();
+}
+
+template <class Value>
+void VerticalMap<Value>::SetTrie::CollectSubsetKeys(NodeIndex node, size_t depth,
+                                                    BatchSearch& search) const {
+    if (nodes_[node].value != nullptr) {
+        boost::dynamic_bitset<> const& alive = search.alive[depth];
+        for (size_t query = alive.find_first(); query != alive.npos;
+             query = alive.find_next(query)) {
+            if (!search.done[query] &&
+                !search.collector(query, search.path, nodes_[node].value)) {
+                search.done.set(query);
             }
         }
-    } else {
-        for (size_t i = offset_; i < next_bit; i++) {
-            if (blacklist.test(i)) continue;
-            auto subtrie = GetSubtrie(i);
-            if (subtrie != nullptr) {
-                superset_key.set(i);
-                if (!subtrie->CollectRestrictedSupersetKeys(key, blacklist, next_bit, superset_key,
-                                                            collector)) {
-                    return false;
-                }
-                superset_key.reset(i);
-            }
+    }
+    if (search.alive.size() == depth + 1) {
+        search.alive.emplace_back(search.keys.size());
+    }
+    for (NodeIndex child = nodes_[node].first_child; child != kNoNode;
+         child = nodes_[child].next_sibling) {
+        unsigned int const column = nodes_[child].column;
+        boost::dynamic_bitset<>& child_alive = search.alive[depth + 1];
+        child_alive = search.alive[depth];
+        child_alive &= search.containing[column];
+        child_alive -= search.done;
+        if (child_alive.none()) continue;
+        search.path.set(column);
+        CollectSubsetKeys(child, depth + 1, search);
+        search.path.reset(column);
+    }
+}
+
+template <class Value>
+void VerticalMap<Value>::SetTrie::CollectSubsetKeys(std::vector<ColumnSet const*> const& keys,
+                                                    BatchCollector const& collector) const {
+    BatchSearch search(keys, collector, dimension_);
+    search.containing.assign(dimension_, boost::dynamic_bitset<>(keys.size()));
+    for (size_t query = 0; query < keys.size(); ++query) {
+        for (size_t column = keys[query]->find_first(); column != ColumnSet::npos;
+             column = keys[query]->find_next(column)) {
+            search.containing[column].set(query);
         }
+    }
+    CollectSubsetKeys(kRoot, 0, search);
+}
 
-        auto subtrie = GetSubtrie(next_bit);
-        if (subtrie != nullptr) {
-            superset_key.set(next_bit);
-            if (!subtrie->CollectRestrictedSupersetKeys(key, blacklist, next_bit + 1, superset_key,
-                                                        collector)) {
-                return false;
+template <class Value>
+void VerticalMap<Value>::SetTrie::CollectSupersetKeys(NodeIndex node, size_t depth,
+                                                      BatchSearch& search) const {
+    if (nodes_[node].value != nullptr) {
+        boost::dynamic_bitset<> const& alive = search.alive[depth];
+        for (size_t query = alive.find_first(); query != alive.npos;
+             query = alive.find_next(query)) {
+            if (!search.done[query] && search.keys[query]->is_subset_of(search.path) &&
+                !search.collector(query, search.path, nodes_[node].value)) {
+                search.done.set(query);
             }
-            superset_key.reset(next_bit);
         }
     }
-    return true;
+    if (search.alive.size() == depth + 1) {
+        search.alive.emplace_back(search.keys.size());
+    }
+    /* A key may lead into the subtree of a child only if the columns on the way to it and below
+     * it cover the key, which also means that no column of the key is skipped */
+    ColumnSet reachable_columns(dimension_);
+    for (NodeIndex child = nodes_[node].first_child; child != kNoNode;
+         child = nodes_[child].next_sibling) {
+        unsigned int const column = nodes_[child].column;
+        reachable_columns = search.path;
+        reachable_columns.set(column);
+        reachable_columns |= nodes_[child].descendant_columns;
+
+        boost::dynamic_bitset<> const& alive = search.alive[depth];
+        boost::dynamic_bitset<>& child_alive = search.alive[depth + 1];
+        child_alive.reset();
+        for (size_t query = alive.find_first(); query != alive.npos;
+             query = alive.find_next(query)) {
+            if (!search.done[query] && search.keys[query]->is_subset_of(reachable_columns)) {
+                child_alive.set(query);
+            }
+        }
+        if (child_alive.none()) continue;
+        search.path.set(column);
+        CollectSupersetKeys(child, depth + 1, search);
+        search.path.reset(column);
+    }
+}
+
+template <class Value>
+void VerticalMap<Value>::SetTrie::CollectSupersetKeys(std::vector<ColumnSet const*> const& keys,
+                                                      BatchCollector const& collector) const {
+    BatchSearch search(keys, collector, dimension_);
+    CollectSupersetKeys(kRoot, 0, search);
 }
 
 template<class Value>
 std::vector<Vertical> VerticalMap<Value>::GetSubsetKeys(Vertical const& vertical) const {
     std::vector<Vertical> subset_keys;
-    Bitset subset_key(relation_->GetNumColumns());
-    set_trie_.CollectSubsetKeys(vertical.GetColumnIndices(), 0, subset_key,
+    set_trie_.CollectSubsetKeys(vertical.GetColumnSet(),
                                 [&subset_keys, this](auto& indices, [[maybe_unused]] auto value) {
-                                    subset_keys.push_back(relation_->GetVertical(indices));
+                                    subset_keys.push_back(Vertical(relation_, indices));
                                     return true;
                                 });
     return subset_keys;
@@ -234,10 +367,9 @@ template <class Value>
 std::vector<typename VerticalMap<Value>::Entry> VerticalMap<Value>::GetSubsetEntries(
     const Vertical& vertical) const {
     std::vector<typename VerticalMap<Value>::Entry> entries;
-    Bitset subset_key(relation_->GetNumColumns());
-    set_trie_.CollectSubsetKeys(vertical.GetColumnIndices(), 0, subset_key,
+    set_trie_.CollectSubsetKeys(vertical.GetColumnSet(),
                                 [&entries, this](auto& indices, auto value) {
-                                    entries.emplace_back(relation_->GetVertical(indices), value);
+                                    entries.emplace_back(Vertical(relation_, indices), value);
                                     return true;
                                 });
     return entries;
@@ -247,10 +379,9 @@ std::vector<typename VerticalMap<Value>::Entry> VerticalMap<Value>::GetSubsetEnt
 template<class Value>
 typename VerticalMap<Value>::Entry VerticalMap<Value>::GetAnySubsetEntry(Vertical const& vertical) const {
     typename VerticalMap<Value>::Entry entry;
-    Bitset subset_key(relation_->GetNumColumns());
-    set_trie_.CollectSubsetKeys(vertical.GetColumnIndices(), 0, subset_key,
+    set_trie_.CollectSubsetKeys(vertical.GetColumnSet(),
                                 [&entry, this](auto& indices, auto value) {
-                                    entry = {relation_->GetVertical(indices), value};
+                                    entry = {Vertical(relation_, indices), value};
                                     return false;
                                 });
     return entry;
@@ -261,10 +392,9 @@ typename VerticalMap<Value>::Entry VerticalMap<Value>::GetAnySubsetEntry(
     const Vertical& vertical,
     std::function<bool(Vertical const*, std::shared_ptr<Value const>)> const& condition) const {
     typename VerticalMap<Value>::Entry entry;
-    Bitset subset_key(relation_->GetNumColumns());
-    set_trie_.CollectSubsetKeys(vertical.GetColumnIndices(), 0, subset_key,
+    set_trie_.CollectSubsetKeys(vertical.GetColumnSet(),
                                 [&entry, this, &condition](auto& indices, auto value) {
-                                    auto kv = relation_->GetVertical(indices);
+                                    auto kv = Vertical(relation_, indices);
                                     if (condition(&kv, value)) {
                                         entry = {kv, value};
                                         return false;
@@ -279,10 +409,9 @@ template <class Value>
 std::vector<typename VerticalMap<Value>::Entry> VerticalMap<Value>::GetSupersetEntries(
     Vertical const& vertical) const {
     std::vector<typename VerticalMap<Value>::Entry> entries;
-    Bitset superset_key(relation_->GetNumColumns());
-    set_trie_.CollectSupersetKeys(vertical.GetColumnIndices(), 0, superset_key,
+    set_trie_.CollectSupersetKeys(vertical.GetColumnSet(),
                                   [&entries, this](auto& indices, auto value) {
-                                      entries.emplace_back(relation_->GetVertical(indices), value);
+                                      entries.emplace_back(Vertical(relation_, indices), value);
                                       return true;
                                   });
     return entries;
@@ -292,10 +421,9 @@ template <class Value>
 typename VerticalMap<Value>::Entry VerticalMap<Value>::GetAnySupersetEntry(
     Vertical const& vertical) const {
     typename VerticalMap<Value>::Entry entry;
-    Bitset superset_key(relation_->GetNumColumns());
-    set_trie_.CollectSupersetKeys(vertical.GetColumnIndices(), 0, superset_key,
+    set_trie_.CollectSupersetKeys(vertical.GetColumnSet(),
                                   [&entry, this](auto& indices, auto value) {
-                                      entry = {relation_->GetVertical(indices), value};
+                                      entry = {Vertical(relation_, indices), value};
                                       return false;
                                   });
     return entry;
@@ -306,10 +434,9 @@ typename VerticalMap<Value>::Entry VerticalMap<Value>::GetAnySupersetEntry(
     Vertical const& vertical,
     std::function<bool(Vertical const*, std::shared_ptr<Value const>)> condition) const {
     typename VerticalMap<Value>::Entry entry;
-    Bitset superset_key(relation_->GetNumColumns());
-    set_trie_.CollectSupersetKeys(vertical.GetColumnIndices(), 0, superset_key,
+    set_trie_.CollectSupersetKeys(vertical.GetColumnSet(),
                                   [&entry, this, &condition](auto& indices, auto value) {
-                                      auto kv = relation_->GetVertical(indices);
+                                      auto kv = Vertical(relation_, indices);
                                       if (condition(&kv, value)) {
                                           entry = {kv, value};
                                           return false;
@@ -323,22 +450,99 @@ typename VerticalMap<Value>::Entry VerticalMap<Value>::GetAnySupersetEntry(
 template <class Value>
 std::vector<typename VerticalMap<Value>::Entry> VerticalMap<Value>::GetRestrictedSupersetEntries(
     Vertical const& vertical, Vertical const& exclusion) const {
-    if (vertical.GetColumnIndices().intersects(exclusion.GetColumnIndices()))
+    if (vertical.Intersects(exclusion))
         throw std::runtime_error(
             "Error in GetRestrictedSupersetEntries: a vertical shouldn't intersect with a "
             "restriction");
 
     std::vector<typename VerticalMap<Value>::Entry> entries;
-    Bitset superset_key(relation_->GetNumColumns());
     set_trie_.CollectRestrictedSupersetKeys(
-        vertical.GetColumnIndices(), exclusion.GetColumnIndices(), 0, superset_key,
+        vertical.GetColumnSet(), exclusion.GetColumnSet(),
         [&entries, this](auto& indices, auto value) {
-            entries.emplace_back(relation_->GetVertical(indices), value);
+            entries.emplace_back(Vertical(relation_, indices), value);
             return true;
         });
     return entries;
 }
 
+template <class Value>
+std::vector<ColumnSet const*> VerticalMap<Value>::GetKeys(std::vector<Vertical> const& verticals) {
+    std::vector<ColumnSet const*> keys;
+    keys.reserve(verticals.size());
+    for (Vertical const& vertical : verticals) {
+        keys.push_back(&vertical.GetColumnSet());
+    }
+    return keys;
+}
+
+template <class Value>
+std::vector<std::vector<typename VerticalMap<Value>::Entry>> VerticalMap<Value>::GetSubsetEntries(
+    std::vector<Vertical> const& verticals) const {
+    std::vector<std::vector<Entry>> entries(verticals.size());
+    set_trie_.CollectSubsetKeys(GetKeys(verticals),
+                                [&entries, this](size_t index, auto& indices, auto value) {
+                                    entries[index].emplace_back(Vertical(relation_, indices),
+                                                                value);
+                                    return true;
+                                });
+    return entries;
+}
+
+template <class Value>
+std::vector<typename VerticalMap<Value>::Entry> VerticalMap<Value>::GetAnySubsetEntries(
+    std::vector<Vertical> const& verticals) const {
+    std::vector<Entry> entries(verticals.size());
+    set_trie_.CollectSubsetKeys(GetKeys(verticals),
+                                [&entries, this](size_t index, auto& indices, auto value) {
+                                    entries[index] = {Vertical(relation_, indices), value};
+                                    return false;
+                                });
+    return entries;
+}
+
+template <class Value>
+std::vector<typename VerticalMap<Value>::Entry> VerticalMap<Value>::GetAnySubsetEntries(
+    std::vector<Vertical> const& verticals,
+    std::function<bool(Vertical const*, std::shared_ptr<Value const>)> const& condition) const {
+    std::vector<Entry> entries(verticals.size());
+    set_trie_.CollectSubsetKeys(
+        GetKeys(verticals), [&entries, this, &condition](size_t index, auto& indices, auto value) {
+            auto kv = Vertical(relation_, indices);
+            if (condition(&kv, value)) {
+                entries[index] = {kv, value};
+                return false;
+            } else {
+                return true;
+            }
+        });
+    return entries;
+}
+
+template <class Value>
+std::vector<std::vector<typename VerticalMap<Value>::Entry>>
+VerticalMap<Value>::GetSupersetEntries(std::vector<Vertical> const& verticals) const {
+    std::vector<std::vector<Entry>> entries(verticals.size());
+    set_trie_.CollectSupersetKeys(GetKeys(verticals),
+                                  [&entries, this](size_t index, auto& indices, auto value) {
+                                      entries[index].emplace_back(Vertical(relation_, indices),
+                                                                  value);
+                                      return true;
+                                  });
+    return entries;
+}
+
+template <class Value>
+std::vector<typename VerticalMap<Value>::Entry> VerticalMap<Value>::GetAnySupersetEntries(
+    std::vector<Vertical> const& verticals) const {
+    std::vector<Entry> entries(verticals.size());
+    set_trie_.CollectSupersetKeys(GetKeys(verticals),
+                                  [&entries, this](size_t index, auto& indices, auto value) {
+                                      entries[index] = {Vertical(relation_, indices), value};
+                                      return false;
+                                  });
+    return entries;
+}
+
 template<class Value>
 bool VerticalMap<Value>::RemoveSupersetEntries(Vertical const& key) {
     std::vector<typename VerticalMap<Value>::Entry> superset_entries = GetSupersetEntries(key);
@@ -360,9 +564,8 @@ bool VerticalMap<Value>::RemoveSubsetEntries(Vertical const& key) {
 template<class Value>
 std::unordered_set<Vertical> VerticalMap<Value>::KeySet() {
     std::unordered_set<Vertical> key_set;
-    Bitset subset_key(relation_->GetNumColumns());
-    set_trie_.TraverseEntries(subset_key, [&key_set, this](auto& k, [[maybe_unused]] auto v) {
-        key_set.insert(relation_->GetVertical(k));
+    set_trie_.TraverseEntries([&key_set, this](auto& k, [[maybe_unused]] auto v) {
+        key_set.insert(Vertical(relation_, k));
     });
     return key_set;
 }
@@ -370,18 +573,16 @@ std::unordered_set<Vertical> VerticalMap<Value>::KeySet() {
 template<class Value>
 std::vector<std::shared_ptr<Value const>> VerticalMap<Value>::Values() {
     std::vector<std::shared_ptr<Value const>> values;
-    Bitset subset_key(relation_->GetNumColumns());
     set_trie_.TraverseEntries(
-        subset_key, [&values]([[maybe_unused]] auto& k, auto v) -> void { values.push_back(v); });
+        [&values]([[maybe_unused]] auto& k, auto v) -> void { values.push_back(v); });
     return values;
 }
 
 template<class Value>
 std::unordered_set<typename VerticalMap<Value>::Entry> VerticalMap<Value>::EntrySet() {
     std::unordered_set<typename VerticalMap<Value>::Entry> entry_set;
-    Bitset subset_key(relation_->GetNumColumns());
-    set_trie_.TraverseEntries(subset_key, [&entry_set, this](auto& k, auto v) -> void {
-        entry_set.emplace(relation_->GetVertical(k), v);
+    set_trie_.TraverseEntries([&entry_set, this](auto& k, auto v) -> void {
+        entry_set.emplace(Vertical(relation_, k), v);
     });
     return entry_set;
 }
@@ -394,19 +595,20 @@ unsigned int VerticalMap<Value>::RemoveFromUsageCounter(
 
 template <class Value>
 std::shared_ptr<Value> VerticalMap<Value>::Remove(Vertical const& key) {
-    auto removed_value = set_trie_.Remove(key.GetColumnIndices(), 0);
+    auto removed_value = set_trie_.Remove(key.GetColumnSet());
     if (removed_value != nullptr) size_--;
     return removed_value;
 }
 
 template <class Value>
 std::shared_ptr<Value> VerticalMap<Value>::Remove(const VerticalMap::Bitset& key) {
-    auto removed_value = set_trie_.Remove(key, 0);
+    auto removed_value = set_trie_.Remove(ColumnSet(key));
     if (removed_value != nullptr) size_--;
     return removed_value;
 }
 
 //comparator is of Compare type - check ascending/descending issues
+//both Shrink methods work through the virtual interface, so that they suit the derived maps
 template <class Value>
 void VerticalMap<Value>::Shrink(double factor, std::function<bool(Entry, Entry)> const& compare,
                                 std::function<bool(Entry)> const& can_remove,
@@ -414,16 +616,15 @@ void VerticalMap<Value>::Shrink(double factor, std::function<bool(Entry, Entry)>
     //some logging
 
     std::priority_queue<Entry, std::vector<Entry>, std::function<bool(Entry, Entry)>> key_queue(
-        compare, std::vector<Entry>(size_));
-    Bitset subset_key(relation_->GetNumColumns());
-    set_trie_.TraverseEntries(subset_key, [&key_queue, this, &can_remove](auto& k, auto v) {
-        if (Entry entry(relation_->GetVertical(k), v); can_remove(entry)) {
+        compare);
+    for (Entry const& entry : EntrySet()) {
+        if (can_remove(entry)) {
             key_queue.push(entry);
         }
-    });
+    }
     unsigned int num_of_removed = 0;
-    unsigned int target_size = size_ * factor;
-    while (!key_queue.empty() && size_ > target_size) {
+    unsigned int target_size = GetSize() * factor;
+    while (!key_queue.empty() && GetSize() > target_size) {
         auto key = key_queue.top().first;
         key_queue.pop();
 
@@ -453,15 +654,11 @@ void VerticalMap<Value>::Shrink(std::unordered_map<Vertical, unsigned int>& usag
                                        : usage_counters[usage_counters.size() / 2];
 
     std::queue<Entry> key_queue;
-    Bitset subset_key(relation_->GetNumColumns());
-    set_trie_.TraverseEntries(
-        subset_key,
-        [&key_queue, this, &can_remove, &usage_counter, median_of_usage](auto& k, auto v) -> void {
-            if (Entry entry(relation_->GetVertical(k), v);
-                can_remove(entry) && usage_counter.at(entry.first) <= median_of_usage) {
-                key_queue.push(entry);
-            }
-        });
+    for (Entry const& entry : EntrySet()) {
+        if (can_remove(entry) && usage_counter.at(entry.first) <= median_of_usage) {
+            key_queue.push(entry);
+        }
+    }
     unsigned int num_of_removed = 0;
     while (!key_queue.empty()) {
         auto key = key_queue.front().first;
@@ -485,7 +682,7 @@ void VerticalMap<Value>::Shrink(std::unordered_map<Vertical, unsigned int>& usag
 
 template <class Value>
 std::shared_ptr<Value> VerticalMap<Value>::Put(Vertical const& key, std::shared_ptr<Value> value) {
-    auto old_value = set_trie_.Associate(key.GetColumnIndices(), 0, std::move(value));
+    auto old_value = set_trie_.Associate(key.GetColumnSet(), std::move(value));
     if (old_value == nullptr) size_++;
 
     return old_value;
@@ -493,19 +690,19 @@ std::shared_ptr<Value> VerticalMap<Value>::Put(Vertical const& key, std::shared_
 
 template <class Value>
 std::shared_ptr<Value const> VerticalMap<Value>::Get(Vertical const& key) const {
-    return set_trie_.Get(key.GetColumnIndices(), 0);
+    return set_trie_.Get(key.GetColumnSet());
     ;
 }
 
 template <class Value>
 std::shared_ptr<Value> VerticalMap<Value>::Get(Vertical const& key) {
-    return std::const_pointer_cast<Value>(set_trie_.Get(key.GetColumnIndices(), 0));
+    return std::const_pointer_cast<Value>(set_trie_.Get(key.GetColumnSet()));
     ;
 }
 
 template <class Value>
 std::shared_ptr<Value const> VerticalMap<Value>::Get(Bitset const& key) const {
-    return set_trie_.Get(key, 0);
+    return set_trie_.Get(ColumnSet(key));
     ;
 }
 
@@ -650,6 +847,42 @@ BlockingVerticalMap<V>::GetRestrictedSupersetEntries(const Vertical& vertical,
     return VerticalMap<V>::GetRestrictedSupersetEntries(vertical, exclusion);
 }
 
+template <class V>
+std::vector<std::vector<typename BlockingVerticalMap<V>::Entry>>
+BlockingVerticalMap<V>::GetSubsetEntries(std::vector<Vertical> const& verticals) const {
+    std::shared_lock read_lock(read_write_mutex_);
+    return VerticalMap<V>::GetSubsetEntries(verticals);
+}
+
+template <class V>
+std::vector<typename BlockingVerticalMap<V>::Entry> BlockingVerticalMap<V>::GetAnySubsetEntries(
+    std::vector<Vertical> const& verticals) const {
+    std::shared_lock read_lock(read_write_mutex_);
+    return VerticalMap<V>::GetAnySubsetEntries(verticals);
+}
+
+template <class V>
+std::vector<typename BlockingVerticalMap<V>::Entry> BlockingVerticalMap<V>::GetAnySubsetEntries(
+    std::vector<Vertical> const& verticals,
+    std::function<bool(Vertical const*, std::shared_ptr<V const>)> const& condition) const {
+    std::shared_lock read_lock(read_write_mutex_);
+    return VerticalMap<V>::GetAnySubsetEntries(verticals, condition);
+}
+
+template <class V>
+std::vector<std::vector<typename BlockingVerticalMap<V>::Entry>>
+BlockingVerticalMap<V>::GetSupersetEntries(std::vector<Vertical> const& verticals) const {
+    std::shared_lock read_lock(read_write_mutex_);
+    return VerticalMap<V>::GetSupersetEntries(verticals);
+}
+
+template <class V>
+std::vector<typename BlockingVerticalMap<V>::Entry> BlockingVerticalMap<V>::GetAnySupersetEntries(
+    std::vector<Vertical> const& verticals) const {
+    std::shared_lock read_lock(read_write_mutex_);
+    return VerticalMap<V>::GetAnySupersetEntries(verticals);
+}
+
 template <class V>
 bool BlockingVerticalMap<V>::RemoveSupersetEntries(const Vertical& key) {
     std::scoped_lock write_lock(read_write_mutex_);
@@ -662,18 +895,17 @@ bool BlockingVerticalMap<V>::RemoveSubsetEntries(const Vertical& key) {
     return VerticalMap<V>::RemoveSubsetEntries(key);
 }
 
+// Shrink goes through the locking EntrySet() and Remove(), holding the lock here would deadlock
 template <class V>
 void BlockingVerticalMap<V>::Shrink(double factor, const std::function<bool(Entry, Entry)>& compare,
                                     const std::function<bool(Entry)>& can_remove,
                                     ProfilingContext::ObjectToCache cache_object) {
-    std::scoped_lock write_lock(read_write_mutex_);
     VerticalMap<V>::Shrink(factor, compare, can_remove, cache_object);
 }
 
 template <class V>
 void BlockingVerticalMap<V>::Shrink(std::unordered_map<Vertical, unsigned int>& usage_counter,
                                     const std::function<bool(Entry)>& can_remove) {
-    std::scoped_lock write_lock(read_write_mutex_);
     VerticalMap<V>::Shrink(usage_counter, can_remove);
 }
 
@@ -699,5 +931,379 @@ template class BlockingVerticalMap<VerticalInfo>;
 
 template class BlockingVerticalMap<Vertical>;
 
+template <class V>
+ConcurrentVerticalMap<V>::ConcurrentVerticalMap(RelationalSchema const* relation)
+    : VerticalMap<V>(relation) {
+    for (size_t i = 0; i <= relation->GetNumColumns(); ++i) {
+        shards_.push_back(std::make_unique<Shard>(relation));
+    }
+}
+
+template <class V>
+typename ConcurrentVerticalMap<V>::Shard& ConcurrentVerticalMap<V>::GetShard(
+    ColumnSet const& key) const {
+    size_t const first_column = key.find_first();
+    return first_column == ColumnSet::npos ? *shards_.back() : *shards_[first_column];
+}
+
+// Visits the shards in the order VerticalMap visits the entries, so the first entry found is the
+// same
+template <class V>
+template <typename Action>
+void ConcurrentVerticalMap<V>::ForEachSubsetShard(ColumnSet const& key, Action action) const {
+    if (!action(*shards_.back())) return;
+    for (size_t column = key.find_first(); column != ColumnSet::npos;
+         column = key.find_next(column)) {
+        if (!action(*shards_[column])) return;
+    }
+}
+
+template <class V>
+template <typename Action>
+void ConcurrentVerticalMap<V>::ForEachSupersetShard(ColumnSet const& key, Action action) const {
+    size_t const first_column = key.find_first();
+    if (first_column == ColumnSet::npos && !action(*shards_.back())) return;
+    size_t const end = first_column == ColumnSet::npos ? shards_.size() - 1 : first_column + 1;
+    for (size_t column = 0; column < end; ++column) {
+        if (!action(*shards_[column])) return;
+    }
+}
+
+template <class V>
+template <typename IsPending, typename Action>
+void ConcurrentVerticalMap<V>::ForEachShardBatch(std::vector<Vertical> const& verticals,
+                                                 bool is_subset_search, IsPending is_pending,
+                                                 Action action) const {
+    std::vector<size_t> indices;
+    std::vector<Vertical> batch;
+    auto visit = [&verticals, &is_pending, &action, &indices, &batch](Shard& shard,
+                                                                      auto is_reachable) {
+        indices.clear();
+        batch.clear();
+        for (size_t i = 0; i < verticals.size(); ++i) {
+            if (is_pending(i) && is_reachable(verticals[i].GetColumnSet())) {
+                indices.push_back(i);
+                batch.push_back(verticals[i]);
+            }
+        }
+        if (!batch.empty()) action(shard, indices, batch);
+    };
+
+    visit(*shards_.back(),
+          [is_subset_search](ColumnSet const& key) { return is_subset_search || key.none(); });
+    for (size_t column = 0; column + 1 < shards_.size(); ++column) {
+        visit(*shards_[column], [is_subset_search, column](ColumnSet const& key) {
+            return is_subset_search ? key.test(column) : key.find_first() >= column;
+        });
+    }
+}
+
+template <class V>
+std::shared_ptr<V const> ConcurrentVerticalMap<V>::Get(Vertical const& key) const {
+    Shard& shard = GetShard(key.GetColumnSet());
+    std::shared_lock read_lock(shard.mutex);
+    return shard.map.Get(key);
+}
+
+template <class V>
+std::shared_ptr<V const> ConcurrentVerticalMap<V>::Get(Bitset const& key) const {
+    Shard& shard = GetShard(ColumnSet(key));
+    std::shared_lock read_lock(shard.mutex);
+    return shard.map.Get(key);
+}
+
+template <class V>
+std::shared_ptr<V> ConcurrentVerticalMap<V>::Get(Vertical const& key) {
+    Shard& shard = GetShard(key.GetColumnSet());
+    std::shared_lock read_lock(shard.mutex);
+    return shard.map.Get(key);
+}
+
+template <class V>
+std::shared_ptr<V> ConcurrentVerticalMap<V>::Put(Vertical const& key, std::shared_ptr<V> value) {
+    Shard& shard = GetShard(key.GetColumnSet());
+    std::scoped_lock write_lock(shard.mutex);
+    auto old_value = shard.map.Put(key, std::move(value));
+    if (old_value == nullptr) num_entries_++;
+    return old_value;
+}
+
+template <class V>
+std::shared_ptr<V> ConcurrentVerticalMap<V>::Remove(Vertical const& key) {
+    Shard& shard = GetShard(key.GetColumnSet());
+    std::scoped_lock write_lock(shard.mutex);
+    auto removed_value = shard.map.Remove(key);
+    if (removed_value != nullptr) num_entries_--;
+    return removed_value;
+}
+
+template <class V>
+std::shared_ptr<V> ConcurrentVerticalMap<V>::Remove(Bitset const& key) {
+    Shard& shard = GetShard(ColumnSet(key));
+    std::scoped_lock write_lock(shard.mutex);
+    auto removed_value = shard.map.Remove(key);
+    if (removed_value != nullptr) num_entries_--;
+    return removed_value;
+}
+
+template <class V>
+std::unordered_set<Vertical> ConcurrentVerticalMap<V>::KeySet() {
+    std::unordered_set<Vertical> key_set;
+    for (auto& shard : shards_) {
+        std::shared_lock read_lock(shard->mutex);
+        key_set.merge(shard->map.KeySet());
+    }
+    return key_set;
+}
+
+template <class V>
+std::vector<std::shared_ptr<V const>> ConcurrentVerticalMap<V>::Values() {
+    std::vector<std::shared_ptr<V const>> values;
+    for (auto& shard : shards_) {
+        std::shared_lock read_lock(shard->mutex);
+        auto shard_values = shard->map.Values();
+        values.insert(values.end(), shard_values.begin(), shard_values.end());
+    }
+    return values;
+}
+
+template <class V>
+std::unordered_set<typename ConcurrentVerticalMap<V>::Entry> ConcurrentVerticalMap<V>::EntrySet() {
+    std::unordered_set<Entry> entry_set;
+    for (auto& shard : shards_) {
+        std::shared_lock read_lock(shard->mutex);
+        entry_set.merge(shard->map.EntrySet());
+    }
+    return entry_set;
+}
+
+template <class V>
+std::vector<Vertical> ConcurrentVerticalMap<V>::GetSubsetKeys(Vertical const& vertical) const {
+    std::vector<Vertical> subset_keys;
+    ForEachSubsetShard(vertical.GetColumnSet(), [&subset_keys, &vertical](Shard& shard) {
+        std::shared_lock read_lock(shard.mutex);
+        auto shard_keys = shard.map.GetSubsetKeys(vertical);
+        subset_keys.insert(subset_keys.end(), shard_keys.begin(), shard_keys.end());
+        return true;
+    });
+    return subset_keys;
+}
+
+template <class V>
+std::vector<typename ConcurrentVerticalMap<V>::Entry> ConcurrentVerticalMap<V>::GetSubsetEntries(
+    Vertical const& vertical) const {
+    std::vector<Entry> entries;
+    ForEachSubsetShard(vertical.GetColumnSet(), [&entries, &vertical](Shard& shard) {
+        std::shared_lock read_lock(shard.mutex);
+        auto shard_entries = shard.map.GetSubsetEntries(vertical);
+        entries.insert(entries.end(), shard_entries.begin(), shard_entries.end());
+        return true;
+    });
+    return entries;
+}
+
+template <class V>
+typename ConcurrentVerticalMap<V>::Entry ConcurrentVerticalMap<V>::GetAnySubsetEntry(
+    Vertical const& vertical) const {
+    Entry entry;
+    ForEachSubsetShard(vertical.GetColumnSet(), [&entry, &vertical](Shard& shard) {
+        std::shared_lock read_lock(shard.mutex);
+        entry = shard.map.GetAnySubsetEntry(vertical);
+        return entry.second == nullptr;
+    });
+    return entry;
+}
+
+template <class V>
+typename ConcurrentVerticalMap<V>::Entry ConcurrentVerticalMap<V>::GetAnySubsetEntry(
+    Vertical const& vertical,
+    std::function<bool(Vertical const*, std::shared_ptr<V const>)> const& condition) const {
+    Entry entry;
+    ForEachSubsetShard(vertical.GetColumnSet(), [&entry, &vertical, &condition](Shard& shard) {
+        std::shared_lock read_lock(shard.mutex);
+        entry = shard.map.GetAnySubsetEntry(vertical, condition);
+        return entry.second == nullptr;
+    });
+    return entry;
+}
+
+template <class V>
+std::vector<typename ConcurrentVerticalMap<V>::Entry> ConcurrentVerticalMap<V>::GetSupersetEntries(
+    Vertical const& vertical) const {
+    std::vector<Entry> entries;
+    ForEachSupersetShard(vertical.GetColumnSet(), [&entries, &vertical](Shard& shard) {
+        std::shared_lock read_lock(shard.mutex);
+        auto shard_entries = shard.map.GetSupersetEntries(vertical);
+        entries.insert(entries.end(), shard_entries.begin(), shard_entries.end());
+        return true;
+    });
+    return entries;
+}
+
+template <class V>
+typename ConcurrentVerticalMap<V>::Entry ConcurrentVerticalMap<V>::GetAnySupersetEntry(
+    Vertical const& vertical) const {
+    Entry entry;
+    ForEachSupersetShard(vertical.GetColumnSet(), [&entry, &vertical](Shard& shard) {
+        std::shared_lock read_lock(shard.mutex);
+        entry = shard.map.GetAnySupersetEntry(vertical);
+        return entry.second == nullptr;
+    });
+    return entry;
+}
+
+template <class V>
+typename ConcurrentVerticalMap<V>::Entry ConcurrentVerticalMap<V>::GetAnySupersetEntry(
+    Vertical const& vertical,
+    std::function<bool(Vertical const*, std::shared_ptr<V const>)> condition) const {
+    Entry entry;
+    ForEachSupersetShard(vertical.GetColumnSet(), [&entry, &vertical, &condition](Shard& shard) {
+        std::shared_lock read_lock(shard.mutex);
+        entry = shard.map.GetAnySupersetEntry(vertical, condition);
+        return entry.second == nullptr;
+    });
+    return entry;
+}
+
+template <class V>
+std::vector<typename ConcurrentVerticalMap<V>::Entry>
+ConcurrentVerticalMap<V>::GetRestrictedSupersetEntries(Vertical const& vertical,
+                                                       Vertical const& exclusion) const {
+    if (vertical.Intersects(exclusion))
+        throw std::runtime_error(
+            "Error in GetRestrictedSupersetEntries: a vertical shouldn't intersect with a "
+            "restriction");
+
+    std::vector<Entry> entries;
+    ForEachSupersetShard(vertical.GetColumnSet(), [&entries, &vertical, &exclusion](Shard& shard) {
+        std::shared_lock read_lock(shard.mutex);
+        auto shard_entries = shard.map.GetRestrictedSupersetEntries(vertical, exclusion);
+        entries.insert(entries.end(), shard_entries.begin(), shard_entries.end());
+        return true;
+    });
+    return entries;
+}
+
+template <class V>
+std::vector<std::vector<typename ConcurrentVerticalMap<V>::Entry>>
+ConcurrentVerticalMap<V>::GetSubsetEntries(std::vector<Vertical> const& verticals) const {
+    std::vector<std::vector<Entry>> entries(verticals.size());
+    ForEachShardBatch(
+        verticals, true, []([[maybe_unused]] size_t i) { return true; },
+        [&entries](Shard& shard, auto const& indices, auto const& batch) {
+            std::shared_lock read_lock(shard.mutex);
+            auto shard_entries = shard.map.GetSubsetEntries(batch);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                auto& query_entries = entries[indices[i]];
+                query_entries.insert(query_entries.end(), shard_entries[i].begin(),
+                                     shard_entries[i].end());
+            }
+        });
+    return entries;
+}
+
+template <class V>
+std::vector<typename ConcurrentVerticalMap<V>::Entry> ConcurrentVerticalMap<V>::GetAnySubsetEntries(
+    std::vector<Vertical> const& verticals) const {
+    std::vector<Entry> entries(verticals.size());
+    ForEachShardBatch(
+        verticals, true, [&entries](size_t i) { return entries[i].second == nullptr; },
+        [&entries](Shard& shard, auto const& indices, auto const& batch) {
+            std::shared_lock read_lock(shard.mutex);
+            auto shard_entries = shard.map.GetAnySubsetEntries(batch);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                entries[indices[i]] = std::move(shard_entries[i]);
+            }
+        });
+    return entries;
+}
+
+template <class V>
+std::vector<typename ConcurrentVerticalMap<V>::Entry> ConcurrentVerticalMap<V>::GetAnySubsetEntries(
+    std::vector<Vertical> const& verticals,
+    std::function<bool(Vertical const*, std::shared_ptr<V const>)> const& condition) const {
+    std::vector<Entry> entries(verticals.size());
+    ForEachShardBatch(
+        verticals, true, [&entries](size_t i) { return entries[i].second == nullptr; },
+        [&entries, &condition](Shard& shard, auto const& indices, auto const& batch) {
+            std::shared_lock read_lock(shard.mutex);
+            auto shard_entries = shard.map.GetAnySubsetEntries(batch, condition);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                entries[indices[i]] = std::move(shard_entries[i]);
+            }
+        });
+    return entries;
+}
+
+template <class V>
+std::vector<std::vector<typename ConcurrentVerticalMap<V>::Entry>>
+ConcurrentVerticalMap<V>::GetSupersetEntries(std::vector<Vertical> const& verticals) const {
+    std::vector<std::vector<Entry>> entries(verticals.size());
+    ForEachShardBatch(
+        verticals, false, []([[maybe_unused]] size_t i) { return true; },
+        [&entries](Shard& shard, auto const& indices, auto const& batch) {
+            std::shared_lock read_lock(shard.mutex);
+            auto shard_entries = shard.map.GetSupersetEntries(batch);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                auto& query_entries = entries[indices[i]];
+                query_entries.insert(query_entries.end(), shard_entries[i].begin(),
+                                     shard_entries[i].end());
+            }
+        });
+    return entries;
+}
+
+template <class V>
+std::vector<typename ConcurrentVerticalMap<V>::Entry>
+ConcurrentVerticalMap<V>::GetAnySupersetEntries(std::vector<Vertical> const& verticals) const {
+    std::vector<Entry> entries(verticals.size());
+    ForEachShardBatch(
+        verticals, false, [&entries](size_t i) { return entries[i].second == nullptr; },
+        [&entries](Shard& shard, auto const& indices, auto const& batch) {
+            std::shared_lock read_lock(shard.mutex);
+            auto shard_entries = shard.map.GetAnySupersetEntries(batch);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                entries[indices[i]] = std::move(shard_entries[i]);
+            }
+        });
+    return entries;
+}
+
+template <class V>
+bool ConcurrentVerticalMap<V>::RemoveSupersetEntries(Vertical const& key) {
+    bool is_removed = false;
+    ForEachSupersetShard(key.GetColumnSet(), [this, &is_removed, &key](Shard& shard) {
+        std::scoped_lock write_lock(shard.mutex);
+        size_t const size = shard.map.GetSize();
+        is_removed |= shard.map.RemoveSupersetEntries(key);
+        num_entries_ -= size - shard.map.GetSize();
+        return true;
+    });
+    return is_removed;
+}
+
+template <class V>
+bool ConcurrentVerticalMap<V>::RemoveSubsetEntries(Vertical const& key) {
+    bool is_removed = false;
+    ForEachSubsetShard(key.GetColumnSet(), [this, &is_removed, &key](Shard& shard) {
+        std::scoped_lock write_lock(shard.mutex);
+        size_t const size = shard.map.GetSize();
+        is_removed |= shard.map.RemoveSubsetEntries(key);
+        num_entries_ -= size - shard.map.GetSize();
+        return true;
+    });
+    return is_removed;
+}
+
+template class ConcurrentVerticalMap<PositionListIndex>;
+
+template class ConcurrentVerticalMap<AgreeSetSample>;
+
+template class ConcurrentVerticalMap<DependencyCandidate>;
+
+template class ConcurrentVerticalMap<VerticalInfo>;
+
+template class ConcurrentVerticalMap<Vertical>;
+
 } // namespace util
 
@@ -1,5 +1,7 @@
 #pragma once
+#include <atomic>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <shared_mutex>
 #include <set>
@@ -9,6 +11,7 @@
 
 #include <boost/dynamic_bitset.hpp>
 
+#include "ColumnSet.h"
 #include "custom/CustomHashes.h"
 #include "ProfilingContext.h"
 
@@ -24,67 +27,113 @@ protected:
     using Bitset = boost::dynamic_bitset<>;
     //typename std::shared_ptr<Value> shared_ptr<Value>;
 
-    // Each node corresponds to a bit in a bitset. Each node also has a vector of the possible consequent set bits.
+    /* Set trie whose nodes live in one arena and refer to each other by index. A key is the path
+     * of its columns in increasing order, the children of a node form a list sorted by column.
+     * Every node keeps the union of the columns of the keys below it, so superset searches skip
+     * subtrees missing some column of the key with a few word operations */
     class SetTrie {
+    public:
+        using Collector = std::function<bool(ColumnSet const&, std::shared_ptr<Value const>)>;
+        // Takes the index of the query key an entry is found for, returns false if the query
+        // needs no more entries
+        using BatchCollector =
+            std::function<bool(size_t, ColumnSet const&, std::shared_ptr<Value const>)>;
+
     private:
-        size_t offset_;
-        size_t dimension_;
-        std::vector<std::unique_ptr<SetTrie>> subtries_; //unique_ptr?
-        std::shared_ptr<Value> value_;
+        using NodeIndex = unsigned int;
+        static constexpr NodeIndex kNoNode = std::numeric_limits<NodeIndex>::max();
+        static constexpr NodeIndex kRoot = 0;
+
+        struct Node {
+            /* Columns of the keys in the subtree of the node that follow its own column, not
+             * maintained for the root */
+            ColumnSet descendant_columns;
+            std::shared_ptr<Value> value;
+            NodeIndex first_child = kNoNode;
+            NodeIndex next_sibling = kNoNode;
+            unsigned int column = 0;
+        };
+
+        /* State of a search for many keys in one traversal. Sets of queries are bitsets indexed
+         * by the position of the key in keys */
+        struct BatchSearch {
+            std::vector<ColumnSet const*> const& keys;
+            BatchCollector const& collector;
+            /* Queries that need no more entries */
+            boost::dynamic_bitset<> done;
+            /* alive[d] are the queries that may match entries below the current node at depth d,
+             * reused by all the nodes of the depth */
+            std::vector<boost::dynamic_bitset<>> alive;
+            /* containing[i] are the queries with column i in the key, used by subset searches */
+            std::vector<boost::dynamic_bitset<>> containing;
+            ColumnSet path;
+
+            BatchSearch(std::vector<ColumnSet const*> const& keys, BatchCollector const& collector,
+                        size_t dimension);
+        };
 
-        bool IsEmpty() const;
+        size_t dimension_;
+        std::vector<Node> nodes_;
+        /* Indices of the removed nodes, reused by the next insertions */
+        std::vector<NodeIndex> free_nodes_;
+
+        NodeIndex AllocateNode(unsigned int column);
+        NodeIndex FindChild(NodeIndex node, unsigned int column) const;
+        NodeIndex GetOrCreateChild(NodeIndex node, unsigned int column);
+        /* Unlinks the childless node without a value from the children of its parent */
+        void RemoveChild(NodeIndex parent, NodeIndex child);
+        /* Returns whether the descendant columns of the node changed */
+        bool UpdateDescendantColumns(NodeIndex node);
+        /* Returns kNoNode if there is no node for the key */
+        NodeIndex FindNode(ColumnSet const& key) const;
+
+        bool CollectSubsetKeys(NodeIndex node, ColumnSet const& key, ColumnSet& subset_key,
+                               Collector const& collector) const;
+        /* missing_columns are the columns of the key that are not on the path to the node yet,
+         * children with a column from blacklist are skipped if blacklist is not null */
+        bool CollectSupersetKeys(NodeIndex node, ColumnSet& missing_columns,
+                                 ColumnSet const* blacklist, ColumnSet& superset_key,
+                                 Collector const& collector) const;
+        bool TraverseEntries(NodeIndex node, ColumnSet& key, Collector const& collector) const;
+        void CollectSubsetKeys(NodeIndex node, size_t depth, BatchSearch& search) const;
+        void CollectSupersetKeys(NodeIndex node, size_t depth, BatchSearch& search) const;
 
     public:
-        explicit SetTrie(size_t dimension) : SetTrie(0, dimension) {}
-        SetTrie(size_t offset, size_t dimension) : offset_(offset), dimension_(dimension) {}
+        explicit SetTrie(size_t dimension);
 
         // Sets given key to a given value
         // Returns the old value with ownership
-        // Not a const method as SetTrie gets changed
-        std::shared_ptr<Value> Associate(Bitset const& key, size_t next_bit,
-                                         std::shared_ptr<Value> value);
+        std::shared_ptr<Value> Associate(ColumnSet const& key, std::shared_ptr<Value> value);
 
         // Returns a pointer to the value mapped by the given key
-        std::shared_ptr<Value const> Get(Bitset const& key, size_t next_bit) const;
+        std::shared_ptr<Value const> Get(ColumnSet const& key) const;
 
-        // Erases an entry with the given key
+        // Erases an entry with the given key, dropping the nodes left without entries
         // Returns the old value with ownership
-        std::shared_ptr<Value> Remove(Bitset const& key, size_t next_bit);
+        std::shared_ptr<Value> Remove(ColumnSet const& key);
 
-        // Gets the subtrie with the given index. If such a subtrie does not exist, creates one
-        // Not a const method as a SetTrie may be created
-        SetTrie* GetOrCreateSubTrie(size_t index);
+        // Calls collector on every entry with a subset of the given key until it returns false
+        bool CollectSubsetKeys(ColumnSet const& key, Collector const& collector) const;
 
-        // Gets the subtrie with the given index
-        // Non-const version of the method -- needed in getOrCreateSubtrie to manipulate SetTrie*
-        SetTrie* GetSubtrie(size_t index);
+        // Calls collector on every entry with a superset of the given key until it returns false
+        bool CollectSupersetKeys(ColumnSet const& key, Collector const& collector) const;
 
-        // Gets the subtrie with the given index
-        // Const version of the method
-        SetTrie const* GetSubtrie(size_t index) const;
-
-        // Calls collector on every trie that is a subset of the given subset_key
-        bool CollectSubsetKeys(
-            Bitset const& key, size_t next_bit, Bitset& subset_key,
-            std::function<bool(Bitset const&, std::shared_ptr<Value const>)> const& collector)
-            const;
-
-        // Calls collector on every trie that is a superset of the given subsetKey
-        bool CollectSupersetKeys(
-            Bitset const& key, size_t next_bit, Bitset& superset_key,
-            std::function<bool(Bitset const&, std::shared_ptr<Value const>)> const& collector)
-            const;
+        // Batched versions of the two searches above: call collector on the entries of every key
+        // in the order the single searches would, walking the trie once for all of them
+        void CollectSubsetKeys(std::vector<ColumnSet const*> const& keys,
+                               BatchCollector const& collector) const;
+        void CollectSupersetKeys(std::vector<ColumnSet const*> const& keys,
+                                 BatchCollector const& collector) const;
 
-        // Calls collector on every trie that is a superset of the given subsetKey with no bits from the blacklist
-        bool CollectRestrictedSupersetKeys(
-            Bitset const& key, Bitset const& blacklist, size_t next_bit, Bitset& superset_key,
-            std::function<void(Bitset const&, std::shared_ptr<Value const>)> const& collector)
-            const;
+        // Calls collector on every entry with a superset of the given key that has no bits from
+        // the blacklist
+        void CollectRestrictedSupersetKeys(ColumnSet const& key, ColumnSet const& blacklist,
+                                           Collector const& collector) const;
 
         // Calls collector on every entry
         void TraverseEntries(
-            Bitset& subset_key,
-            std::function<void(Bitset const&, std::shared_ptr<Value const>)> collector) const;
+            std::function<void(ColumnSet const&, std::shared_ptr<Value const>)> const& collector)
+            const;
     };
 
     RelationalSchema const* relation_;
@@ -95,6 +144,7 @@ protected:
 
     unsigned int RemoveFromUsageCounter(std::unordered_map<Vertical, unsigned int>& usage_counter,
                                         const Vertical& key);
+    static std::vector<ColumnSet const*> GetKeys(std::vector<Vertical> const& verticals);
 
 public:
     using Entry = std::pair<Vertical, std::shared_ptr<Value const>>;
@@ -133,6 +183,19 @@ public:
         std::function<bool(Vertical const*, std::shared_ptr<Value const>)> condition) const;
     virtual std::vector<Entry> GetRestrictedSupersetEntries(Vertical const& vertical,
                                                             Vertical const& exclusion) const;
+
+    // batched queries: the i-th result is the one of the single query for verticals[i], the trie
+    // is walked once for all the verticals
+    virtual std::vector<std::vector<Entry>> GetSubsetEntries(
+        std::vector<Vertical> const& verticals) const;
+    virtual std::vector<Entry> GetAnySubsetEntries(std::vector<Vertical> const& verticals) const;
+    virtual std::vector<Entry> GetAnySubsetEntries(
+        std::vector<Vertical> const& verticals,
+        std::function<bool(Vertical const*, std::shared_ptr<Value const>)> const& condition) const;
+    virtual std::vector<std::vector<Entry>> GetSupersetEntries(
+        std::vector<Vertical> const& verticals) const;
+    virtual std::vector<Entry> GetAnySupersetEntries(std::vector<Vertical> const& verticals) const;
+
     virtual bool RemoveSupersetEntries(Vertical const& key);
     virtual bool RemoveSubsetEntries(Vertical const& key);
 
@@ -195,6 +258,18 @@ public:
         std::function<bool(Vertical const*, std::shared_ptr<V const>)> condition) const override;
     virtual std::vector<Entry> GetRestrictedSupersetEntries(
         Vertical const& vertical, Vertical const& exclusion) const override;
+    virtual std::vector<std::vector<Entry>> GetSubsetEntries(
+        std::vector<Vertical> const& verticals) const override;
+    virtual std::vector<Entry> GetAnySubsetEntries(
+        std::vector<Vertical> const& verticals) const override;
+    virtual std::vector<Entry> GetAnySubsetEntries(
+        std::vector<Vertical> const& verticals,
+        std::function<bool(Vertical const*, std::shared_ptr<V const>)> const& condition)
+        const override;
+    virtual std::vector<std::vector<Entry>> GetSupersetEntries(
+        std::vector<Vertical> const& verticals) const override;
+    virtual std::vector<Entry> GetAnySupersetEntries(
+        std::vector<Vertical> const& verticals) const override;
     virtual bool RemoveSupersetEntries(Vertical const& key) override;
     virtual bool RemoveSubsetEntries(Vertical const& key) override;
 
@@ -210,5 +285,91 @@ public:
     virtual ~BlockingVerticalMap() = default;
 };
 
-} // namespace util
+/*
+ * A version of VerticalMap for parallel processing that splits the entries into shards by the
+ * first column of their keys. Every shard is a VerticalMap with its own reader-writer mutex, so
+ * writers lock only the shard of their key and readers lock the shards a query can reach one at
+ * a time: long superset scans do not stall insertions elsewhere. A query spanning several shards
+ * sees each of them at some moment during the call rather than the whole map at once.
+ * */
+template <class V>
+class ConcurrentVerticalMap : public VerticalMap<V> {
+private:
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        VerticalMap<V> map;
+
+        explicit Shard(RelationalSchema const* relation) : map(relation) {}
+    };
+
+    // shards_[i] keeps the keys with the first column i, the last shard keeps the empty key
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<size_t> num_entries_ = 0;
+
+    Shard& GetShard(ColumnSet const& key) const;
+    // Calls action on the shards that may keep subsets of the key until it returns false
+    template <typename Action>
+    void ForEachSubsetShard(ColumnSet const& key, Action action) const;
+    // Calls action on the shards that may keep supersets of the key until it returns false
+    template <typename Action>
+    void ForEachSupersetShard(ColumnSet const& key, Action action) const;
+    // Calls action(shard, indices, batch) on the shards in the order of the single queries, batch
+    // being the pending verticals that may have matches in the shard and indices their positions
+    template <typename IsPending, typename Action>
+    void ForEachShardBatch(std::vector<Vertical> const& verticals, bool is_subset_search,
+                           IsPending is_pending, Action action) const;
+
+public:
+    using typename VerticalMap<V>::Entry;
+    using typename VerticalMap<V>::Bitset;
+
+    explicit ConcurrentVerticalMap(RelationalSchema const* relation);
+    virtual size_t GetSize() const override { return num_entries_; }
+    virtual bool IsEmpty() const override { return num_entries_ == 0; }
+
+    virtual std::shared_ptr<V const> Get(Vertical const& key) const override;
+    virtual std::shared_ptr<V const> Get(Bitset const& key) const override;
+    virtual bool ContainsKey(Vertical const& key) const override { return Get(key) != nullptr; }
+    virtual std::shared_ptr<V> Put(Vertical const& key, std::shared_ptr<V> value) override;
+    virtual std::shared_ptr<V> Remove(Vertical const& key) override;
+    virtual std::shared_ptr<V> Remove(Bitset const& key) override;
+
+    virtual std::shared_ptr<V> Get(Vertical const& key) override;
+
+    virtual std::unordered_set<Vertical> KeySet() override;
+    virtual std::vector<std::shared_ptr<V const>> Values() override;
+    virtual std::unordered_set<Entry> EntrySet() override;
 
+    virtual std::vector<Vertical> GetSubsetKeys(Vertical const& vertical) const override;
+    virtual std::vector<Entry> GetSubsetEntries(Vertical const& vertical) const override;
+    virtual Entry GetAnySubsetEntry(Vertical const& vertical) const override;
+    virtual Entry GetAnySubsetEntry(
+        Vertical const& vertical,
+        std::function<bool(Vertical const*, std::shared_ptr<V const>)> const& condition)
+        const override;
+    virtual std::vector<Entry> GetSupersetEntries(Vertical const& vertical) const override;
+    virtual Entry GetAnySupersetEntry(Vertical const& vertical) const override;
+    virtual Entry GetAnySupersetEntry(
+        Vertical const& vertical,
+        std::function<bool(Vertical const*, std::shared_ptr<V const>)> condition) const override;
+    virtual std::vector<Entry> GetRestrictedSupersetEntries(
+        Vertical const& vertical, Vertical const& exclusion) const override;
+    virtual std::vector<std::vector<Entry>> GetSubsetEntries(
+        std::vector<Vertical> const& verticals) const override;
+    virtual std::vector<Entry> GetAnySubsetEntries(
+        std::vector<Vertical> const& verticals) const override;
+    virtual std::vector<Entry> GetAnySubsetEntries(
+        std::vector<Vertical> const& verticals,
+        std::function<bool(Vertical const*, std::shared_ptr<V const>)> const& condition)
+        const override;
+    virtual std::vector<std::vector<Entry>> GetSupersetEntries(
+        std::vector<Vertical> const& verticals) const override;
+    virtual std::vector<Entry> GetAnySupersetEntries(
+        std::vector<Vertical> const& verticals) const override;
+    virtual bool RemoveSupersetEntries(Vertical const& key) override;
+    virtual bool RemoveSubsetEntries(Vertical const& key) override;
+
+    virtual ~ConcurrentVerticalMap() = default;
+};
+
+} // namespace util
@@ -4,6 +4,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "ColumnLayoutRelationData.h"
 #include "ColumnLayoutTypedRelationData.h"
 #include "CSVParser.h"
 
@@ -100,4 +101,23 @@ TEST(TypeSystem, SumColumnDoubles) {
     EXPECT_DOUBLE_EQ(type.GetValue<mo::Double>(sum.get()), expected);
 }
 
+TEST(TypeSystem, SinglePassLoadMatchesSeparateLoads) {
+    auto const path = fs::current_path() / "inputData" / "SimpleTypes.csv";
+    CSVParser single_pass_input(path);
+    auto [relation, typed_relation] =
+        mo::ColumnLayoutTypedRelationData::CreateWithUntypedFrom(single_pass_input, true);
+    CSVParser relation_input(path);
+    auto expected_relation = ColumnLayoutRelationData::CreateFrom(relation_input, true);
+    std::vector<mo::TypedColumnData> expected_columns = CreateColumnData("SimpleTypes.csv", ',', true);
+
+    ASSERT_EQ(typed_relation->GetNumColumns(), expected_columns.size());
+    ASSERT_EQ(relation->GetNumColumns(), expected_relation->GetNumColumns());
+    ASSERT_EQ(relation->GetNumRows(), typed_relation->GetNumRows());
+    for (size_t i = 0; i < expected_columns.size(); ++i) {
+        EXPECT_EQ(typed_relation->GetColumnData(i).GetTypeId(), expected_columns[i].GetTypeId());
+        EXPECT_EQ(relation->GetColumnData(i).GetProbingTable(),
+                  expected_relation->GetColumnData(i).GetProbingTable());
+    }
+}
+
 }  // namespace tests
@@ -1,14 +1,24 @@
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <random>
 #include <thread>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "ColumnLayoutRelationData.h"
+#include "ColumnSet.h"
 #include "ListAgreeSetSample.h"
 #include "IdentifierSet.h"
 #include "AgreeSetFactory.h"
+#include "BitMatrixAgreeSetSample.h"
+#include "BitmapIndexAgreeSetSample.h"
 #include "LevenshteinDistance.h"
+#include "PLICache.h"
+#include "ProfilingContext.h"
+#include "VerticalMap.h"
 
 namespace tests {
 
@@ -60,6 +70,465 @@ TEST(pliChecker, second) {
     ASSERT_THAT(index, ContainerEq(ans));
 }
 
+TEST(pliChecker, parallelConstruction) {
+    for (std::string name : {"CIPublicHighway700.csv", "TestSingleColumn.csv", "Test1.csv"}) {
+        for (unsigned threads_num : {2, 4, 7}) {
+            auto path = fs::current_path().append("inputData").append(name);
+            CSVParser sequential_parser(path);
+            CSVParser parallel_parser(path);
+            auto sequential = ColumnLayoutRelationData::CreateFrom(sequential_parser, false);
+            auto parallel =
+                ColumnLayoutRelationData::CreateFrom(parallel_parser, false, -1, -1, threads_num);
+
+            ASSERT_EQ(sequential->GetNumColumns(), parallel->GetNumColumns());
+            ASSERT_EQ(sequential->GetNumRows(), parallel->GetNumRows());
+            for (unsigned i = 0; i < sequential->GetNumColumns(); ++i) {
+                auto expected = sequential->GetColumnData(i).GetPositionListIndex();
+                auto actual = parallel->GetColumnData(i).GetPositionListIndex();
+                ASSERT_THAT(actual->GetIndex(), ContainerEq(expected->GetIndex()));
+                ASSERT_EQ(actual->GetNepAsLong(), expected->GetNepAsLong());
+                ASSERT_DOUBLE_EQ(actual->GetEntropy(), expected->GetEntropy());
+                ASSERT_DOUBLE_EQ(actual->GetGiniImpurity(), expected->GetGiniImpurity());
+            }
+        }
+    }
+}
+
+TEST(pliChecker, snapshotConstruction) {
+    auto path = fs::current_path().append("inputData").append("CIPublicHighway700.csv");
+    auto snapshot_dir = fs::temp_directory_path() / "desbordante_snapshot_test";
+    fs::remove_all(snapshot_dir);
+    CSVParser parser(path);
+    auto expected = ColumnLayoutRelationData::CreateFrom(parser, true);
+
+    for (int run = 0; run < 2; ++run) {
+        CSVParser snapshot_parser(path);
+        auto actual = ColumnLayoutRelationData::CreateFrom(snapshot_parser, true, snapshot_dir);
+        /* The first run writes the snapshot and the second one reads it */
+        ASSERT_EQ(std::distance(fs::directory_iterator(snapshot_dir), fs::directory_iterator()),
+                  1);
+        ASSERT_EQ(expected->GetNumColumns(), actual->GetNumColumns());
+        ASSERT_EQ(expected->GetNumRows(), actual->GetNumRows());
+        for (unsigned i = 0; i < expected->GetNumColumns(); ++i) {
+            ASSERT_EQ(expected->GetSchema()->GetColumn(i)->GetName(),
+                      actual->GetSchema()->GetColumn(i)->GetName());
+            ASSERT_THAT(actual->GetColumnData(i).GetProbingTable(),
+                        ContainerEq(expected->GetColumnData(i).GetProbingTable()));
+        }
+    }
+    fs::remove_all(snapshot_dir);
+}
+
+TEST(pliCacheChecker, evictionKeepsMemoryLimit) {
+    auto path = fs::current_path().append("inputData").append("CIPublicHighway700.csv");
+    CSVParser parser(path);
+    auto relation = ColumnLayoutRelationData::CreateFrom(parser, true);
+    RelationalSchema const* schema = relation->GetSchema();
+    std::size_t const memory_limit = 16 * 1024;
+
+    for (auto eviction_method : {CacheEvictionMethod::kDefault, CacheEvictionMethod::kMedainUsage,
+                                 CacheEvictionMethod::kHottoRemain}) {
+        Configuration configuration;
+        configuration.sample_size = 0;
+        configuration.pli_cache_memory_limit = memory_limit;
+        ProfilingContext context(configuration, relation.get(), [](PartialKey const&) {},
+                                 [](PartialFD const&) {}, CachingMethod::kAllCaching,
+                                 eviction_method, 0);
+        util::PLICache* pli_cache = context.GetPliCache();
+
+        for (unsigned i = 0; i < schema->GetNumColumns(); ++i) {
+            for (unsigned j = i + 1; j < schema->GetNumColumns(); ++j) {
+                Vertical vertical = Vertical(*schema->GetColumn(i)).Union(
+                    Vertical(*schema->GetColumn(j)));
+                auto pli = pli_cache->GetOrCreateFor(vertical, &context);
+                auto expected = relation->GetColumnData(i).GetPositionListIndex()->Intersect(
+                    relation->GetColumnData(j).GetPositionListIndex());
+                ASSERT_EQ(pli->GetNepAsLong(), expected->GetNepAsLong());
+                ASSERT_LE(pli_cache->GetMemoryUsage(), memory_limit);
+            }
+        }
+        ASSERT_GT(pli_cache->GetEvictions(), 0);
+        /* Single-column PLIs are pinned */
+        for (auto const& column : schema->GetColumns()) {
+            ASSERT_NE(pli_cache->Get(Vertical(*column)), nullptr);
+        }
+    }
+}
+
+TEST(pliCacheChecker, thresholdCachingMethods) {
+    auto path = fs::current_path().append("inputData").append("CIPublicHighway700.csv");
+    CSVParser parser(path);
+    auto relation = ColumnLayoutRelationData::CreateFrom(parser, true);
+    RelationalSchema const* schema = relation->GetSchema();
+    Configuration configuration;
+    configuration.sample_size = 0;
+    unsigned const num_columns = schema->GetNumColumns();
+
+    for (auto caching_method :
+         {CachingMethod::kEntropy, CachingMethod::kTrueUniquenessEntropy,
+          CachingMethod::kMeanEntropyThreshold, CachingMethod::kHeuristicQ2, CachingMethod::kGini,
+          CachingMethod::kInvertedEntropy}) {
+        /* Measures are never negative, so the first threshold admits nothing and the second one
+         * admits everything */
+        for (double caching_method_value : {-1.0, 1e9}) {
+            ProfilingContext context(configuration, relation.get(), [](PartialKey const&) {},
+                                     [](PartialFD const&) {}, caching_method,
+                                     CacheEvictionMethod::kDefault, caching_method_value);
+            util::PLICache* pli_cache = context.GetPliCache();
+            for (unsigned i = 0; i < num_columns; ++i) {
+                for (unsigned j = i + 1; j < num_columns; ++j) {
+                    Vertical vertical = Vertical(*schema->GetColumn(i)).Union(
+                        Vertical(*schema->GetColumn(j)));
+                    auto pli = pli_cache->GetOrCreateFor(vertical, &context);
+                    auto expected = relation->GetColumnData(i).GetPositionListIndex()->Intersect(
+                        relation->GetColumnData(j).GetPositionListIndex());
+                    ASSERT_EQ(pli->GetNepAsLong(), expected->GetNepAsLong());
+                }
+            }
+            std::size_t num_cached = caching_method_value < 0
+                                         ? num_columns
+                                         : num_columns + num_columns * (num_columns - 1) / 2;
+            ASSERT_EQ(pli_cache->Size(), num_cached);
+        }
+
+        /* The default value admits only some of the PLIs, those with the smaller measures. A
+         * column of this relation is a key, so kTrueUniquenessEntropy needs a smaller value */
+        double const caching_method_value =
+            caching_method == CachingMethod::kTrueUniquenessEntropy ? 0.5 : 1;
+        auto measure = [caching_method](util::PositionListIndex const& pli) {
+            switch (caching_method) {
+            case CachingMethod::kGini:
+                return pli.GetGiniImpurity();
+            case CachingMethod::kInvertedEntropy:
+                return pli.GetInvertedEntropy();
+            default:
+                return pli.GetEntropy();
+            }
+        };
+        ProfilingContext context(configuration, relation.get(), [](PartialKey const&) {},
+                                 [](PartialFD const&) {}, caching_method,
+                                 CacheEvictionMethod::kDefault, caching_method_value);
+        util::PLICache* pli_cache = context.GetPliCache();
+        double max_admitted = -1;
+        double min_rejected = std::numeric_limits<double>::infinity();
+        for (unsigned i = 0; i < num_columns; ++i) {
+            for (unsigned j = i + 1; j < num_columns; ++j) {
+                Vertical vertical =
+                    Vertical(*schema->GetColumn(i)).Union(Vertical(*schema->GetColumn(j)));
+                auto pli = pli_cache->GetOrCreateFor(vertical, &context);
+                if (pli_cache->Get(vertical) != nullptr) {
+                    max_admitted = std::max(max_admitted, measure(*pli));
+                } else {
+                    min_rejected = std::min(min_rejected, measure(*pli));
+                }
+            }
+        }
+        ASSERT_GE(max_admitted, 0);
+        ASSERT_LT(min_rejected, std::numeric_limits<double>::infinity());
+        ASSERT_LE(max_admitted, min_rejected);
+    }
+}
+
+TEST(pliCacheChecker, concurrentRequestsAreCalculatedOnce) {
+    auto path = fs::current_path().append("inputData").append("CIPublicHighway700.csv");
+    CSVParser parser(path);
+    auto relation = ColumnLayoutRelationData::CreateFrom(parser, true);
+    RelationalSchema const* schema = relation->GetSchema();
+    Configuration configuration;
+    configuration.sample_size = 0;
+    ProfilingContext context(configuration, relation.get(), [](PartialKey const&) {},
+                             [](PartialFD const&) {}, CachingMethod::kAllCaching,
+                             CacheEvictionMethod::kDefault, 0);
+    util::PLICache* pli_cache = context.GetPliCache();
+
+    std::vector<Vertical> verticals;
+    for (unsigned i = 0; i < schema->GetNumColumns(); ++i) {
+        for (unsigned j = i + 1; j < schema->GetNumColumns(); ++j) {
+            verticals.push_back(
+                Vertical(*schema->GetColumn(i)).Union(Vertical(*schema->GetColumn(j))));
+        }
+    }
+    unsigned const threads_num = 4;
+    std::vector<std::vector<unsigned long long>> neps(threads_num);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threads_num; ++t) {
+        threads.emplace_back([&, t]() {
+            for (Vertical const& vertical : verticals) {
+                neps[t].push_back(pli_cache->GetOrCreateFor(vertical, &context)->GetNepAsLong());
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(pli_cache->GetMisses(), verticals.size());
+    ASSERT_EQ(pli_cache->GetHits(), verticals.size() * (threads_num - 1));
+    for (unsigned t = 1; t < threads_num; ++t) {
+        ASSERT_THAT(neps[t], ContainerEq(neps[0]));
+    }
+}
+
+TEST(pliCacheChecker, worksWithoutProfilingContext) {
+    auto path = fs::current_path().append("inputData").append("CIPublicHighway700.csv");
+    CSVParser parser(path);
+    auto relation = ColumnLayoutRelationData::CreateFrom(parser, true);
+    RelationalSchema const* schema = relation->GetSchema();
+
+    for (auto caching_method : {CachingMethod::kAllCaching, CachingMethod::kCoin}) {
+        util::PLICache pli_cache(relation.get(), caching_method,
+                                 CacheEvictionMethod::kMedainUsage);
+        /* Under kCoin some prefixes are not cached, so the longer verticals are probed */
+        Vertical vertical = Vertical(*schema->GetColumn(0));
+        std::unique_ptr<util::PositionListIndex> expected;
+        for (unsigned i = 1; i < schema->GetNumColumns(); ++i) {
+            vertical = vertical.Union(Vertical(*schema->GetColumn(i)));
+            util::PositionListIndex const* previous =
+                expected ? expected.get() : relation->GetColumnData(0).GetPositionListIndex();
+            expected = previous->Intersect(relation->GetColumnData(i).GetPositionListIndex());
+            ASSERT_EQ(pli_cache.GetOrCreateFor(vertical)->GetNepAsLong(),
+                      expected->GetNepAsLong());
+        }
+    }
+}
+
+TEST(pliCacheChecker, plannedIntersectionsMatchPairwise) {
+    auto path = fs::current_path().append("inputData").append("CIPublicHighway700.csv");
+    CSVParser parser(path);
+    auto relation = ColumnLayoutRelationData::CreateFrom(parser, true);
+    RelationalSchema const* schema = relation->GetSchema();
+    unsigned const num_columns = schema->GetNumColumns();
+
+    for (auto caching_method : {CachingMethod::kNoCaching, CachingMethod::kAllCaching}) {
+        util::PLICache pli_cache(relation.get(), caching_method, CacheEvictionMethod::kDefault);
+        /* Windows of columns overlap, so that the plans can combine cached verticals */
+        for (unsigned arity = 2; arity <= num_columns; ++arity) {
+            for (unsigned first = 0; first + arity <= num_columns; ++first) {
+                Vertical vertical = Vertical(*schema->GetColumn(first));
+                std::unique_ptr<util::PositionListIndex> expected;
+                for (unsigned i = first + 1; i < first + arity; ++i) {
+                    vertical = vertical.Union(Vertical(*schema->GetColumn(i)));
+                    util::PositionListIndex const* previous =
+                        expected ? expected.get()
+                                 : relation->GetColumnData(first).GetPositionListIndex();
+                    expected =
+                        previous->Intersect(relation->GetColumnData(i).GetPositionListIndex());
+                }
+                util::PositionListIndex const* rhs =
+                    relation->GetColumnData((first + arity) % num_columns).GetPositionListIndex();
+                ASSERT_EQ(pli_cache.GetG1ViolationsFor(vertical, rhs),
+                          expected->GetNepAsLong() - expected->Intersect(rhs)->GetNepAsLong());
+                auto stats = pli_cache.GetStatsFor(vertical);
+                ASSERT_EQ(stats.nep, expected->GetNepAsLong());
+                ASSERT_EQ(stats.size, expected->GetSize());
+                ASSERT_EQ(stats.num_clusters, expected->GetNumCluster());
+                ASSERT_NEAR(stats.entropy, expected->GetEntropy(), 1e-9);
+                ASSERT_THAT(pli_cache.GetOrCreateFor(vertical)->GetIndex(),
+                            ContainerEq(expected->GetIndex()));
+            }
+        }
+    }
+}
+
+TEST(pliCacheChecker, countOnlyStatsAreNotCached) {
+    auto path = fs::current_path().append("inputData").append("CIPublicHighway700.csv");
+    CSVParser parser(path);
+    auto relation = ColumnLayoutRelationData::CreateFrom(parser, true);
+    RelationalSchema const* schema = relation->GetSchema();
+    unsigned const num_columns = schema->GetNumColumns();
+
+    /* Most of the intersections of two columns pass the default entropy threshold, so the
+     * cache grows if the statistics are taken from materialized PLIs */
+    util::PLICache pli_cache(relation.get(), CachingMethod::kEntropy,
+                             CacheEvictionMethod::kDefault);
+    for (unsigned arity = 3; arity <= 5; ++arity) {
+        for (unsigned first = 0; first + arity <= num_columns; ++first) {
+            Vertical vertical = Vertical(*schema->GetColumn(first));
+            std::vector<util::PositionListIndex const*> plis{
+                relation->GetColumnData(first).GetPositionListIndex()};
+            for (unsigned i = first + 1; i < first + arity; ++i) {
+                vertical = vertical.Union(Vertical(*schema->GetColumn(i)));
+                plis.push_back(relation->GetColumnData(i).GetPositionListIndex());
+            }
+            std::size_t const size = pli_cache.Size();
+            auto stats = pli_cache.GetStatsFor(vertical);
+            ASSERT_EQ(pli_cache.Size(), size);
+            auto expected = util::PositionListIndex::GetIntersectionStats(plis);
+            ASSERT_EQ(stats.nep, expected.nep);
+            ASSERT_EQ(stats.size, expected.size);
+            ASSERT_EQ(stats.num_clusters, expected.num_clusters);
+        }
+    }
+}
+
+TEST(columnSetChecker, matchesDynamicBitset) {
+    std::mt19937 gen(0);
+    for (std::size_t size : {1, 5, 64, 65, 128, 200, 256, 300}) {
+        for (int iteration = 0; iteration < 20; ++iteration) {
+            boost::dynamic_bitset<> first_bits(size);
+            boost::dynamic_bitset<> second_bits(size);
+            for (std::size_t i = 0; i < size; ++i) {
+                first_bits[i] = gen() % 3 == 0;
+                second_bits[i] = gen() % 3 == 0;
+            }
+            ColumnSet const first(first_bits);
+            ColumnSet const second(second_bits);
+            ASSERT_EQ(first.ToDynamicBitset(), first_bits);
+            ASSERT_EQ(first.count(), first_bits.count());
+            ASSERT_EQ(first.find_first(), first_bits.find_first());
+            for (std::size_t i = first.find_first(); i != ColumnSet::npos;
+                 i = first.find_next(i)) {
+                ASSERT_TRUE(first_bits.test(i));
+                ASSERT_EQ(first.find_next(i), first_bits.find_next(i));
+            }
+            ASSERT_EQ(first.is_subset_of(second), first_bits.is_subset_of(second_bits));
+            ASSERT_EQ(first.intersects(second), first_bits.intersects(second_bits));
+
+            ASSERT_EQ((ColumnSet(first) |= second).ToDynamicBitset(), first_bits | second_bits);
+            ASSERT_EQ((ColumnSet(first) &= second).ToDynamicBitset(), first_bits & second_bits);
+            ASSERT_EQ((ColumnSet(first) ^= second).ToDynamicBitset(), first_bits ^ second_bits);
+            ASSERT_EQ((ColumnSet(first) -= second).ToDynamicBitset(), first_bits - second_bits);
+            ASSERT_EQ(ColumnSet(first).flip().ToDynamicBitset(), ~first_bits);
+            ASSERT_EQ(ColumnSet(first).flip().flip(), first);
+        }
+    }
+}
+
+TEST(columnSetChecker, hashUsesAllColumns) {
+    ColumnSet first(200);
+    ColumnSet second(200);
+    first.set(70);
+    second.set(190);
+    ASSERT_NE(first, second);
+    ASSERT_NE(first.Hash(), second.Hash());
+}
+
+TEST(verticalMapChecker, matchesBruteForce) {
+    std::mt19937 gen(0);
+    for (std::size_t num_columns : {10, 100, 300}) {
+        RelationalSchema schema("verticalMapChecker", true);
+        for (std::size_t i = 0; i < num_columns; ++i) {
+            schema.AppendColumn(std::to_string(i));
+        }
+        auto random_vertical = [&gen, &schema, num_columns]() {
+            boost::dynamic_bitset<> indices(num_columns);
+            for (std::size_t i = 0; i < 10; ++i) {
+                indices[i * num_columns / 10] = gen() % 3 == 0;
+            }
+            return schema.GetVertical(indices);
+        };
+
+        util::VerticalMap<Vertical> map(&schema);
+        util::ConcurrentVerticalMap<Vertical> concurrent_map(&schema);
+        std::unordered_set<Vertical> keys;
+        for (int i = 0; i < 300; ++i) {
+            Vertical key = random_vertical();
+            map.Put(key, std::make_shared<Vertical>(key));
+            concurrent_map.Put(key, std::make_shared<Vertical>(key));
+            keys.insert(key);
+        }
+        for (int i = 0; i < 100; ++i) {
+            Vertical key = random_vertical();
+            ASSERT_EQ(concurrent_map.Remove(key) != nullptr, keys.count(key) == 1);
+            ASSERT_EQ(map.Remove(key) != nullptr, keys.erase(key) == 1);
+        }
+
+        auto entry_keys = [](std::vector<util::VerticalMap<Vertical>::Entry> const& entries) {
+            std::unordered_set<Vertical> entry_keys;
+            for (auto const& [key, value] : entries) {
+                EXPECT_EQ(key, *value);
+                entry_keys.insert(key);
+            }
+            return entry_keys;
+        };
+        for (util::VerticalMap<Vertical>* checked_map :
+             std::vector<util::VerticalMap<Vertical>*>{&map, &concurrent_map}) {
+            ASSERT_EQ(checked_map->GetSize(), keys.size());
+            ASSERT_EQ(checked_map->KeySet(), keys);
+            for (int i = 0; i < 50; ++i) {
+                Vertical query = random_vertical();
+                Vertical exclusion = random_vertical().Without(query);
+                std::unordered_set<Vertical> subsets, supersets, restricted_supersets;
+                for (Vertical const& key : keys) {
+                    if (query.Contains(key)) subsets.insert(key);
+                    if (key.Contains(query)) supersets.insert(key);
+                    if (key.Contains(query) && !key.Intersects(exclusion)) {
+                        restricted_supersets.insert(key);
+                    }
+                }
+                ASSERT_EQ(entry_keys(checked_map->GetSubsetEntries(query)), subsets);
+                ASSERT_EQ(entry_keys(checked_map->GetSupersetEntries(query)), supersets);
+                ASSERT_EQ(entry_keys(checked_map->GetRestrictedSupersetEntries(query, exclusion)),
+                          restricted_supersets);
+                ASSERT_EQ(checked_map->Get(query) != nullptr, keys.count(query) == 1);
+                /* The concurrent map finds the same entry first */
+                ASSERT_EQ(checked_map->GetAnySubsetEntry(query).first,
+                          map.GetAnySubsetEntry(query).first);
+                ASSERT_EQ(checked_map->GetAnySupersetEntry(query).first,
+                          map.GetAnySupersetEntry(query).first);
+            }
+
+            std::vector<Vertical> queries;
+            for (int i = 0; i < 50; ++i) {
+                queries.push_back(random_vertical());
+            }
+            auto has_odd_arity = [](Vertical const* key, auto) { return key->GetArity() % 2 == 1; };
+            auto subset_entries = checked_map->GetSubsetEntries(queries);
+            auto superset_entries = checked_map->GetSupersetEntries(queries);
+            auto any_subset_entries = checked_map->GetAnySubsetEntries(queries);
+            auto odd_subset_entries = checked_map->GetAnySubsetEntries(queries, has_odd_arity);
+            auto any_superset_entries = checked_map->GetAnySupersetEntries(queries);
+            for (std::size_t i = 0; i < queries.size(); ++i) {
+                ASSERT_EQ(entry_keys(subset_entries[i]),
+                          entry_keys(map.GetSubsetEntries(queries[i])));
+                ASSERT_EQ(entry_keys(superset_entries[i]),
+                          entry_keys(map.GetSupersetEntries(queries[i])));
+                ASSERT_EQ(any_subset_entries[i].first, map.GetAnySubsetEntry(queries[i]).first);
+                ASSERT_EQ(odd_subset_entries[i].first,
+                          map.GetAnySubsetEntry(queries[i], has_odd_arity).first);
+                ASSERT_EQ(any_superset_entries[i].first,
+                          map.GetAnySupersetEntry(queries[i]).first);
+            }
+        }
+    }
+}
+
+TEST(verticalMapChecker, concurrentPutsAndQueries) {
+    RelationalSchema schema("verticalMapChecker", true);
+    for (std::size_t i = 0; i < 20; ++i) {
+        schema.AppendColumn(std::to_string(i));
+    }
+    util::ConcurrentVerticalMap<Vertical> map(&schema);
+    unsigned const threads_num = 4;
+    std::vector<std::thread> threads;
+    for (unsigned thread_index = 0; thread_index < threads_num; ++thread_index) {
+        threads.emplace_back([&map, &schema, thread_index]() {
+            std::mt19937 gen(thread_index);
+            for (int i = 0; i < 2000; ++i) {
+                boost::dynamic_bitset<> indices(schema.GetNumColumns());
+                for (std::size_t column = 0; column < indices.size(); ++column) {
+                    indices[column] = gen() % 4 == 0;
+                }
+                /* Keys of different threads differ in the column of the thread */
+                indices.reset(0).reset(1).reset(2).reset(3).set(thread_index);
+                Vertical key = schema.GetVertical(indices);
+                map.Put(key, std::make_shared<Vertical>(key));
+                for (auto const& [superset, value] : map.GetSupersetEntries(key)) {
+                    ASSERT_TRUE(superset.Contains(key));
+                }
+                ASSERT_NE(map.GetAnySubsetEntry(key).second, nullptr);
+                if (i % 3 == 0) {
+                    ASSERT_NE(map.Remove(key), nullptr);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(map.GetSize(), map.KeySet().size());
+}
+
 TEST(pliIntersectChecker, first) {
     deque<vector<int>> ans = {{2, 5}};
     std::shared_ptr<util::PositionListIndex> intersection;
@@ -83,6 +552,162 @@ TEST(pliIntersectChecker, first) {
     ASSERT_THAT(intersection->GetIndex(), ContainerEq(ans));
 }
 
+TEST(pliChecker, clusterSpans) {
+    auto path = fs::current_path().append("inputData").append("Test1.csv");
+    CSVParser csv_parser(path);
+    auto test = ColumnLayoutRelationData::CreateFrom(csv_parser, true);
+    util::PositionListIndex const* pli = test->GetColumnData(0).GetPositionListIndex();
+
+    deque<vector<int>> index;
+    for (util::PositionListIndex::ClusterSpan cluster : pli->GetClusters()) {
+        index.emplace_back(cluster.begin(), cluster.end());
+    }
+    ASSERT_EQ(pli->GetClusters().size(), pli->GetNumNonSingletonCluster());
+    ASSERT_THAT(index, ContainerEq(pli->GetIndex()));
+}
+
+TEST(pliIntersectChecker, denseScratchMatchesHashing) {
+    auto path = fs::current_path().append("inputData").append("CIPublicHighway700.csv");
+    CSVParser csv_parser(path);
+    auto relation = ColumnLayoutRelationData::CreateFrom(csv_parser, true);
+    auto const default_method = util::PLI::intersection_method_;
+
+    for (unsigned i = 0; i < relation->GetNumColumns(); ++i) {
+        for (unsigned j = i + 1; j < relation->GetNumColumns(); ++j) {
+            util::PLI const* pli1 = relation->GetColumnData(i).GetPositionListIndex();
+            util::PLI const* pli2 = relation->GetColumnData(j).GetPositionListIndex();
+            util::PLI::intersection_method_ = util::PLI::IntersectionMethod::kHashing;
+            auto hashing = pli1->Intersect(pli2);
+            util::PLI::intersection_method_ = util::PLI::IntersectionMethod::kDenseScratch;
+            auto dense = pli1->Intersect(pli2);
+
+            ASSERT_THAT(dense->GetIndex(), ContainerEq(hashing->GetIndex()));
+            ASSERT_EQ(dense->GetNepAsLong(), hashing->GetNepAsLong());
+            ASSERT_EQ(dense->GetSize(), hashing->GetSize());
+            ASSERT_DOUBLE_EQ(dense->GetEntropy(), hashing->GetEntropy());
+        }
+    }
+    util::PLI::intersection_method_ = default_method;
+}
+
+TEST(pliIntersectChecker, countOnlyMatchesMaterialized) {
+    auto path = fs::current_path().append("inputData").append("CIPublicHighway700.csv");
+    CSVParser csv_parser(path);
+    auto relation = ColumnLayoutRelationData::CreateFrom(csv_parser, true);
+
+    for (unsigned i = 0; i + 2 < relation->GetNumColumns(); ++i) {
+        util::PLI const* pli1 = relation->GetColumnData(i).GetPositionListIndex();
+        util::PLI const* pli2 = relation->GetColumnData(i + 1).GetPositionListIndex();
+        util::PLI const* pli3 = relation->GetColumnData(i + 2).GetPositionListIndex();
+        auto intersection = pli1->Intersect(pli2);
+        auto stats = pli1->GetIntersectionStats(pli2);
+
+        ASSERT_EQ(stats.num_clusters, intersection->GetNumCluster());
+        ASSERT_EQ(stats.num_non_singleton_clusters, intersection->GetNumNonSingletonCluster());
+        ASSERT_EQ(stats.size, intersection->GetSize());
+        ASSERT_EQ(stats.nep, intersection->GetNepAsLong());
+        ASSERT_DOUBLE_EQ(stats.entropy, intersection->GetEntropy());
+        ASSERT_EQ(pli1->GetG1Violations(pli2), pli1->GetNepAsLong() - stats.nep);
+
+        auto three_way = intersection->Intersect(pli3);
+        auto three_way_stats = util::PLI::GetIntersectionStats({pli1, pli2, pli3});
+        ASSERT_EQ(three_way_stats.num_clusters, three_way->GetNumCluster());
+        ASSERT_EQ(three_way_stats.nep, three_way->GetNepAsLong());
+        ASSERT_EQ(pli1->GetG1Violations({pli2}, pli3),
+                  intersection->GetNepAsLong() - three_way->GetNepAsLong());
+    }
+}
+
+TEST(pliIntersectChecker, nWayCountOnlyMatchesMaterialized) {
+    auto path = fs::current_path().append("inputData").append("CIPublicHighway700.csv");
+    CSVParser csv_parser(path);
+    auto relation = ColumnLayoutRelationData::CreateFrom(csv_parser, true);
+
+    for (unsigned arity = 3; arity <= 5; ++arity) {
+        for (unsigned i = 0; i + arity <= relation->GetNumColumns(); ++i) {
+            std::vector<util::PLI const*> plis;
+            std::unique_ptr<util::PLI> intersection;
+            for (unsigned j = i; j < i + arity; ++j) {
+                plis.push_back(relation->GetColumnData(j).GetPositionListIndex());
+                intersection = intersection == nullptr ? plis.front()->Intersect(plis.back())
+                                                       : intersection->Intersect(plis.back());
+            }
+            auto stats = util::PLI::GetIntersectionStats(plis);
+
+            ASSERT_EQ(stats.num_clusters, intersection->GetNumCluster());
+            ASSERT_EQ(stats.num_non_singleton_clusters,
+                      intersection->GetNumNonSingletonCluster());
+            ASSERT_EQ(stats.size, intersection->GetSize());
+            ASSERT_EQ(stats.nep, intersection->GetNepAsLong());
+            ASSERT_NEAR(stats.entropy, intersection->GetEntropy(), 1e-9);
+        }
+    }
+}
+
+TEST(pliIntersectChecker, probeAllMatchesPairwise) {
+    auto path = fs::current_path().append("inputData").append("CIPublicHighway700.csv");
+    CSVParser csv_parser(path);
+    auto relation = ColumnLayoutRelationData::CreateFrom(csv_parser, true);
+
+    for (unsigned i = 0; i + 3 < relation->GetNumColumns(); ++i) {
+        util::PLI const* base = relation->GetColumnData(i).GetPositionListIndex();
+        std::vector<util::PLI const*> probing_plis;
+        std::unique_ptr<util::PLI> pairwise = base->Intersect(base);
+        for (unsigned j = i + 1; j <= i + 3; ++j) {
+            probing_plis.push_back(relation->GetColumnData(j).GetPositionListIndex());
+            pairwise = pairwise->Intersect(probing_plis.back());
+        }
+        auto nary = base->ProbeAll(probing_plis);
+
+        ASSERT_THAT(nary->GetIndex(), ContainerEq(pairwise->GetIndex()));
+        ASSERT_EQ(nary->GetNepAsLong(), pairwise->GetNepAsLong());
+        ASSERT_EQ(nary->GetSize(), pairwise->GetSize());
+        ASSERT_DOUBLE_EQ(nary->GetEntropy(), pairwise->GetEntropy());
+    }
+}
+
+TEST(csvParserChecker, viewsMatchStrings) {
+    for (std::string name : {"SimpleTypes.csv", "WDC_game.csv", "Test1.csv"}) {
+        auto path = fs::current_path().append("inputData").append(name);
+        CSVParser string_parser(path);
+        CSVParser view_parser(path);
+        std::vector<std::string_view> fields;
+
+        while (string_parser.GetHasNext()) {
+            ASSERT_TRUE(view_parser.GetHasNext());
+            std::vector<std::string> expected = string_parser.ParseNext();
+            view_parser.ParseNext(fields);
+            ASSERT_THAT(std::vector<std::string>(fields.begin(), fields.end()),
+                        ContainerEq(expected));
+        }
+        ASSERT_FALSE(view_parser.GetHasNext());
+    }
+}
+
+TEST(csvParserChecker, randomLineAccess) {
+    for (std::string name : {"SimpleTypes.csv", "WDC_game.csv", "Test1.csv"}) {
+        auto path = fs::current_path().append("inputData").append(name);
+        CSVParser sequential_parser(path);
+        CSVParser random_parser(path);
+        std::vector<std::vector<std::string>> rows;
+        while (sequential_parser.GetHasNext()) {
+            rows.push_back(sequential_parser.ParseNext());
+        }
+
+        std::vector<unsigned long long> line_indices;
+        for (unsigned long long i = rows.size(); i-- > 0;) {
+            ASSERT_THAT(random_parser.ParseLine(i), ContainerEq(rows[i]));
+            line_indices.push_back(i);
+            line_indices.push_back(i / 2);
+        }
+        std::vector<std::vector<std::string>> lines = random_parser.ParseLines(line_indices);
+        ASSERT_EQ(lines.size(), line_indices.size());
+        for (std::size_t i = 0; i < lines.size(); ++i) {
+            ASSERT_THAT(lines[i], ContainerEq(rows[line_indices[i]]));
+        }
+    }
+}
+
 TEST(testingBitsetToLonglong, first) {
     size_t encoded_num = 1254;
     boost::dynamic_bitset<> simple_bitset{20, encoded_num};
@@ -93,6 +718,67 @@ TEST(testingBitsetToLonglong, first) {
         ASSERT_EQ(encoded_num, long_long_repr);
 }
 
+TEST(agreeSetSampleChecker, implementationsMatchList) {
+    std::mt19937 gen(0);
+    auto path = fs::temp_directory_path() / "desbordante_agree_set_sample_test.csv";
+    for (std::size_t num_columns : {10, 100, 300}) {
+        {
+            std::ofstream file(path);
+            for (std::size_t i = 0; i < num_columns; ++i) {
+                file << (i == 0 ? "" : ",") << i;
+            }
+            file << '\n';
+            for (int row = 0; row < 200; ++row) {
+                for (std::size_t i = 0; i < num_columns; ++i) {
+                    file << (i == 0 ? "" : ",") << gen() % (i % 3 + 2);
+                }
+                file << '\n';
+            }
+        }
+        CSVParser parser(path);
+        auto relation = ColumnLayoutRelationData::CreateFrom(parser, true);
+        RelationalSchema const* schema = relation->GetSchema();
+        auto random_vertical = [&gen, schema, num_columns]() {
+            boost::dynamic_bitset<> indices(num_columns);
+            for (std::size_t i = 0; i < num_columns; ++i) {
+                indices[i] = gen() % (num_columns / 4 + 1) == 0;
+            }
+            return schema->GetVertical(indices);
+        };
+
+        for (unsigned int sample_size : {50, 9000, 100000}) {
+            for (std::size_t column = 0; column < num_columns; column += num_columns / 5) {
+                Vertical focus = static_cast<Vertical>(*schema->GetColumn(column));
+                auto pli = relation->GetColumnData(column).GetPositionListIndex();
+                auto list_sample = util::ListAgreeSetSample::CreateFocusedFor(
+                    relation.get(), focus, pli, sample_size, column);
+                std::vector<std::unique_ptr<util::AgreeSetSample>> samples;
+                samples.push_back(util::BitMatrixAgreeSetSample::CreateFocusedFor(
+                    relation.get(), focus, pli, sample_size, column));
+                samples.push_back(util::BitmapIndexAgreeSetSample::CreateFocusedFor(
+                    relation.get(), focus, pli, sample_size, column));
+                // The sampled pairs must not depend on the number of threads
+                samples.push_back(util::BitMatrixAgreeSetSample::CreateFocusedFor(
+                    relation.get(), focus, pli, sample_size, column, 3));
+                for (int query = 0; query < 50; ++query) {
+                    Vertical agreement = focus.Union(random_vertical());
+                    Vertical disagreement = random_vertical().Without(agreement);
+                    for (auto const& sample : samples) {
+                        ASSERT_EQ(sample->GetNumAgreeSupersets(agreement),
+                                  list_sample->GetNumAgreeSupersets(agreement));
+                        ASSERT_EQ(sample->GetNumAgreeSupersets(agreement, disagreement),
+                                  list_sample->GetNumAgreeSupersets(agreement, disagreement));
+                        ASSERT_THAT(*sample->GetNumAgreeSupersetsExt(agreement, disagreement),
+                                    ContainerEq(*list_sample->GetNumAgreeSupersetsExt(
+                                        agreement, disagreement)));
+                    }
+                }
+            }
+        }
+    }
+    fs::remove(path);
+}
+
 TEST(IdentifierSetTest, Computation) {
     std::set<std::string> id_sets;
     std::set<std::string> id_sets_ans = {